@@ -0,0 +1,71 @@
+﻿#include "AnalyticsDialog.h"
+#include "DocumentWriter.h"
+
+#include <QVBoxLayout>
+#include <QLabel>
+#include <QTabWidget>
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QDialogButtonBox>
+#include <QPushButton>
+#include <QFileDialog>
+#include <QMessageBox>
+
+AnalyticsDialog::AnalyticsDialog(const TextAnalytics::Result& result, QWidget* parent)
+    : QDialog(parent)
+    , m_result(result)
+{
+    setWindowTitle(tr("文本分析"));
+    resize(480, 560);
+
+    QVBoxLayout* layout = new QVBoxLayout(this);
+
+    QLabel* summary = new QLabel(tr("字数: %1  行数: %2  空行: %3  不同词数: %4  用时: %5 ms")
+        .arg(m_result.words).arg(m_result.lines).arg(m_result.blankLines)
+        .arg(m_result.uniqueWords).arg(m_result.elapsedMs), this);
+    layout->addWidget(summary);
+
+    QTabWidget* tabs = new QTabWidget(this);
+    tabs->addTab(createTable(m_result.topWords, tr("词")), tr("高频词"));
+    tabs->addTab(createTable(m_result.topBigrams, tr("词组")), tr("高频词组"));
+    tabs->addTab(createTable(m_result.topCjkBigrams, tr("二字词")), tr("中文二字词"));
+    layout->addWidget(tabs);
+
+    QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Close, this);
+    QPushButton* exportButton = buttons->addButton(tr("导出..."), QDialogButtonBox::ActionRole);
+    connect(exportButton, &QPushButton::clicked, this, &AnalyticsDialog::exportResult);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    layout->addWidget(buttons);
+}
+
+QTableWidget* AnalyticsDialog::createTable(const QVector<TextAnalytics::Entry>& entries, const QString& header)
+{
+    QTableWidget* table = new QTableWidget(int(entries.size()), 2, this);
+    table->setHorizontalHeaderLabels({ header, tr("次数") });
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+
+    for (int row = 0; row < entries.size(); ++row) {
+        table->setItem(row, 0, new QTableWidgetItem(entries[row].text));
+
+        QTableWidgetItem* count = new QTableWidgetItem(QString::number(entries[row].count));
+        count->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        table->setItem(row, 1, count);
+    }
+    return table;
+}
+
+void AnalyticsDialog::exportResult()
+{
+    const QString fileName = QFileDialog::getSaveFileName(this,
+        tr("导出分析结果"), QString(), tr("CSV 文件 (*.csv)"));
+    if (fileName.isEmpty()) return;
+
+    // 带 BOM 的 UTF-8，表格软件能直接识别中文
+    const DocumentWriter::Result written = DocumentWriter::writeAtomically(fileName,
+        TextAnalytics::toCsv(m_result), EncodingDetector::Encoding::Utf8Bom);
+    if (!written.ok) {
+        QMessageBox::warning(this, tr("导出失败"),
+            tr("无法写入 %1:\n%2").arg(fileName, written.errorString));
+    }
+}
@@ -0,0 +1,26 @@
+﻿#pragma once
+
+#include <QDialog>
+
+#include "TextAnalytics.h"
+
+class QTableWidget;
+
+// 展示文本分析结果，可导出为 CSV
+class AnalyticsDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit AnalyticsDialog(const TextAnalytics::Result& result, QWidget* parent = nullptr);
+    ~AnalyticsDialog() override = default;
+
+private slots:
+    void exportResult();
+
+private:
+    QTableWidget* createTable(const QVector<TextAnalytics::Entry>& entries, const QString& header);
+
+private:
+    TextAnalytics::Result m_result;
+};
@@ -0,0 +1,247 @@
+﻿#include "BatchCli.h"
+#include "StringProcessor.h"
+#include "TextReplacer.h"
+#include "DocumentReader.h"
+#include "DocumentWriter.h"
+#include "EncodingDetector.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QFileInfo>
+#include <QDirIterator>
+#include <QThreadPool>
+#include <QThread>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <atomic>
+#include <cstdio>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#endif
+
+namespace {
+
+enum class Operation {
+    Stats,
+    Count,
+    Replace,
+    Delete,
+};
+
+struct Task {
+    Operation operation = Operation::Stats;
+    QString pattern;
+    QString replacement;
+};
+
+// 输出一行 JSON，多个工作线程共用标准输出
+QMutex g_outputMutex;
+
+void writeLine(const QJsonObject& object)
+{
+    const QByteArray line = QJsonDocument(object).toJson(QJsonDocument::Compact) + '\n';
+    QMutexLocker locker(&g_outputMutex);
+    std::fwrite(line.constData(), 1, size_t(line.size()), stdout);
+    std::fflush(stdout);
+}
+
+void writeError(const QString& message)
+{
+    const QByteArray line = message.toLocal8Bit() + '\n';
+    QMutexLocker locker(&g_outputMutex);
+    std::fwrite(line.constData(), 1, size_t(line.size()), stderr);
+}
+
+QJsonObject processFile(const QString& fileName, const Task& task)
+{
+    QJsonObject object;
+    object.insert(QStringLiteral("file"), fileName);
+
+    // 普通文件映射到内存一次解码
+    const DocumentReader::Result loaded = DocumentReader::readMapped(fileName);
+    if (!loaded.ok) {
+        object.insert(QStringLiteral("ok"), false);
+        object.insert(QStringLiteral("error"), loaded.errorString);
+        return object;
+    }
+
+    switch (task.operation) {
+    case Operation::Stats: {
+        const StringProcessor::Result stats = StringProcessor().process(loaded.text);
+        object.insert(QStringLiteral("total"), stats.total);
+        object.insert(QStringLiteral("chinese"), stats.chinese);
+        object.insert(QStringLiteral("letters"), stats.letters);
+        object.insert(QStringLiteral("digits"), stats.digits);
+        object.insert(QStringLiteral("symbols"), stats.symbols);
+        object.insert(QStringLiteral("lines"), qint64(loaded.text.count(QLatin1Char('\n')) + 1));
+        object.insert(QStringLiteral("encoding"), EncodingDetector::displayName(loaded.encoding));
+        break;
+    }
+    case Operation::Count:
+        object.insert(QStringLiteral("count"), qint64(TextReplacer::countNonOverlapping(loaded.text, task.pattern)));
+        break;
+    case Operation::Replace:
+    case Operation::Delete: {
+        int count = 0;
+        const QString replaced = TextReplacer::replaceAll(loaded.text, task.pattern, task.replacement, &count);
+        object.insert(QStringLiteral("replaced"), count);
+
+        // 没有匹配时不改写文件；写入沿用原编码、换行和压缩格式
+        if (count > 0) {
+            const DocumentWriter::Result written = DocumentWriter::writeAtomically(fileName, replaced,
+                loaded.encoding, loaded.crlf, loaded.compression);
+            if (!written.ok) {
+                object.insert(QStringLiteral("ok"), false);
+                object.insert(QStringLiteral("error"), written.errorString);
+                return object;
+            }
+            object.insert(QStringLiteral("bytesWritten"), written.bytesWritten);
+        }
+        break;
+    }
+    }
+
+    object.insert(QStringLiteral("ok"), true);
+    return object;
+}
+
+// 目录递归展开为其中的普通文件，跳过隐藏文件和编辑日志
+QStringList collectFiles(const QStringList& paths)
+{
+    QStringList files;
+    for (const QString& path : paths) {
+        const QFileInfo info(path);
+        if (info.isDir()) {
+            QDirIterator it(path, QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+            while (it.hasNext()) {
+                const QString file = it.next();
+                if (!it.fileName().startsWith(QLatin1Char('.'))) {
+                    files.append(file);
+                }
+            }
+        }
+        else {
+            files.append(path);
+        }
+    }
+    return files;
+}
+
+}
+
+bool BatchCli::isBatchInvocation(int argc, char* argv[])
+{
+    static const char* const OPERATIONS[] = { "--stats", "--count", "--replace", "--delete" };
+
+    // 同时识别 --count PATTERN 和 --count=PATTERN 两种写法
+    for (int i = 1; i < argc; ++i) {
+        const QByteArray argument(argv[i]);
+        for (const char* operation : OPERATIONS) {
+            if (argument == operation || argument.startsWith(QByteArray(operation) + '=')) return true;
+        }
+    }
+    return false;
+}
+
+void BatchCli::attachParentConsole()
+{
+#ifdef Q_OS_WIN
+    // 程序以窗口子系统构建，从命令行启动时需要接回父进程的控制台
+    if (AttachConsole(ATTACH_PARENT_PROCESS)) {
+        FILE* stream = nullptr;
+        if (_fileno(stdout) < 0) freopen_s(&stream, "CONOUT$", "w", stdout);
+        if (_fileno(stderr) < 0) freopen_s(&stream, "CONOUT$", "w", stderr);
+    }
+#endif
+}
+
+int BatchCli::run(int argc, char* argv[])
+{
+    attachParentConsole();
+
+    // 只用 QCoreApplication，不创建任何窗口部件
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QCoreApplication::translate("BatchCli", "批量统计、查找、替换和删除文本"));
+    parser.addHelpOption();
+
+    const QCommandLineOption statsOption(QStringLiteral("stats"),
+        QCoreApplication::translate("BatchCli", "输出字符统计"));
+    const QCommandLineOption countOption(QStringLiteral("count"),
+        QCoreApplication::translate("BatchCli", "统计字符串不重叠的出现次数，与替换次数一致"), QStringLiteral("pattern"));
+    const QCommandLineOption replaceOption(QStringLiteral("replace"),
+        QCoreApplication::translate("BatchCli", "替换字符串，替换内容由 --with 指定"), QStringLiteral("pattern"));
+    const QCommandLineOption withOption(QStringLiteral("with"),
+        QCoreApplication::translate("BatchCli", "替换为的内容"), QStringLiteral("replacement"));
+    const QCommandLineOption deleteOption(QStringLiteral("delete"),
+        QCoreApplication::translate("BatchCli", "删除字符串"), QStringLiteral("pattern"));
+    const QCommandLineOption jobsOption(QStringLiteral("jobs"),
+        QCoreApplication::translate("BatchCli", "并行处理的文件数，默认为 CPU 线程数"), QStringLiteral("n"));
+    parser.addOptions({ statsOption, countOption, replaceOption, withOption, deleteOption, jobsOption });
+    parser.addPositionalArgument(QStringLiteral("paths"),
+        QCoreApplication::translate("BatchCli", "要处理的文件或目录"), QStringLiteral("paths..."));
+    parser.process(app);
+
+    Task task;
+    int operations = 0;
+    if (parser.isSet(statsOption)) {
+        task.operation = Operation::Stats;
+        ++operations;
+    }
+    if (parser.isSet(countOption)) {
+        task.operation = Operation::Count;
+        task.pattern = parser.value(countOption);
+        ++operations;
+    }
+    if (parser.isSet(replaceOption)) {
+        task.operation = Operation::Replace;
+        task.pattern = parser.value(replaceOption);
+        task.replacement = parser.value(withOption);
+        ++operations;
+    }
+    if (parser.isSet(deleteOption)) {
+        task.operation = Operation::Delete;
+        task.pattern = parser.value(deleteOption);
+        ++operations;
+    }
+
+    if (operations != 1) {
+        writeError(QCoreApplication::translate("BatchCli", "--stats、--count、--replace、--delete 只能指定一个"));
+        return 2;
+    }
+    if (task.operation != Operation::Stats && task.pattern.isEmpty()) {
+        writeError(QCoreApplication::translate("BatchCli", "查找字符串不能为空"));
+        return 2;
+    }
+    if (task.operation == Operation::Replace && !parser.isSet(withOption)) {
+        writeError(QCoreApplication::translate("BatchCli", "--replace 需要配合 --with 指定替换内容"));
+        return 2;
+    }
+
+    const QStringList files = collectFiles(parser.positionalArguments());
+    if (files.isEmpty()) {
+        writeError(QCoreApplication::translate("BatchCli", "没有要处理的文件"));
+        return 2;
+    }
+
+    QThreadPool pool;
+    const int jobs = parser.value(jobsOption).toInt();
+    pool.setMaxThreadCount(jobs > 0 ? jobs : QThread::idealThreadCount());
+
+    // 每个文件处理完立即输出一行，输出顺序为完成顺序
+    std::atomic<int> failures{ 0 };
+    QtConcurrent::blockingMap(&pool, files, [&task, &failures](const QString& fileName) {
+        const QJsonObject object = processFile(fileName, task);
+        if (!object.value(QStringLiteral("ok")).toBool()) ++failures;
+        writeLine(object);
+    });
+
+    return failures > 0 ? 1 : 0;
+}
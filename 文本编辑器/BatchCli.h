@@ -0,0 +1,19 @@
+﻿#pragma once
+
+// 无界面的批处理模式：对多个文件并行统计、计数、替换或删除，
+// 每个文件输出一行 JSON
+class BatchCli
+{
+public:
+    BatchCli() = default;
+    ~BatchCli() = default;
+
+    // 命令行中带有批处理操作时不启动界面
+    static bool isBatchInvocation(int argc, char* argv[]);
+
+    // 返回进程退出码：0 全部成功，1 有文件失败，2 参数错误
+    static int run(int argc, char* argv[]);
+
+    // Windows 上接回启动进程的控制台，让标准输出和标准错误可见；其他平台什么也不做
+    static void attachParentConsole();
+};
@@ -0,0 +1,332 @@
+﻿#include "BlockIndex.h"
+#include "EditorHost.h"
+#include "Trace.h"
+
+#include <QTextDocument>
+
+BlockIndex::BlockIndex(QTextDocument* document, QObject* parent)
+    : QObject(parent)
+    , m_document(nullptr)
+    , m_charge(MemoryAccounting::Tag::BlockIndex)
+    , m_root(-1)
+    , m_seed(0x9E3779B9u)
+{
+    setDocument(document);
+}
+
+void BlockIndex::setDocument(QTextDocument* document)
+{
+    if (m_document) {
+        disconnect(m_document, &QTextDocument::contentsChange, this, &BlockIndex::onContentsChange);
+    }
+    m_document = document;
+    if (m_document) {
+        connect(m_document, &QTextDocument::contentsChange, this, &BlockIndex::onContentsChange);
+    }
+    rebuild();
+}
+
+void BlockIndex::rebuild()
+{
+    m_nodes.clear();
+    m_freeNodes.clear();
+    m_root = m_document ? build(m_document->firstBlock(), QTextBlock()) : -1;
+    updateCharge();
+    emit indexReset();
+}
+
+void BlockIndex::onContentsChange(int position, int charsRemoved, int charsAdded)
+{
+    TRACE_SCOPE("BlockIndex::onContentsChange");
+
+    const int oldTotal = total(Key::Position);
+    const int newTotal = m_document->characterCount();
+
+    // 变化量对不上时（如整篇替换的边界情况）直接重建
+    if (m_root < 0 || oldTotal - charsRemoved + charsAdded != newTotal
+        || position < 0 || position >= oldTotal) {
+        rebuild();
+        return;
+    }
+
+    // 变化前后覆盖编辑范围的块一一替换，其余块不变
+    const Location first = locate(Key::Position, position);
+    const Location last = locate(Key::Position, qMin(position + charsRemoved, oldTotal - 1));
+    const int firstLine = first.rank - first.continuations;
+    const int oldLastLine = last.rank - last.continuations;
+
+    int before = -1;
+    int middle = -1;
+    int after = -1;
+    split(m_root, first.rank, before, middle);
+    split(middle, last.rank - first.rank + 1, middle, after);
+    release(middle);
+
+    const QTextBlock begin = m_document->findBlock(position);
+    const QTextBlock end = m_document->findBlock(qMin(position + charsAdded, newTotal - 1)).next();
+    m_root = merge(merge(before, build(begin, end)), after);
+    updateCharge();
+
+    const int newLastLine = lineNumber(qMin(position + charsAdded, newTotal - 1));
+    emit linesChanged(firstLine, oldLastLine - firstLine + 1, newLastLine - firstLine + 1);
+}
+
+int BlockIndex::lineCount() const
+{
+    return total(Key::Line);
+}
+
+int BlockIndex::lineNumber(int position) const
+{
+    const Location location = locate(Key::Position, position);
+    return location.rank - location.continuations;
+}
+
+int BlockIndex::columnNumber(int position) const
+{
+    return logicalPosition(position) - logicalPosition(lineStart(lineNumber(position)));
+}
+
+int BlockIndex::lineStart(int line) const
+{
+    return locate(Key::Line, line).position;
+}
+
+int BlockIndex::logicalPosition(int position) const
+{
+    return position - locate(Key::Position, position).continuations;
+}
+
+int BlockIndex::documentPosition(int logicalPosition) const
+{
+    // 段尾的逻辑位置落在前一段末尾，不跳到下一段开头
+    return logicalPosition + locate(Key::Logical, logicalPosition).continuations;
+}
+
+StringProcessor::Result BlockIndex::totalStats() const
+{
+    return m_root >= 0 ? m_nodes[m_root].sumStats : StringProcessor::Result();
+}
+
+StringProcessor::Result BlockIndex::rangeStats(int start, int end) const
+{
+    if (end <= start) return StringProcessor::Result();
+
+    StringProcessor::Result result = prefixStats(end);
+    result -= prefixStats(start);
+    return result;
+}
+
+StringProcessor::Result BlockIndex::prefixStats(int position) const
+{
+    if (m_root < 0 || position <= 0) return StringProcessor::Result();
+
+    // 之前的整块直接取累计值，所在块只统计位置之前的部分
+    const Location location = locate(Key::Position, position);
+    StringProcessor::Result result = location.stats;
+
+    const QTextBlock block = m_document->findBlock(position);
+    const int offset = position - location.position;
+    if (offset > 0) {
+        result += m_processor.process(block.text().left(offset));
+    }
+    return result;
+}
+
+int BlockIndex::createNode(const QTextBlock& block)
+{
+    // xorshift 生成优先级
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+
+    Node node;
+    node.left = -1;
+    node.right = -1;
+    node.priority = m_seed;
+    node.size = 1;
+    node.length = block.length();
+    node.continuation = EditorHost::isContinuation(block) ? 1 : 0;
+    node.sumLength = node.length;
+    node.sumContinuation = node.continuation;
+    node.stats = m_processor.process(block.text());
+    node.sumStats = node.stats;
+
+    if (!m_freeNodes.isEmpty()) {
+        const int index = m_freeNodes.takeLast();
+        m_nodes[index] = node;
+        return index;
+    }
+    m_nodes.append(node);
+    return m_nodes.size() - 1;
+}
+
+void BlockIndex::update(int node)
+{
+    Node& n = m_nodes[node];
+    n.size = 1;
+    n.sumLength = n.length;
+    n.sumContinuation = n.continuation;
+    n.sumStats = n.stats;
+
+    for (int child : { n.left, n.right }) {
+        if (child < 0) continue;
+        const Node& c = m_nodes[child];
+        n.size += c.size;
+        n.sumLength += c.sumLength;
+        n.sumContinuation += c.sumContinuation;
+        n.sumStats += c.sumStats;
+    }
+}
+
+int BlockIndex::merge(int left, int right)
+{
+    if (left < 0) return right;
+    if (right < 0) return left;
+
+    if (m_nodes[left].priority > m_nodes[right].priority) {
+        m_nodes[left].right = merge(m_nodes[left].right, right);
+        update(left);
+        return left;
+    }
+    m_nodes[right].left = merge(left, m_nodes[right].left);
+    update(right);
+    return right;
+}
+
+void BlockIndex::split(int node, int count, int& left, int& right)
+{
+    if (node < 0) {
+        left = -1;
+        right = -1;
+        return;
+    }
+
+    const int leftSize = m_nodes[node].left >= 0 ? m_nodes[m_nodes[node].left].size : 0;
+    int first = -1;
+    int second = -1;
+    if (count <= leftSize) {
+        split(m_nodes[node].left, count, first, second);
+        m_nodes[node].left = second;
+        update(node);
+        left = first;
+        right = node;
+    }
+    else {
+        split(m_nodes[node].right, count - leftSize - 1, first, second);
+        m_nodes[node].right = first;
+        update(node);
+        left = node;
+        right = second;
+    }
+}
+
+int BlockIndex::build(QTextBlock first, const QTextBlock& end)
+{
+    // 按块顺序用单调栈建笛卡尔树，O(n)
+    QVector<int> stack;
+    for (QTextBlock block = first; block.isValid() && block != end; block = block.next()) {
+        const int node = createNode(block);
+
+        int last = -1;
+        while (!stack.isEmpty() && m_nodes[stack.last()].priority < m_nodes[node].priority) {
+            last = stack.takeLast();
+            update(last);
+        }
+        m_nodes[node].left = last;
+        if (!stack.isEmpty()) {
+            m_nodes[stack.last()].right = node;
+        }
+        stack.append(node);
+    }
+
+    for (int i = stack.size() - 1; i >= 0; --i) {
+        update(stack[i]);
+    }
+    return stack.isEmpty() ? -1 : stack.first();
+}
+
+void BlockIndex::release(int node)
+{
+    QVector<int> pending;
+    if (node >= 0) pending.append(node);
+
+    while (!pending.isEmpty()) {
+        const int current = pending.takeLast();
+        if (m_nodes[current].left >= 0) pending.append(m_nodes[current].left);
+        if (m_nodes[current].right >= 0) pending.append(m_nodes[current].right);
+        m_freeNodes.append(current);
+    }
+}
+
+void BlockIndex::updateCharge()
+{
+    m_charge.set(MemoryAccounting::bytesOf(m_nodes) + MemoryAccounting::bytesOf(m_freeNodes));
+}
+
+int BlockIndex::weight(int node, Key key, bool subtree) const
+{
+    if (node < 0) return 0;
+
+    const Node& n = m_nodes[node];
+    const int size = subtree ? n.size : 1;
+    const int length = subtree ? n.sumLength : n.length;
+    const int continuation = subtree ? n.sumContinuation : n.continuation;
+
+    switch (key) {
+    case Key::Position:
+        return length;
+    case Key::Logical:
+        return length - continuation;
+    case Key::Line:
+        return size - continuation;
+    }
+    return 0;
+}
+
+BlockIndex::Location BlockIndex::locate(Key key, int target) const
+{
+    Location location{ 0, 0, 0, StringProcessor::Result() };
+    if (m_root < 0) return location;
+
+    // 超出范围时定位到最后一个块
+    target = qBound(0, target, total(key) - 1);
+
+    int node = m_root;
+    while (node >= 0) {
+        const Node& n = m_nodes[node];
+        const int leftWeight = weight(n.left, key, true);
+        if (target < leftWeight) {
+            node = n.left;
+            continue;
+        }
+
+        target -= leftWeight;
+        if (n.left >= 0) {
+            const Node& l = m_nodes[n.left];
+            location.rank += l.size;
+            location.position += l.sumLength;
+            location.continuations += l.sumContinuation;
+            location.stats += l.sumStats;
+        }
+
+        const int ownWeight = weight(node, key, false);
+        if (target < ownWeight) {
+            location.continuations += n.continuation;
+            return location;
+        }
+
+        target -= ownWeight;
+        location.rank += 1;
+        location.position += n.length;
+        location.continuations += n.continuation;
+        location.stats += n.stats;
+        node = n.right;
+    }
+    return location;
+}
+
+int BlockIndex::total(Key key) const
+{
+    return weight(m_root, key, true);
+}
@@ -0,0 +1,118 @@
+﻿#pragma once
+
+#include <QObject>
+#include <QVector>
+#include <QTextBlock>
+#include "StringProcessor.h"
+#include "MemoryAccounting.h"
+
+class QTextDocument;
+
+// 按块顺序组织的隐式树堆，每个节点对应文档中的一个块，汇总块长度、续行段数量和字符统计；
+// 随 contentsChange 只替换受影响的块，行号、列号、逻辑位置和任意范围的统计都能在 O(log n) 内得到
+class BlockIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BlockIndex(QTextDocument* document, QObject* parent = nullptr);
+    ~BlockIndex() override = default;
+
+    void setDocument(QTextDocument* document);
+
+    // 块的续行标记在内容变化之外被修改后需要重建
+    void rebuild();
+
+    int lineCount() const;
+
+    // 文档位置所在的逻辑行，从 0 开始
+    int lineNumber(int position) const;
+
+    // 文档位置在逻辑行中的列，从 0 开始
+    int columnNumber(int position) const;
+
+    // 逻辑行开头的文档位置
+    int lineStart(int line) const;
+
+    int logicalPosition(int position) const;
+
+    int documentPosition(int logicalPosition) const;
+
+    // 整篇文档的字符统计
+    StringProcessor::Result totalStats() const;
+
+    // 文档位置 [start, end) 的字符统计，只需扫描两端的部分块
+    StringProcessor::Result rangeStats(int start, int end) const;
+
+signals:
+    // 从 firstLine 开始的 removedLines 个逻辑行被替换为 addedLines 个
+    void linesChanged(int firstLine, int removedLines, int addedLines);
+
+    // 索引整体重建，之前的行号都不再有效
+    void indexReset();
+
+private slots:
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+
+private:
+    struct Node {
+        int left;
+        int right;
+        quint32 priority;
+        int size;               // 子树中的块数
+        int length;             // 块长度，含块分隔符
+        int continuation;       // 是否续行段
+        int sumLength;
+        int sumContinuation;
+        StringProcessor::Result stats;      // 块文本的统计
+        StringProcessor::Result sumStats;
+    };
+
+    // 按哪种累计量查找块
+    enum class Key {
+        Position,               // 文档位置
+        Logical,                // 逻辑位置
+        Line,                   // 逻辑行
+    };
+
+    struct Location {
+        int rank;               // 块序号
+        int position;           // 块起始的文档位置
+        int continuations;      // 之前的续行段数，含本块
+        StringProcessor::Result stats;      // 之前各块的统计，不含本块
+    };
+
+    int createNode(const QTextBlock& block);
+
+    void update(int node);
+
+    int merge(int left, int right);
+
+    void split(int node, int count, int& left, int& right);
+
+    // 由 [first, end) 范围内的块线性构建子树
+    int build(QTextBlock first, const QTextBlock& end);
+
+    void release(int node);
+
+    void updateCharge();
+
+    int weight(int node, Key key, bool subtree) const;
+
+    // 找到累计量首次超过 target 的块
+    Location locate(Key key, int target) const;
+
+    int total(Key key) const;
+
+    // 文档开头到 position 的统计
+    StringProcessor::Result prefixStats(int position) const;
+
+private:
+    QTextDocument* m_document;
+    QVector<Node> m_nodes;          // 节点池
+    QVector<int> m_freeNodes;
+    MemoryAccounting::Charge m_charge;  // 节点池的内存记账
+    StringProcessor m_processor;
+    int m_root;
+    quint32 m_seed;                 // 节点优先级的随机种子
+};
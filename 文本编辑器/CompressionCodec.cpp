@@ -0,0 +1,226 @@
+﻿#include "CompressionCodec.h"
+
+#include <QCoreApplication>
+#include <QByteArray>
+#include <QFileInfo>
+
+#include <zlib.h>
+#include <zstd.h>
+
+struct CompressionCodec::State
+{
+    z_stream zlib{};
+    bool zlibReady = false;
+    ZSTD_DCtx* zstdIn = nullptr;
+    ZSTD_CCtx* zstdOut = nullptr;
+    QByteArray buffer;
+    bool streamEnded = false;   // 解压时已到达完整的流尾，之后只有补齐的零字节，没有剩余的半截数据
+
+    ~State()
+    {
+        if (zstdIn) ZSTD_freeDCtx(zstdIn);
+        if (zstdOut) ZSTD_freeCCtx(zstdOut);
+    }
+};
+
+CompressionCodec::CompressionCodec(Format format, Mode mode)
+    : m_format(format)
+    , m_mode(mode)
+    , d(std::make_unique<State>())
+{
+    d->buffer.resize(OUTPUT_CHUNK);
+
+    switch (m_format) {
+    case Format::Gzip:
+        if (m_mode == Mode::Decompress) {
+            // 15 + 32：自动识别 gzip/zlib 头
+            d->zlibReady = inflateInit2(&d->zlib, 15 + 32) == Z_OK;
+        }
+        else {
+            // 15 + 16：写出 gzip 头
+            d->zlibReady = deflateInit2(&d->zlib, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+        }
+        break;
+    case Format::Zstd:
+        if (m_mode == Mode::Decompress) {
+            d->zstdIn = ZSTD_createDCtx();
+        }
+        else {
+            d->zstdOut = ZSTD_createCCtx();
+        }
+        break;
+    case Format::None:
+        break;
+    }
+}
+
+CompressionCodec::~CompressionCodec()
+{
+    if (d->zlibReady) {
+        if (m_mode == Mode::Decompress) inflateEnd(&d->zlib);
+        else deflateEnd(&d->zlib);
+    }
+}
+
+bool CompressionCodec::isValid() const
+{
+    switch (m_format) {
+    case Format::Gzip: return d->zlibReady;
+    case Format::Zstd: return m_mode == Mode::Decompress ? d->zstdIn != nullptr : d->zstdOut != nullptr;
+    case Format::None: return true;
+    }
+    return false;
+}
+
+bool CompressionCodec::process(const char* data, qsizetype size, const Sink& sink)
+{
+    char* out = d->buffer.data();
+
+    switch (m_format) {
+    case Format::None:
+        return sink(data, size);
+
+    case Format::Gzip: {
+        z_stream& z = d->zlib;
+        z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        z.avail_in = uInt(size);
+
+        // 输出缓冲区被填满时可能还有未输出的数据，继续调用直到输入耗尽且输出不满
+        do {
+            // 一个成员结束之后：与 gzip 一样跳过磁带、块设备工具补齐用的零字节，
+            // 后面还有数据就是下一个成员（多个文件 cat 在一起），不是合法的成员头时报告损坏
+            if (m_mode == Mode::Decompress && d->streamEnded) {
+                while (z.avail_in > 0 && *z.next_in == 0) {
+                    ++z.next_in;
+                    --z.avail_in;
+                }
+                if (z.avail_in == 0) break;
+                inflateReset(&z);
+                d->streamEnded = false;
+            }
+
+            z.next_out = reinterpret_cast<Bytef*>(out);
+            z.avail_out = uInt(OUTPUT_CHUNK);
+
+            const int ret = m_mode == Mode::Decompress ? inflate(&z, Z_NO_FLUSH) : deflate(&z, Z_NO_FLUSH);
+            if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+                m_errorString = QCoreApplication::translate("CompressionCodec", "gzip 数据损坏");
+                return false;
+            }
+            d->streamEnded = ret == Z_STREAM_END;
+
+            const qsizetype produced = OUTPUT_CHUNK - z.avail_out;
+            if (produced > 0 && !sink(out, produced)) return false;
+
+            if (ret == Z_BUF_ERROR) break;  // 没有可推进的数据
+        } while (z.avail_in > 0 || z.avail_out == 0);
+        return true;
+    }
+
+    case Format::Zstd: {
+        ZSTD_inBuffer input = { data, size_t(size), 0 };
+        bool outputFull = false;
+        while (input.pos < input.size || outputFull) {
+            ZSTD_outBuffer output = { out, size_t(OUTPUT_CHUNK), 0 };
+            const size_t ret = m_mode == Mode::Decompress
+                ? ZSTD_decompressStream(d->zstdIn, &output, &input)
+                : ZSTD_compressStream2(d->zstdOut, &output, &input, ZSTD_e_continue);
+            if (ZSTD_isError(ret)) {
+                m_errorString = QString::fromLatin1(ZSTD_getErrorName(ret));
+                return false;
+            }
+            // 解压返回 0 表示一帧已完整解码并全部输出
+            d->streamEnded = ret == 0;
+            if (output.pos > 0 && !sink(out, qsizetype(output.pos))) return false;
+            outputFull = output.pos == output.size;
+        }
+        return true;
+    }
+    }
+    return false;
+}
+
+bool CompressionCodec::finish(const Sink& sink)
+{
+    // 解压时只检查流是否完整，截断的文件不能当作完整内容打开后再写回
+    if (m_mode == Mode::Decompress) {
+        if (m_format != Format::None && !d->streamEnded) {
+            m_errorString = QCoreApplication::translate("CompressionCodec", "压缩数据不完整，文件可能被截断");
+            return false;
+        }
+        return true;
+    }
+
+    char* out = d->buffer.data();
+
+    switch (m_format) {
+    case Format::None:
+        return true;
+
+    case Format::Gzip: {
+        z_stream& z = d->zlib;
+        z.next_in = nullptr;
+        z.avail_in = 0;
+        int ret = Z_OK;
+        while (ret != Z_STREAM_END) {
+            z.next_out = reinterpret_cast<Bytef*>(out);
+            z.avail_out = uInt(OUTPUT_CHUNK);
+            ret = deflate(&z, Z_FINISH);
+            if (ret != Z_OK && ret != Z_STREAM_END) {
+                m_errorString = QCoreApplication::translate("CompressionCodec", "gzip 压缩失败");
+                return false;
+            }
+            const qsizetype produced = OUTPUT_CHUNK - z.avail_out;
+            if (produced > 0 && !sink(out, produced)) return false;
+        }
+        return true;
+    }
+
+    case Format::Zstd: {
+        ZSTD_inBuffer input = { nullptr, 0, 0 };
+        size_t remaining = 1;
+        while (remaining != 0) {
+            ZSTD_outBuffer output = { out, size_t(OUTPUT_CHUNK), 0 };
+            remaining = ZSTD_compressStream2(d->zstdOut, &output, &input, ZSTD_e_end);
+            if (ZSTD_isError(remaining)) {
+                m_errorString = QString::fromLatin1(ZSTD_getErrorName(remaining));
+                return false;
+            }
+            if (output.pos > 0 && !sink(out, qsizetype(output.pos))) return false;
+        }
+        return true;
+    }
+    }
+    return false;
+}
+
+CompressionCodec::Format CompressionCodec::detect(const char* data, qsizetype size)
+{
+    const uchar* bytes = reinterpret_cast<const uchar*>(data);
+    if (size >= 2 && bytes[0] == 0x1F && bytes[1] == 0x8B) {
+        return Format::Gzip;
+    }
+    if (size >= 4 && bytes[0] == 0x28 && bytes[1] == 0xB5 && bytes[2] == 0x2F && bytes[3] == 0xFD) {
+        return Format::Zstd;
+    }
+    return Format::None;
+}
+
+CompressionCodec::Format CompressionCodec::formatForFileName(const QString& fileName)
+{
+    const QString suffix = QFileInfo(fileName).suffix().toLower();
+    if (suffix == QLatin1String("gz")) return Format::Gzip;
+    if (suffix == QLatin1String("zst")) return Format::Zstd;
+    return Format::None;
+}
+
+QString CompressionCodec::displayName(Format format)
+{
+    switch (format) {
+    case Format::Gzip: return QStringLiteral("gzip");
+    case Format::Zstd: return QStringLiteral("zstd");
+    case Format::None: break;
+    }
+    return QString();
+}
@@ -0,0 +1,58 @@
+﻿#pragma once
+
+#include <QString>
+
+#include <functional>
+#include <memory>
+
+class CompressionCodec
+{
+public:
+    enum class Format {
+        None,
+        Gzip,
+        Zstd,
+    };
+
+    enum class Mode {
+        Compress,
+        Decompress,
+    };
+
+    // 接收输出数据，返回 false 时中止处理
+    using Sink = std::function<bool(const char* data, qsizetype size)>;
+
+    CompressionCodec(Format format, Mode mode);
+    ~CompressionCodec();
+
+    CompressionCodec(const CompressionCodec&) = delete;
+    CompressionCodec& operator=(const CompressionCodec&) = delete;
+
+    bool isValid() const;
+
+    QString errorString() const { return m_errorString; }
+
+    // 处理一块输入，输出按固定大小的缓冲区逐块交给 sink，内存占用与文件大小无关
+    bool process(const char* data, qsizetype size, const Sink& sink);
+
+    // 压缩时写出剩余数据和流尾；解压时检查输入是否以完整的流结束，被截断时返回 false
+    bool finish(const Sink& sink);
+
+    // 根据魔数识别压缩格式
+    static Format detect(const char* data, qsizetype size);
+
+    // 根据扩展名判断另存为时使用的压缩格式
+    static Format formatForFileName(const QString& fileName);
+
+    static QString displayName(Format format);
+
+private:
+    struct State;
+
+    Format m_format;
+    Mode m_mode;
+    std::unique_ptr<State> d;
+    QString m_errorString;
+
+    static constexpr qsizetype OUTPUT_CHUNK = 256 * 1024;  // 每次交给 sink 的最大字节数
+};
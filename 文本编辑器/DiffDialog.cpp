@@ -0,0 +1,220 @@
+﻿#include "DiffDialog.h"
+
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QGridLayout>
+#include <QLabel>
+#include <QPlainTextEdit>
+#include <QPushButton>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QFontDatabase>
+#include <QDialogButtonBox>
+
+#include <algorithm>
+
+namespace {
+
+const QColor REMOVED_COLOR(255, 220, 220);
+const QColor ADDED_COLOR(220, 255, 220);
+const QColor CHANGED_COLOR(255, 245, 200);
+const QColor PADDING_COLOR(235, 235, 235);
+const QColor REMOVED_CHARS_COLOR(255, 170, 170);
+const QColor ADDED_CHARS_COLOR(160, 235, 160);
+
+}
+
+DiffDialog::DiffDialog(const LineDiff::Result& result, const QString& leftName, const QString& rightName,
+    QWidget* parent)
+    : QDialog(parent)
+    , m_result(result)
+    , m_leftView(createView(result.leftText))
+    , m_rightView(createView(result.rightText))
+    , m_summaryLabel(new QLabel(this))
+    , m_previousButton(new QPushButton(tr("上一处差异"), this))
+    , m_nextButton(new QPushButton(tr("下一处差异"), this))
+    , m_syncing(false)
+{
+    setWindowTitle(tr("比较 %1 与 %2").arg(leftName, rightName));
+    resize(1100, 700);
+
+    m_summaryLabel->setText(tr("左侧 %1 行，右侧 %2 行；%3 处差异，删除 %4 行，新增 %5 行，用时 %6 ms")
+        .arg(m_result.leftLines).arg(m_result.rightLines).arg(m_result.hunks.size())
+        .arg(m_result.removedLines).arg(m_result.addedLines).arg(m_result.elapsedMs));
+    m_previousButton->setEnabled(!m_result.hunks.isEmpty());
+    m_nextButton->setEnabled(!m_result.hunks.isEmpty());
+
+    QGridLayout* views = new QGridLayout();
+    views->addWidget(new QLabel(leftName, this), 0, 0);
+    views->addWidget(new QLabel(rightName, this), 0, 1);
+    views->addWidget(m_leftView, 1, 0);
+    views->addWidget(m_rightView, 1, 1);
+
+    QHBoxLayout* bottom = new QHBoxLayout();
+    bottom->addWidget(m_summaryLabel, 1);
+    bottom->addWidget(m_previousButton);
+    bottom->addWidget(m_nextButton);
+    QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Close, this);
+    bottom->addWidget(buttons);
+
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    layout->addLayout(views, 1);
+    layout->addLayout(bottom);
+
+    syncScrollBars(m_leftView, m_rightView);
+    syncScrollBars(m_rightView, m_leftView);
+    connect(m_leftView->verticalScrollBar(), &QScrollBar::valueChanged, this, &DiffDialog::updateHighlights);
+    connect(m_leftView->horizontalScrollBar(), &QScrollBar::valueChanged, this, &DiffDialog::updateHighlights);
+    connect(m_previousButton, &QPushButton::clicked, this, &DiffDialog::previousHunk);
+    connect(m_nextButton, &QPushButton::clicked, this, &DiffDialog::nextHunk);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+    if (!m_result.hunks.isEmpty()) scrollToHunk(0);
+}
+
+QPlainTextEdit* DiffDialog::createView(const QString& text)
+{
+    QPlainTextEdit* view = new QPlainTextEdit(this);
+    view->setReadOnly(true);
+    view->setLineWrapMode(QPlainTextEdit::NoWrap);
+    view->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    view->setPlainText(text);
+    return view;
+}
+
+void DiffDialog::syncScrollBars(QPlainTextEdit* source, QPlainTextEdit* target)
+{
+    // 两侧行数相同，按滚动条的值逐行对齐；另一侧到达边界时不反过来拉回
+    const auto follow = [this](QScrollBar* from, QScrollBar* to) {
+        connect(from, &QScrollBar::valueChanged, this, [this, to](int value) {
+            if (m_syncing) return;
+            m_syncing = true;
+            to->setValue(value);
+            m_syncing = false;
+        });
+    };
+    follow(source->verticalScrollBar(), target->verticalScrollBar());
+    follow(source->horizontalScrollBar(), target->horizontalScrollBar());
+}
+
+void DiffDialog::resizeEvent(QResizeEvent* event)
+{
+    QDialog::resizeEvent(event);
+    updateHighlights();
+}
+
+int DiffDialog::firstVisibleRow() const
+{
+    return m_leftView->cursorForPosition(QPoint(0, 0)).blockNumber();
+}
+
+void DiffDialog::updateHighlights()
+{
+    const int first = firstVisibleRow();
+    const int last = m_leftView->cursorForPosition(QPoint(0, m_leftView->viewport()->height() - 1)).blockNumber();
+
+    // 找到第一个与可见区域相交的差异
+    const auto begin = std::lower_bound(m_result.hunks.cbegin(), m_result.hunks.cend(), first,
+        [](const LineDiff::Hunk& hunk, int row) { return hunk.row + hunk.rows <= row; });
+
+    QList<QTextEdit::ExtraSelection> leftSelections;
+    QList<QTextEdit::ExtraSelection> rightSelections;
+    for (auto it = begin; it != m_result.hunks.cend() && it->row <= last; ++it) {
+        const LineDiff::Hunk& hunk = *it;
+        const bool changed = hunk.leftCount > 0 && hunk.rightCount > 0;
+        const int end = qMin(hunk.row + hunk.rows, last + 1);
+
+        for (int row = qMax(hunk.row, first); row < end; ++row) {
+            const int offset = row - hunk.row;
+            const bool paired = offset < hunk.leftCount && offset < hunk.rightCount;
+            const Refined* ranges = paired ? &refined(row) : nullptr;
+
+            if (offset < hunk.leftCount) {
+                appendSelections(leftSelections, m_leftView, row, changed ? CHANGED_COLOR : REMOVED_COLOR,
+                    ranges ? &ranges->left : nullptr, REMOVED_CHARS_COLOR);
+            }
+            else {
+                appendSelections(leftSelections, m_leftView, row, PADDING_COLOR, nullptr, QColor());
+            }
+
+            if (offset < hunk.rightCount) {
+                appendSelections(rightSelections, m_rightView, row, changed ? CHANGED_COLOR : ADDED_COLOR,
+                    ranges ? &ranges->right : nullptr, ADDED_CHARS_COLOR);
+            }
+            else {
+                appendSelections(rightSelections, m_rightView, row, PADDING_COLOR, nullptr, QColor());
+            }
+        }
+    }
+
+    m_leftView->setExtraSelections(leftSelections);
+    m_rightView->setExtraSelections(rightSelections);
+}
+
+const DiffDialog::Refined& DiffDialog::refined(int row)
+{
+    auto it = m_refined.find(row);
+    if (it == m_refined.end()) {
+        Refined ranges;
+        const QTextBlock left = m_leftView->document()->findBlockByNumber(row);
+        const QTextBlock right = m_rightView->document()->findBlockByNumber(row);
+        LineDiff::refine(left.text(), right.text(), &ranges.left, &ranges.right);
+        it = m_refined.insert(row, ranges);
+    }
+    return *it;
+}
+
+void DiffDialog::appendSelections(QList<QTextEdit::ExtraSelection>& selections, QPlainTextEdit* view, int row,
+    const QColor& color, const QVector<LineDiff::Range>* ranges, const QColor& rangeColor) const
+{
+    const QTextBlock block = view->document()->findBlockByNumber(row);
+    if (!block.isValid()) return;
+
+    QTextEdit::ExtraSelection line;
+    line.cursor = QTextCursor(block);
+    line.format.setBackground(color);
+    line.format.setProperty(QTextFormat::FullWidthSelection, true);
+    selections.append(line);
+
+    if (!ranges) return;
+    for (const LineDiff::Range& range : *ranges) {
+        QTextEdit::ExtraSelection chars;
+        chars.cursor = QTextCursor(block);
+        chars.cursor.setPosition(block.position() + range.start);
+        chars.cursor.setPosition(block.position() + range.start + range.length, QTextCursor::KeepAnchor);
+        chars.format.setBackground(rangeColor);
+        selections.append(chars);
+    }
+}
+
+void DiffDialog::previousHunk()
+{
+    const int first = firstVisibleRow();
+    const auto it = std::lower_bound(m_result.hunks.cbegin(), m_result.hunks.cend(), first,
+        [](const LineDiff::Hunk& hunk, int row) { return hunk.row < row; });
+    const int index = int(it - m_result.hunks.cbegin()) - 1;
+    scrollToHunk(index >= 0 ? index : int(m_result.hunks.size()) - 1);
+}
+
+void DiffDialog::nextHunk()
+{
+    const int first = firstVisibleRow();
+    const auto it = std::upper_bound(m_result.hunks.cbegin(), m_result.hunks.cend(), first,
+        [](int row, const LineDiff::Hunk& hunk) { return row < hunk.row; });
+    const int index = int(it - m_result.hunks.cbegin());
+    scrollToHunk(index < m_result.hunks.size() ? index : 0);
+}
+
+void DiffDialog::scrollToHunk(int index)
+{
+    if (index < 0 || index >= m_result.hunks.size()) return;
+
+    // 差异的第一行滚到视图顶部，另一侧随滚动条同步
+    const int row = m_result.hunks[index].row;
+    QScrollBar* scrollBar = m_leftView->verticalScrollBar();
+    scrollBar->setValue(qMin(row, scrollBar->maximum()));
+
+    QTextCursor cursor(m_leftView->document()->findBlockByNumber(row));
+    m_leftView->setTextCursor(cursor);
+    updateHighlights();
+}
@@ -0,0 +1,56 @@
+﻿#pragma once
+
+#include <QDialog>
+#include <QHash>
+#include <QTextEdit>
+
+#include "LineDiff.h"
+
+class QPlainTextEdit;
+class QLabel;
+class QPushButton;
+
+// 左右并排显示比较结果，两侧同步滚动；
+// 差异行的高亮和字符级比较只针对可见区域计算
+class DiffDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    DiffDialog(const LineDiff::Result& result, const QString& leftName, const QString& rightName,
+        QWidget* parent = nullptr);
+    ~DiffDialog() override = default;
+
+protected:
+    void resizeEvent(QResizeEvent* event) override;
+
+private slots:
+    void updateHighlights();
+    void previousHunk();
+    void nextHunk();
+
+private:
+    struct Refined {
+        QVector<LineDiff::Range> left;
+        QVector<LineDiff::Range> right;
+    };
+
+    QPlainTextEdit* createView(const QString& text);
+    void syncScrollBars(QPlainTextEdit* source, QPlainTextEdit* target);
+    int firstVisibleRow() const;
+    void scrollToHunk(int index);
+    const Refined& refined(int row);
+
+    void appendSelections(QList<QTextEdit::ExtraSelection>& selections, QPlainTextEdit* view, int row,
+        const QColor& color, const QVector<LineDiff::Range>* ranges, const QColor& rangeColor) const;
+
+private:
+    LineDiff::Result m_result;
+    QPlainTextEdit* m_leftView;
+    QPlainTextEdit* m_rightView;
+    QLabel* m_summaryLabel;
+    QPushButton* m_previousButton;
+    QPushButton* m_nextButton;
+    QHash<int, Refined> m_refined;  // 按对齐行缓存字符级比较结果
+    bool m_syncing;
+};
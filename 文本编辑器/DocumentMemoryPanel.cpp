@@ -0,0 +1,144 @@
+﻿#include "DocumentMemoryPanel.h"
+#include "DocumentTabs.h"
+#include "UndoManager.h"
+
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QSpinBox>
+#include <QLabel>
+#include <QTimer>
+#include <QLocale>
+
+DocumentMemoryPanel::DocumentMemoryPanel(DocumentTabs* tabs, UndoManager* undoManager, QWidget* parent)
+    : QDockWidget(tr("文档内存"), parent)
+    , m_tabs(tabs)
+    , m_undoManager(undoManager)
+    , m_table(new QTableWidget(0, 5, this))
+    , m_budgetBox(new QSpinBox(this))
+    , m_undoLimitBox(new QSpinBox(this))
+    , m_totalLabel(new QLabel(this))
+    , m_refreshTimer(new QTimer(this))
+{
+    setObjectName(QStringLiteral("DocumentMemoryPanel"));
+
+    QWidget* content = new QWidget(this);
+    QVBoxLayout* layout = new QVBoxLayout(content);
+
+    m_budgetBox->setRange(16, 64 * 1024);
+    m_budgetBox->setSingleStep(64);
+    m_budgetBox->setSuffix(QStringLiteral(" MB"));
+    m_budgetBox->setValue(int(m_tabs->memoryBudget() / (1024 * 1024)));
+    m_undoLimitBox->setRange(1, 16 * 1024);
+    m_undoLimitBox->setSingleStep(16);
+    m_undoLimitBox->setSuffix(QStringLiteral(" MB"));
+    m_undoLimitBox->setValue(int(m_undoManager->memoryLimit() / (1024 * 1024)));
+    m_undoLimitBox->setToolTip(tr("每个文档的撤销历史在内存中的上限，超出部分写入临时文件"));
+    QHBoxLayout* budgetRow = new QHBoxLayout();
+    budgetRow->addWidget(new QLabel(tr("内存预算:"), this));
+    budgetRow->addWidget(m_budgetBox);
+    budgetRow->addWidget(new QLabel(tr("撤销上限:"), this));
+    budgetRow->addWidget(m_undoLimitBox);
+    budgetRow->addStretch(1);
+    layout->addLayout(budgetRow);
+
+    m_table->setHorizontalHeaderLabels({ tr("文档"), tr("状态"), tr("字符数"), tr("估计内存"), tr("撤销历史") });
+    m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_table->verticalHeader()->hide();
+    m_table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    layout->addWidget(m_table, 1);
+    layout->addWidget(m_totalLabel);
+
+    setWidget(content);
+
+    m_refreshTimer->setInterval(REFRESH_INTERVAL_MS);
+    connect(m_refreshTimer, &QTimer::timeout, this, &DocumentMemoryPanel::refresh);
+    connect(this, &QDockWidget::visibilityChanged, this, [this](bool visible) {
+        if (visible) {
+            refresh();
+            m_refreshTimer->start();
+        }
+        else {
+            m_refreshTimer->stop();
+        }
+        });
+    connect(m_tabs, &DocumentTabs::tabsChanged, this, &DocumentMemoryPanel::refresh);
+    connect(m_budgetBox, &QSpinBox::valueChanged, this, &DocumentMemoryPanel::onBudgetChanged);
+    connect(m_undoLimitBox, &QSpinBox::valueChanged, this, &DocumentMemoryPanel::onUndoLimitChanged);
+    connect(m_table, &QTableWidget::cellActivated, this, &DocumentMemoryPanel::onCellActivated);
+    connect(m_table, &QTableWidget::cellDoubleClicked, this, &DocumentMemoryPanel::onCellActivated);
+}
+
+void DocumentMemoryPanel::refresh()
+{
+    if (!isVisible()) return;
+
+    const QVector<DocumentTabs::TabInfo> infos = m_tabs->tabInfos();
+    const QLocale locale;
+    const auto rightAligned = [](const QString& text) {
+        QTableWidgetItem* item = new QTableWidgetItem(text);
+        item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        return item;
+    };
+
+    qint64 total = 0;
+    qint64 undoTotal = 0;
+    qint64 spilledTotal = 0;
+    int loaded = 0;
+    m_table->setRowCount(int(infos.size()));
+    for (int row = 0; row < infos.size(); ++row) {
+        const DocumentTabs::TabInfo& info = infos[row];
+
+        QString state;
+        if (!info.loaded) state = tr("已释放");
+        else if (info.current) state = tr("当前");
+        else if (info.modified) state = tr("已修改");
+        else state = tr("已加载");
+
+        QTableWidgetItem* title = new QTableWidgetItem(info.title);
+        title->setToolTip(info.fileName);
+        m_table->setItem(row, 0, title);
+        m_table->setItem(row, 1, new QTableWidgetItem(state));
+        m_table->setItem(row, 2, rightAligned(info.loaded ? locale.toString(info.characters) : QString()));
+        m_table->setItem(row, 3, rightAligned(info.loaded ? locale.formattedDataSize(info.bytes) : QString()));
+
+        // 内存中的部分，括号里是写入临时文件的部分
+        QString undo;
+        if (info.loaded) {
+            undo = locale.formattedDataSize(info.undoBytes);
+            if (info.undoSpilledBytes > 0) {
+                undo += tr("（磁盘 %1）").arg(locale.formattedDataSize(info.undoSpilledBytes));
+            }
+        }
+        m_table->setItem(row, 4, rightAligned(undo));
+
+        total += info.bytes;
+        undoTotal += info.undoBytes;
+        spilledTotal += info.undoSpilledBytes;
+        if (info.loaded) ++loaded;
+    }
+
+    m_totalLabel->setText(tr("已加载 %1 / %2 个文档，约 %3，预算 %4；撤销历史 %5，临时文件 %6")
+        .arg(loaded).arg(infos.size())
+        .arg(locale.formattedDataSize(total), locale.formattedDataSize(m_tabs->memoryBudget()),
+            locale.formattedDataSize(undoTotal), locale.formattedDataSize(spilledTotal)));
+}
+
+void DocumentMemoryPanel::onBudgetChanged(int megabytes)
+{
+    m_tabs->setMemoryBudget(qint64(megabytes) * 1024 * 1024);
+}
+
+void DocumentMemoryPanel::onUndoLimitChanged(int megabytes)
+{
+    m_undoManager->setMemoryLimit(qint64(megabytes) * 1024 * 1024);
+    refresh();
+}
+
+void DocumentMemoryPanel::onCellActivated(int row, int column)
+{
+    Q_UNUSED(column);
+    m_tabs->setCurrentIndex(row);
+}
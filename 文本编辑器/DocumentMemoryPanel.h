@@ -0,0 +1,41 @@
+﻿#pragma once
+
+#include <QDockWidget>
+
+class DocumentTabs;
+class UndoManager;
+class QTableWidget;
+class QSpinBox;
+class QLabel;
+class QTimer;
+
+// 文档内存停靠面板：列出每个标签的加载状态、估计内存和撤销历史占用，
+// 可调整内存预算和撤销历史上限，双击切换到该标签
+class DocumentMemoryPanel : public QDockWidget
+{
+    Q_OBJECT
+
+public:
+    DocumentMemoryPanel(DocumentTabs* tabs, UndoManager* undoManager, QWidget* parent = nullptr);
+    ~DocumentMemoryPanel() override = default;
+
+private slots:
+    void refresh();
+
+    void onBudgetChanged(int megabytes);
+
+    void onUndoLimitChanged(int megabytes);
+
+    void onCellActivated(int row, int column);
+
+private:
+    DocumentTabs* m_tabs;
+    UndoManager* m_undoManager;
+    QTableWidget* m_table;
+    QSpinBox* m_budgetBox;
+    QSpinBox* m_undoLimitBox;
+    QLabel* m_totalLabel;
+    QTimer* m_refreshTimer;     // 面板可见时定期刷新，编辑会改变当前文档的大小
+
+    static constexpr int REFRESH_INTERVAL_MS = 1000;
+};
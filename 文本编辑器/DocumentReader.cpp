@@ -0,0 +1,151 @@
+﻿#include "DocumentReader.h"
+#include "Trace.h"
+
+#include <QFile>
+#include <QCoreApplication>
+
+#include <cstring>
+
+DocumentReader::Result DocumentReader::read(const QString& fileName)
+{
+    TRACE_SCOPE("DocumentReader::read");
+
+    Result result;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        result.errorString = file.errorString();
+        return result;
+    }
+
+    QByteArray chunk = file.read(CHUNK_SIZE);
+    result.compression = CompressionCodec::detect(chunk.constData(), chunk.size());
+
+    CompressionCodec codec(result.compression, CompressionCodec::Mode::Decompress);
+    if (!codec.isValid()) {
+        result.errorString = QCoreApplication::translate("DocumentReader", "无法初始化 %1 解压")
+            .arg(CompressionCodec::displayName(result.compression));
+        return result;
+    }
+
+    // 解压后的数据先攒够采样大小再检测编码，之后直接流式解码
+    QByteArray head;
+    QStringDecoder decoder;
+    bool decoding = false;
+
+    auto startDecoding = [&]() -> bool {
+        result.encoding = EncodingDetector::detect(head.constData(), head.size());
+
+        decoder = EncodingDetector::createDecoder(result.encoding);
+        if (!decoder.isValid()) {
+            result.errorString = QCoreApplication::translate("DocumentReader", "不支持的编码 %1")
+                .arg(EncodingDetector::displayName(result.encoding));
+            return false;
+        }
+
+        // 未压缩时按编码预估字符数，减少追加时的重新分配
+        if (result.compression == CompressionCodec::Format::None) {
+            const bool wide = EncodingDetector::isUtf16(result.encoding);
+            result.text.reserve(wide ? file.size() / 2 : file.size());
+        }
+
+        result.text += decoder(head);
+        head.clear();
+        decoding = true;
+        return true;
+    };
+
+    auto sink = [&](const char* data, qsizetype size) -> bool {
+        if (decoding) {
+            // 跨块的多字节序列由解码器内部状态衔接
+            result.text += decoder(QByteArrayView(data, size));
+            return true;
+        }
+        head.append(data, size);
+        return head.size() < EncodingDetector::SAMPLE_SIZE || startDecoding();
+    };
+
+    while (!chunk.isEmpty()) {
+        result.bytesRead += chunk.size();
+        if (!codec.process(chunk.constData(), chunk.size(), sink)) {
+            if (result.errorString.isEmpty()) result.errorString = codec.errorString();
+            return result;
+        }
+        if (file.atEnd()) break;
+
+        chunk = file.read(CHUNK_SIZE);
+        if (chunk.isEmpty()) {
+            result.errorString = file.errorString();
+            return result;
+        }
+    }
+
+    if (!codec.finish(sink)) {
+        result.errorString = codec.errorString();
+        return result;
+    }
+
+    // 文件小于采样大小
+    if (!decoding && !startDecoding()) {
+        return result;
+    }
+
+    // 与原先的文本模式读取一致，统一成 \n。换行在解码后的文本上判断，UTF-16 的 \r\n 不是这两个字节
+    if (result.text.contains(QLatin1Char('\r'))) {
+        result.crlf = result.text.contains(QStringLiteral("\r\n"));
+        result.text.replace(QStringLiteral("\r\n"), QStringLiteral("\n"));
+    }
+
+    result.ok = true;
+    return result;
+}
+
+DocumentReader::Result DocumentReader::readMapped(const QString& fileName, bool rejectBinary)
+{
+    Result result;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        result.errorString = file.errorString();
+        return result;
+    }
+
+    const qint64 size = file.size();
+    if (size == 0) {
+        result.ok = true;
+        return result;
+    }
+
+    const char* data = reinterpret_cast<const char*>(file.map(0, size));
+    if (!data || CompressionCodec::detect(data, qsizetype(qMin<qint64>(size, 16))) != CompressionCodec::Format::None) {
+        file.close();
+        return read(fileName);
+    }
+
+    result.bytesRead = size;
+    result.encoding = EncodingDetector::detect(data, qsizetype(qMin<qint64>(size, EncodingDetector::SAMPLE_SIZE)));
+
+    const bool wide = EncodingDetector::isUtf16(result.encoding);
+    if (rejectBinary && !wide && std::memchr(data, 0, size_t(qMin(size, BINARY_SNIFF_SIZE)))) {
+        result.binary = true;
+        result.errorString = QCoreApplication::translate("DocumentReader", "二进制文件");
+        return result;
+    }
+
+    QStringDecoder decoder = EncodingDetector::createDecoder(result.encoding);
+    result.text = decoder.decode(QByteArrayView(data, qsizetype(size)));
+    if (decoder.hasError()) {
+        result.text.clear();
+        result.errorString = QCoreApplication::translate("DocumentReader", "文件包含无法按 %1 解码的字节")
+            .arg(EncodingDetector::displayName(result.encoding));
+        return result;
+    }
+
+    if (result.text.contains(QLatin1Char('\r'))) {
+        result.crlf = result.text.contains(QStringLiteral("\r\n"));
+        result.text.replace(QStringLiteral("\r\n"), QStringLiteral("\n"));
+    }
+
+    result.ok = true;
+    return result;
+}
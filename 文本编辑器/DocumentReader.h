@@ -0,0 +1,35 @@
+﻿#pragma once
+
+#include <QString>
+
+#include "EncodingDetector.h"
+#include "CompressionCodec.h"
+
+class DocumentReader
+{
+public:
+    struct Result {
+        bool ok = false;
+        QString text;                 // 换行统一为 \n
+        EncodingDetector::Encoding encoding = EncodingDetector::Encoding::Utf8;
+        bool crlf = false;            // 原文件使用 \r\n 换行
+        qint64 bytesRead = 0;         // 已读取的文件字节数（压缩文件为压缩后的大小）
+        CompressionCodec::Format compression = CompressionCodec::Format::None;
+        bool binary = false;          // 按 rejectBinary 识别为二进制而跳过
+        QString errorString;
+    };
+
+    DocumentReader() = default;
+    ~DocumentReader() = default;
+
+    // 按魔数识别压缩格式并流式解压，采样解压后的头部检测编码，然后分块流式解码（可在工作线程调用）
+    static Result read(const QString& fileName);
+
+    // 批量处理用：普通文件映射到内存一次解码，含无法解码的字节时失败；压缩文件退回 read()。
+    // rejectBinary 时头部含 NUL 字节（UTF-16 除外）的文件直接跳过
+    static Result readMapped(const QString& fileName, bool rejectBinary = false);
+
+private:
+    static constexpr qint64 CHUNK_SIZE = 1 << 20;  // 每次读取解码的字节数
+    static constexpr qint64 BINARY_SNIFF_SIZE = 8 * 1024;  // 判断二进制文件时检查的字节数
+};
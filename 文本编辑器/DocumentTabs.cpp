@@ -0,0 +1,367 @@
+﻿#include "DocumentTabs.h"
+#include "UndoHistory.h"
+#include "MemoryAccounting.h"
+
+#include <QTextDocument>
+#include <QTextCursor>
+#include <QScrollBar>
+#include <QFileInfo>
+#include <QSignalBlocker>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrentRun>
+
+DocumentTabs::DocumentTabs(EditorHost* editor, FileManager* fileManager, QWidget* parent)
+    : QTabBar(parent)
+    , m_editor(editor)
+    , m_fileManager(fileManager)
+    , m_current(0)
+    , m_useCounter(0)
+    , m_memoryBudget(DEFAULT_MEMORY_BUDGET)
+    , m_switching(false)
+{
+    setTabsClosable(true);
+    setMovable(true);
+    setDocumentMode(true);
+    setExpanding(false);
+    setElideMode(Qt::ElideMiddle);
+
+    // 编辑器现有的文档成为第一个标签，改由本类持有
+    Tab tab;
+    tab.mode = m_editor->mode();
+    tab.lastUsed = ++m_useCounter;
+    adoptDocument(tab, m_editor->document());
+    m_tabs.append(tab);
+    {
+        const QSignalBlocker blocker(this);
+        addTab(QString());
+    }
+    updateTitles();
+
+    connect(this, &QTabBar::currentChanged, this, &DocumentTabs::onCurrentChanged);
+    connect(this, &QTabBar::tabMoved, this, &DocumentTabs::onTabMoved);
+    connect(this, &QTabBar::tabCloseRequested, this, &DocumentTabs::closeTab);
+    connect(m_editor, &EditorHost::documentReplaced, this, &DocumentTabs::onDocumentReplaced);
+    connect(m_fileManager, &FileManager::modificationChanged, this, &DocumentTabs::updateTitles);
+}
+
+void DocumentTabs::newTab()
+{
+    storeCurrent();
+
+    Tab tab;
+    tab.mode = m_editor->preferredMode();
+    adoptDocument(tab, EditorHost::createDocument(tab.mode, m_editor));
+    m_tabs.append(tab);
+    {
+        const QSignalBlocker blocker(this);
+        addTab(QString());
+        setCurrentIndex(count() - 1);
+    }
+    activate(count() - 1);
+    m_fileManager->showStatusMessage(tr("已新建空文档"));
+}
+
+bool DocumentTabs::openFile(const QString& fileName)
+{
+    const QString fileToOpen = fileName.isEmpty() ? m_fileManager->askOpenFileName() : fileName;
+    if (fileToOpen.isEmpty()) return false;
+
+    return openInTab(fileToOpen, nullptr);
+}
+
+void DocumentTabs::openFileInBackground(const QString& fileName)
+{
+    QFutureWatcher<DocumentReader::Result>* watcher = new QFutureWatcher<DocumentReader::Result>(this);
+    connect(watcher, &QFutureWatcher<DocumentReader::Result>::finished, this, [this, watcher, fileName]() {
+        watcher->deleteLater();
+        const DocumentReader::Result result = watcher->result();
+        emit backgroundOpenFinished(fileName, openInTab(fileName, &result));
+        });
+    watcher->setFuture(QtConcurrent::run(&DocumentReader::read, fileName));
+}
+
+bool DocumentTabs::openInTab(const QString& fileToOpen, const DocumentReader::Result* preloaded)
+{
+    const int existing = findFile(fileToOpen);
+    if (existing >= 0) {
+        setCurrentIndex(existing);
+        return true;
+    }
+
+    // 当前是未修改的空白文档时直接在其中打开
+    const QTextDocument* document = m_editor->document();
+    const bool reuse = m_fileManager->currentFileName().isEmpty()
+        && !document->isModified() && document->isEmpty();
+    const int previous = m_current;
+    if (!reuse) newTab();
+
+    const bool opened = preloaded
+        ? m_fileManager->openFile(fileToOpen, *preloaded)
+        : m_fileManager->openFile(fileToOpen);
+    if (opened) {
+        enforceBudget();
+        updateTitles();
+        return true;
+    }
+
+    // 读取失败时去掉新开的标签，回到原来的文档
+    if (!reuse) {
+        closeTab(m_current);
+        setCurrentIndex(previous);
+    }
+    return false;
+}
+
+bool DocumentTabs::closeTab(int index)
+{
+    if (index < 0 || index >= m_tabs.size()) return false;
+
+    // 有修改的标签先切换过去，询问和保存沿用当前文档的流程
+    if (m_tabs[index].document && m_tabs[index].document->isModified()) {
+        setCurrentIndex(index);
+        if (!m_fileManager->maybeSave()) return false;
+    }
+
+    if (m_tabs.size() == 1) {
+        newTab();
+    }
+    if (index == m_current) {
+        // 先切到相邻的标签，被关闭的文档不再留在编辑器里
+        setCurrentIndex(index + 1 < m_tabs.size() ? index + 1 : index - 1);
+    }
+
+    const Tab tab = m_tabs.takeAt(index);
+    if (index < m_current) --m_current;
+    {
+        const QSignalBlocker blocker(this);
+        removeTab(index);
+        setCurrentIndex(m_current);
+    }
+    if (tab.document) tab.document->deleteLater();
+
+    updateTitles();
+    return true;
+}
+
+bool DocumentTabs::maybeSaveAll()
+{
+    // 与关闭标签相同，切换过去后沿用当前文档的询问和保存流程
+    for (int i = 0; i < m_tabs.size(); ++i) {
+        if (!m_tabs[i].document || !m_tabs[i].document->isModified()) continue;
+        setCurrentIndex(i);
+        if (!m_fileManager->maybeSave()) return false;
+    }
+    return true;
+}
+
+void DocumentTabs::releaseFile(const QString& fileName)
+{
+    const int index = findFile(fileName);
+    if (index < 0 || index == m_current) return;
+
+    const QTextDocument* document = m_tabs[index].document;
+    if (document && !document->isModified()) {
+        unload(index);
+        updateTitles();
+    }
+}
+
+QVector<DocumentTabs::TabInfo> DocumentTabs::tabInfos() const
+{
+    QVector<TabInfo> infos;
+    infos.reserve(m_tabs.size());
+    for (int i = 0; i < m_tabs.size(); ++i) {
+        const QTextDocument* document = m_tabs[i].document;
+
+        TabInfo info;
+        info.title = tabText(i);
+        info.fileName = fileNameAt(i);
+        info.loaded = document != nullptr;
+        info.modified = document && document->isModified();
+        info.current = i == m_current;
+        info.characters = document ? document->characterCount() - 1 : 0;
+        info.bytes = document ? estimateBytes(document) : 0;
+        info.formatBytes = document ? estimateFormatBytes(document) : 0;
+        if (const UndoHistory* history = UndoHistory::of(document)) {
+            info.undoBytes = history->memoryBytes();
+            info.undoSpilledBytes = history->spilledBytes();
+        }
+        infos.append(info);
+    }
+    return infos;
+}
+
+void DocumentTabs::setMemoryBudget(qint64 bytes)
+{
+    m_memoryBudget = bytes;
+    enforceBudget();
+    updateTitles();
+}
+
+qint64 DocumentTabs::estimateBytes(const QTextDocument* document)
+{
+    // 文本按 UTF-16 存放，另加每个块的固定开销；撤销历史无法从外部得知，不计入
+    return qint64(document->characterCount()) * qint64(sizeof(QChar))
+        + qint64(document->blockCount()) * BYTES_PER_BLOCK;
+}
+
+qint64 DocumentTabs::estimateFormatBytes(const QTextDocument* document)
+{
+    // 格式对象按属性共享，数量通常很少；逐字设置过格式的富文本会多出很多
+    return qint64(document->allFormats().size()) * BYTES_PER_FORMAT;
+}
+
+void DocumentTabs::onCurrentChanged(int index)
+{
+    if (m_switching || index < 0 || index >= m_tabs.size() || index == m_current) return;
+
+    storeCurrent();
+    activate(index);
+}
+
+void DocumentTabs::onTabMoved(int from, int to)
+{
+    m_tabs.move(from, to);
+
+    if (m_current == from) {
+        m_current = to;
+    }
+    else if (from < m_current && to >= m_current) {
+        --m_current;
+    }
+    else if (from > m_current && to <= m_current) {
+        ++m_current;
+    }
+}
+
+void DocumentTabs::onDocumentReplaced(QTextDocument* document)
+{
+    // 切换模式或按大小重新加载时编辑器换了新文档，当前标签改持有新文档
+    if (m_switching) return;
+
+    Tab& tab = m_tabs[m_current];
+    if (tab.document == document) return;
+
+    // 旧文档此时还装在隐藏的编辑器里，回到事件循环再释放
+    QTextDocument* old = tab.document;
+    adoptDocument(tab, document);
+    if (old) old->deleteLater();
+}
+
+void DocumentTabs::updateTitles()
+{
+    for (int i = 0; i < m_tabs.size(); ++i) {
+        const QString fileName = fileNameAt(i);
+        const QTextDocument* document = m_tabs[i].document;
+        const QString title = fileName.isEmpty() ? tr("未命名") : QFileInfo(fileName).fileName();
+
+        setTabText(i, document && document->isModified() ? title + QLatin1Char('*') : title);
+        setTabToolTip(i, document ? fileName : tr("%1\n已释放，激活时重新读取").arg(fileName));
+        setTabTextColor(i, document ? QColor() : palette().color(QPalette::Disabled, QPalette::WindowText));
+    }
+    emit tabsChanged();
+}
+
+QString DocumentTabs::fileNameAt(int index) const
+{
+    // 当前标签的状态在 FileManager 中，切走时才存回标签
+    return index == m_current ? m_fileManager->currentFileName() : m_tabs[index].state.fileName;
+}
+
+int DocumentTabs::findFile(const QString& fileName) const
+{
+    const QFileInfo target(fileName);
+    for (int i = 0; i < m_tabs.size(); ++i) {
+        const QString name = fileNameAt(i);
+        if (!name.isEmpty() && QFileInfo(name) == target) return i;
+    }
+    return -1;
+}
+
+void DocumentTabs::adoptDocument(Tab& tab, QTextDocument* document)
+{
+    // 文档不能由编辑器控件持有，否则控件换文档时会把它删掉；
+    // 挂在 EditorHost 下，退出时控件都已销毁后才释放
+    document->setParent(m_editor);
+    tab.document = document;
+    connect(document, &QTextDocument::modificationChanged, this, &DocumentTabs::updateTitles);
+}
+
+void DocumentTabs::storeCurrent()
+{
+    Tab& tab = m_tabs[m_current];
+    tab.state = m_fileManager->detachDocument();
+    tab.mode = m_editor->mode();
+    tab.segmented = m_editor->hasLongLines();
+    tab.cursorPosition = m_editor->textCursor().position();
+    tab.scrollValue = m_editor->verticalScrollBar()->value();
+    tab.lastUsed = ++m_useCounter;
+}
+
+void DocumentTabs::activate(int index)
+{
+    m_current = index;
+    Tab& tab = m_tabs[index];
+    tab.lastUsed = ++m_useCounter;
+
+    const bool reload = !tab.document;
+    if (reload) {
+        tab.mode = m_editor->preferredMode();
+        tab.segmented = false;
+        adoptDocument(tab, EditorHost::createDocument(tab.mode, m_editor));
+    }
+
+    m_switching = true;
+    m_editor->setDocument(tab.document, tab.mode, tab.segmented);
+    m_switching = false;
+
+    if (reload) {
+        // 按文件大小重新选择模式，读取失败时留下空白文档
+        const QString fileName = tab.state.fileName;
+        m_fileManager->attachDocument(FileManager::DocumentState());
+        m_fileManager->openFile(fileName);
+    }
+    else {
+        m_fileManager->attachDocument(tab.state);
+    }
+
+    QTextCursor cursor(m_editor->document());
+    cursor.setPosition(qBound(0, tab.cursorPosition, m_editor->document()->characterCount() - 1));
+    m_editor->setTextCursor(cursor);
+    m_editor->verticalScrollBar()->setValue(tab.scrollValue);
+    m_editor->setFocus();
+
+    enforceBudget();
+    updateTitles();
+}
+
+void DocumentTabs::unload(int index)
+{
+    Tab& tab = m_tabs[index];
+    tab.document->deleteLater();
+    tab.document = nullptr;
+}
+
+void DocumentTabs::enforceBudget()
+{
+    qint64 total = 0;
+    for (const Tab& tab : m_tabs) {
+        if (tab.document) total += estimateBytes(tab.document);
+    }
+    MemoryAccounting::sample(MemoryAccounting::Tag::Documents, total);
+
+    // 只释放能从磁盘原样读回的文档：有文件名、没有修改、不是当前标签
+    while (total > m_memoryBudget) {
+        int victim = -1;
+        for (int i = 0; i < m_tabs.size(); ++i) {
+            const Tab& tab = m_tabs[i];
+            if (i == m_current || !tab.document || tab.document->isModified() || tab.state.fileName.isEmpty()) continue;
+            if (victim < 0 || tab.lastUsed < m_tabs[victim].lastUsed) victim = i;
+        }
+        if (victim < 0) break;
+
+        total -= estimateBytes(m_tabs[victim].document);
+        unload(victim);
+        MemoryAccounting::sample(MemoryAccounting::Tag::Documents, total);
+    }
+}
@@ -0,0 +1,120 @@
+﻿#pragma once
+
+#include <QTabBar>
+#include <QVector>
+
+#include "EditorHost.h"
+#include "FileManager.h"
+
+class QTextDocument;
+
+// 多文档标签：每个标签持有自己的 QTextDocument，切换时把文档装进编辑器，
+// 文件名、编码等状态由 FileManager 保存和恢复。
+// 已加载文档的估计内存超过预算时，最久未使用且没有修改的后台标签释放文档，
+// 只保留文件名和光标位置，再次激活时重新读取
+class DocumentTabs : public QTabBar
+{
+    Q_OBJECT
+
+public:
+    // 内存视图中的一行
+    struct TabInfo {
+        QString title;
+        QString fileName;
+        bool loaded = false;
+        bool modified = false;
+        bool current = false;
+        int characters = 0;
+        qint64 bytes = 0;       // 估计的内存占用，已释放时为 0
+        qint64 formatBytes = 0; // 文字格式的估计占用
+        qint64 undoBytes = 0;   // 撤销历史在内存中的部分
+        qint64 undoSpilledBytes = 0;    // 撤销历史写入临时文件的部分
+    };
+
+    DocumentTabs(EditorHost* editor, FileManager* fileManager, QWidget* parent = nullptr);
+    ~DocumentTabs() override = default;
+
+    // 新建空白文档标签并切换过去
+    void newTab();
+
+    // 已打开的文件切换到它的标签，否则在新标签中打开；
+    // 当前标签是未修改的空白文档时直接复用。文件名为空时弹出打开对话框
+    bool openFile(const QString& fileName = QString());
+
+    // 在工作线程读取和解码，窗口保持响应，读完后与 openFile 一样放进标签。
+    // 用于启动时打开命令行给出的文件
+    void openFileInBackground(const QString& fileName);
+
+    // 关闭标签，有未保存的修改时先询问；关闭最后一个标签时留下一个空白文档
+    bool closeTab(int index);
+
+    // 退出前逐个询问有修改的标签，用户取消时返回 false。
+    // 已释放的标签没有修改，不需要询问
+    bool maybeSaveAll();
+
+    // 文件在磁盘上被改写后，没有修改的后台标签释放文档，下次激活时重新读取
+    void releaseFile(const QString& fileName);
+
+    QVector<TabInfo> tabInfos() const;
+
+    qint64 memoryBudget() const { return m_memoryBudget; }
+
+    void setMemoryBudget(qint64 bytes);
+
+    // 按字符数和块数估计文档占用的内存
+    static qint64 estimateBytes(const QTextDocument* document);
+
+    // 按格式对象的个数估计文字格式占用的内存
+    static qint64 estimateFormatBytes(const QTextDocument* document);
+
+    static constexpr qint64 DEFAULT_MEMORY_BUDGET = 512LL * 1024 * 1024;
+
+signals:
+    // 标签增删、切换、释放或修改状态变化
+    void tabsChanged();
+
+    // openFileInBackground 读完文件并打开（或失败）后发出
+    void backgroundOpenFinished(const QString& fileName, bool opened);
+
+private slots:
+    void onCurrentChanged(int index);
+
+    void onTabMoved(int from, int to);
+
+    void onDocumentReplaced(QTextDocument* document);
+
+    void updateTitles();
+
+private:
+    struct Tab {
+        QTextDocument* document = nullptr;  // 已释放时为空
+        FileManager::DocumentState state;
+        EditorHost::Mode mode = EditorHost::Mode::RichText;
+        bool segmented = false;
+        int cursorPosition = 0;
+        int scrollValue = 0;
+        quint64 lastUsed = 0;
+    };
+
+    QString fileNameAt(int index) const;
+    int findFile(const QString& fileName) const;
+    // preloaded 为空时由 FileManager 读取文件
+    bool openInTab(const QString& fileName, const DocumentReader::Result* preloaded);
+    void adoptDocument(Tab& tab, QTextDocument* document);
+    void storeCurrent();
+    void activate(int index);
+    void unload(int index);
+    void enforceBudget();
+
+private:
+    EditorHost* m_editor;
+    FileManager* m_fileManager;
+    QVector<Tab> m_tabs;        // 与标签顺序一致
+    int m_current;
+    quint64 m_useCounter;       // 最近使用的顺序
+    qint64 m_memoryBudget;
+    bool m_switching;           // 正在由本类替换编辑器中的文档
+
+    static constexpr qint64 BYTES_PER_BLOCK = 160;  // 每个块的片段、布局等对象的近似开销
+    static constexpr qint64 BYTES_PER_FORMAT = 256; // 每个格式对象及其属性表的近似开销
+};
@@ -0,0 +1,72 @@
+﻿#include "DocumentWriter.h"
+#include "Trace.h"
+
+#include <QSaveFile>
+#include <QCoreApplication>
+
+DocumentWriter::Result DocumentWriter::writeAtomically(const QString& fileName, const QString& content,
+    EncodingDetector::Encoding encoding, bool crlf, CompressionCodec::Format compression)
+{
+    TRACE_SCOPE("DocumentWriter::writeAtomically");
+
+    Result result;
+
+    // QSaveFile 先写入同目录下的临时文件，commit() 时刷新、同步到磁盘再重命名，
+    // 中途崩溃不会破坏原文件
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        result.errorString = file.errorString();
+        return result;
+    }
+
+    QStringEncoder encoder = EncodingDetector::createEncoder(encoding);
+    if (!encoder.isValid()) {
+        result.errorString = QCoreApplication::translate("DocumentWriter", "不支持的编码 %1")
+            .arg(EncodingDetector::displayName(encoding));
+        file.cancelWriting();
+        return result;
+    }
+
+    CompressionCodec codec(compression, CompressionCodec::Mode::Compress);
+    if (!codec.isValid()) {
+        result.errorString = QCoreApplication::translate("DocumentWriter", "无法初始化 %1 压缩")
+            .arg(CompressionCodec::displayName(compression));
+        file.cancelWriting();
+        return result;
+    }
+
+    auto sink = [&](const char* data, qsizetype size) -> bool {
+        if (file.write(data, size) != size) return false;
+        result.bytesWritten += size;
+        return true;
+    };
+
+    // 分块编码（需要时再压缩），避免同时持有完整的 QString 和完整的编码副本；
+    // 换行按原文件风格在块内转换，不使用文本模式以免破坏 UTF-16
+    const QStringView text(content);
+    for (qsizetype pos = 0; pos < text.size(); pos += CHUNK_CHARS) {
+        const QStringView chunk = text.mid(pos, CHUNK_CHARS);
+        const QByteArray bytes = crlf
+            ? QByteArray(encoder(chunk.toString().replace(QLatin1Char('\n'), QStringLiteral("\r\n"))))
+            : QByteArray(encoder(chunk));
+        if (!codec.process(bytes.constData(), bytes.size(), sink)) {
+            result.errorString = codec.errorString().isEmpty() ? file.errorString() : codec.errorString();
+            file.cancelWriting();
+            return result;
+        }
+    }
+
+    if (!codec.finish(sink)) {
+        result.errorString = codec.errorString().isEmpty() ? file.errorString() : codec.errorString();
+        file.cancelWriting();
+        return result;
+    }
+
+    if (!file.commit()) {
+        result.errorString = file.errorString();
+        return result;
+    }
+
+    result.ok = true;
+    return result;
+}
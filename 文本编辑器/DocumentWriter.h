@@ -0,0 +1,28 @@
+﻿#pragma once
+
+#include <QString>
+
+#include "EncodingDetector.h"
+#include "CompressionCodec.h"
+
+class DocumentWriter
+{
+public:
+    struct Result {
+        bool ok = false;
+        qint64 bytesWritten = 0;
+        QString errorString;
+    };
+
+    DocumentWriter() = default;
+    ~DocumentWriter() = default;
+
+    // 分块编码并写入临时文件，同步到磁盘后原子替换目标文件（可在工作线程调用）
+    static Result writeAtomically(const QString& fileName, const QString& content,
+        EncodingDetector::Encoding encoding = EncodingDetector::Encoding::Utf8,
+        bool crlf = false,
+        CompressionCodec::Format compression = CompressionCodec::Format::None);
+
+private:
+    static constexpr qsizetype CHUNK_CHARS = 1 << 20;  // 每次编码的字符数
+};
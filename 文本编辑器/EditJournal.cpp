@@ -0,0 +1,335 @@
+﻿#include "EditJournal.h"
+
+#include <QTextDocument>
+#include <QTextCursor>
+#include <QTimer>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <array>
+
+namespace {
+
+constexpr char JOURNAL_MAGIC[4] = { 'Q', 'T', 'E', 'J' };
+constexpr quint32 JOURNAL_VERSION = 1;
+constexpr int HEADER_SIZE = 32;         // 魔数、版本、基准大小、基准修改时间、校验
+constexpr int RECORD_HEADER_SIZE = 8;   // 负载长度 + CRC32
+constexpr int RECORD_FIXED_SIZE = 8;    // 位置 + 删除字符数
+
+quint32 crc32(const char* data, qsizetype size)
+{
+    static const auto table = []() {
+        std::array<quint32, 256> t{};
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    quint32 crc = 0xFFFFFFFFu;
+    for (qsizetype i = 0; i < size; ++i) {
+        crc = table[(crc ^ static_cast<uchar>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+void appendUInt32(QByteArray& out, quint32 value)
+{
+    char bytes[4];
+    qToLittleEndian(value, bytes);
+    out.append(bytes, 4);
+}
+
+void appendInt64(QByteArray& out, qint64 value)
+{
+    char bytes[8];
+    qToLittleEndian(value, bytes);
+    out.append(bytes, 8);
+}
+
+quint32 readUInt32(const char* data)
+{
+    return qFromLittleEndian<quint32>(data);
+}
+
+// offset 处记录的结尾，记录被截断或校验不符时返回 -1
+qsizetype recordEnd(const QByteArray& data, qsizetype offset)
+{
+    if (offset + RECORD_HEADER_SIZE > data.size()) return -1;
+
+    const quint32 length = readUInt32(data.constData() + offset);
+    const quint32 checksum = readUInt32(data.constData() + offset + 4);
+    if (length < RECORD_FIXED_SIZE || offset + RECORD_HEADER_SIZE + qsizetype(length) > data.size()) return -1;
+    if (crc32(data.constData() + offset + RECORD_HEADER_SIZE, length) != checksum) return -1;
+    return offset + RECORD_HEADER_SIZE + length;
+}
+
+} // namespace
+
+EditJournal::EditJournal(QTextDocument* document, QObject* parent)
+    : QObject(parent)
+    , m_document(document)
+    , m_loggedBytes(0)
+    , m_flushTimer(new QTimer(this))
+    , m_suspended(false)
+{
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(FLUSH_INTERVAL_MS);
+    connect(m_flushTimer, &QTimer::timeout, this, &EditJournal::flush);
+
+    if (m_document) {
+        connect(m_document, &QTextDocument::contentsChange, this, &EditJournal::onContentsChange);
+    }
+}
+
+EditJournal::~EditJournal()
+{
+    flush();
+}
+
+void EditJournal::setDocument(QTextDocument* document)
+{
+    if (document == m_document) return;
+
+    if (m_document) {
+        disconnect(m_document, &QTextDocument::contentsChange, this, &EditJournal::onContentsChange);
+    }
+    m_document = document;
+    if (m_document) {
+        connect(m_document, &QTextDocument::contentsChange, this, &EditJournal::onContentsChange);
+    }
+}
+
+QString EditJournal::journalPathFor(const QString& fileName)
+{
+    // 日志与原文件放在同一目录，隐藏文件名避免干扰
+    const QFileInfo info(fileName);
+    return info.absoluteDir().filePath(QStringLiteral(".%1.journal").arg(info.fileName()));
+}
+
+QByteArray EditJournal::baseHeader(const QString& fileName)
+{
+    // 以磁盘上文件的大小和修改时间标识日志的基准内容
+    const QFileInfo info(fileName);
+
+    QByteArray header;
+    header.reserve(HEADER_SIZE);
+    header.append(JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    appendUInt32(header, JOURNAL_VERSION);
+    appendInt64(header, info.size());
+    appendInt64(header, info.lastModified().toMSecsSinceEpoch());
+    appendUInt32(header, crc32(header.constData(), header.size()));
+    appendUInt32(header, 0);
+    return header;
+}
+
+bool EditJournal::hasJournal(const QString& fileName)
+{
+    if (fileName.isEmpty()) return false;
+
+    QFile file(journalPathFor(fileName));
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    return file.read(HEADER_SIZE) == baseHeader(fileName) && file.size() > HEADER_SIZE;
+}
+
+void EditJournal::attach(const QString& fileName, bool keepExisting)
+{
+    flush();
+    m_file.close();
+    m_buffer.clear();
+    m_loggedBytes = 0;
+    m_fileName = fileName;
+
+    if (m_fileName.isEmpty()) return;
+
+    if (keepExisting) {
+        openJournal(true);
+    }
+    else {
+        // 没有编辑之前不创建日志文件
+        QFile::remove(journalPathFor(m_fileName));
+    }
+}
+
+void EditJournal::discard()
+{
+    m_flushTimer->stop();
+    m_buffer.clear();
+    m_file.close();
+    m_loggedBytes = 0;
+
+    if (!m_fileName.isEmpty()) {
+        QFile::remove(journalPathFor(m_fileName));
+    }
+    m_fileName.clear();
+}
+
+bool EditJournal::openJournal(bool keepExisting)
+{
+    m_file.setFileName(journalPathFor(m_fileName));
+
+    if (keepExisting && m_file.exists()) {
+        if (!m_file.open(QIODevice::ReadWrite)) return false;
+
+        // 回放停在第一条损坏的记录处，接在它后面的记录永远回放不到，
+        // 先截掉最后一条有效记录之后的内容再追加
+        const QByteArray data = m_file.readAll();
+        if (data.size() >= HEADER_SIZE) {
+            qsizetype end = HEADER_SIZE;
+            for (qsizetype next = recordEnd(data, end); next > 0; next = recordEnd(data, end)) {
+                end = next;
+            }
+            if ((end < data.size() && !m_file.resize(end)) || !m_file.seek(end)) {
+                m_file.close();
+                return false;
+            }
+            m_loggedBytes = end - HEADER_SIZE;
+            return true;
+        }
+        m_file.close();
+    }
+
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+    m_file.write(baseHeader(m_fileName));
+    m_loggedBytes = 0;
+    return true;
+}
+
+void EditJournal::flush()
+{
+    m_flushTimer->stop();
+    if (m_buffer.isEmpty() || m_fileName.isEmpty()) return;
+
+    if (!m_file.isOpen() && !openJournal(false)) {
+        m_buffer.clear();
+        return;
+    }
+
+    if (m_file.write(m_buffer) == m_buffer.size()) {
+        m_loggedBytes += m_buffer.size();
+    }
+    m_file.flush();
+    m_buffer.clear();
+}
+
+void EditJournal::rebase(const QString& fileName, qint64 checkpoint)
+{
+    flush();
+
+    // 取出保存快照之后追加的记录
+    QByteArray tail;
+    if (m_file.isOpen()) {
+        m_file.close();
+        QFile reader(m_file.fileName());
+        if (reader.open(QIODevice::ReadOnly) && reader.seek(HEADER_SIZE + checkpoint)) {
+            tail = reader.readAll();
+        }
+    }
+
+    if (!m_fileName.isEmpty()) {
+        QFile::remove(journalPathFor(m_fileName));
+    }
+    m_fileName = fileName;
+    m_loggedBytes = 0;
+
+    if (m_fileName.isEmpty() || tail.isEmpty()) return;
+
+    // 以新的基准重写日志
+    QSaveFile rewritten(journalPathFor(m_fileName));
+    if (!rewritten.open(QIODevice::WriteOnly)) return;
+    rewritten.write(baseHeader(m_fileName));
+    rewritten.write(tail);
+    if (rewritten.commit()) {
+        openJournal(true);
+    }
+}
+
+void EditJournal::onContentsChange(int position, int charsRemoved, int charsAdded)
+{
+    if (m_suspended || m_fileName.isEmpty() || !m_document) return;
+
+    // 整篇替换时 Qt 会把末尾的段落分隔符一并计入，这里裁掉
+    const int docEnd = m_document->characterCount() - 1;
+    if (position + charsAdded > docEnd) {
+        const int over = position + charsAdded - docEnd;
+        charsAdded -= over;
+        charsRemoved = qMax(0, charsRemoved - over);
+    }
+
+    QString inserted;
+    if (charsAdded > 0) {
+        QTextCursor cursor(m_document);
+        cursor.setPosition(position);
+        cursor.setPosition(position + charsAdded, QTextCursor::KeepAnchor);
+        inserted = cursor.selectedText();
+        inserted.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+    }
+
+    appendRecord(position, charsRemoved, inserted);
+}
+
+void EditJournal::appendRecord(int position, int charsRemoved, const QString& inserted)
+{
+    // 记录格式：[负载长度][CRC32][位置][删除字符数][插入文本 UTF-8]
+    QByteArray payload;
+    payload.reserve(RECORD_FIXED_SIZE + inserted.size() * 3);
+    appendUInt32(payload, static_cast<quint32>(position));
+    appendUInt32(payload, static_cast<quint32>(charsRemoved));
+    payload.append(inserted.toUtf8());
+
+    appendUInt32(m_buffer, static_cast<quint32>(payload.size()));
+    appendUInt32(m_buffer, crc32(payload.constData(), payload.size()));
+    m_buffer.append(payload);
+
+    if (m_buffer.size() >= FLUSH_THRESHOLD) {
+        flush();
+    }
+    else if (!m_flushTimer->isActive()) {
+        m_flushTimer->start();
+    }
+}
+
+int EditJournal::replay(const QString& fileName, QTextDocument* document)
+{
+    QFile file(journalPathFor(fileName));
+    if (!document || !file.open(QIODevice::ReadOnly)) return -1;
+
+    const QByteArray data = file.readAll();
+    if (data.size() < HEADER_SIZE || data.left(HEADER_SIZE) != baseHeader(fileName)) {
+        return -1;
+    }
+
+    QTextCursor cursor(document);
+    cursor.beginEditBlock();
+
+    // 逐条校验并回放，遇到截断或损坏的记录（写入时崩溃）就停止
+    int replayed = 0;
+    qsizetype offset = HEADER_SIZE;
+    for (qsizetype end = recordEnd(data, offset); end > 0; end = recordEnd(data, offset)) {
+        const quint32 length = readUInt32(data.constData() + offset);
+        const char* payload = data.constData() + offset + RECORD_HEADER_SIZE;
+
+        const int docEnd = document->characterCount() - 1;
+        const int position = qMin(static_cast<int>(readUInt32(payload)), docEnd);
+        const int removed = qMin(static_cast<int>(readUInt32(payload + 4)), docEnd - position);
+        const QString inserted = QString::fromUtf8(payload + RECORD_FIXED_SIZE, length - RECORD_FIXED_SIZE);
+
+        cursor.setPosition(position);
+        cursor.setPosition(position + removed, QTextCursor::KeepAnchor);
+        cursor.insertText(inserted);
+
+        ++replayed;
+        offset = end;
+    }
+
+    cursor.endEditBlock();
+    return replayed;
+}
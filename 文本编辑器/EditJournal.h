@@ -0,0 +1,68 @@
+﻿#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QFile>
+
+class QTextDocument;
+class QTimer;
+
+class EditJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EditJournal(QTextDocument* document, QObject* parent = nullptr);
+    ~EditJournal() override;
+
+    // 开始为文件记录编辑，keepExisting 为 true 时在已有日志后追加
+    void attach(const QString& fileName, bool keepExisting = false);
+
+    // 停止记录并删除日志（文档已保存或用户放弃修改）
+    void discard();
+
+    // 编辑器切换模式后改为记录新文档
+    void setDocument(QTextDocument* document);
+
+    // 暂停记录，用于加载文件等非用户编辑
+    void setSuspended(bool suspended) { m_suspended = suspended; }
+
+    // 把缓冲的记录追加到磁盘
+    void flush();
+
+    // 返回当前记录位置，保存时作为快照标记
+    qint64 checkpoint() const { return m_loggedBytes + m_buffer.size(); }
+
+    // 保存完成后以新文件内容为基准重写日志，只保留标记之后的记录
+    void rebase(const QString& fileName, qint64 checkpoint);
+
+    static QString journalPathFor(const QString& fileName);
+
+    // 日志存在且与磁盘上的文件匹配
+    static bool hasJournal(const QString& fileName);
+
+    // 在已加载的原文件内容上回放日志，返回回放的记录数，-1 表示日志无效
+    static int replay(const QString& fileName, QTextDocument* document);
+
+private slots:
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+
+private:
+    bool openJournal(bool keepExisting);
+    void appendRecord(int position, int charsRemoved, const QString& inserted);
+
+    static QByteArray baseHeader(const QString& fileName);
+
+private:
+    QTextDocument* m_document;
+    QString m_fileName;     // 被记录的文件
+    QFile m_file;           // 日志文件
+    QByteArray m_buffer;    // 尚未写盘的记录
+    qint64 m_loggedBytes;   // 已写盘的记录字节数（不含文件头）
+    QTimer* m_flushTimer;   // 批量写盘定时器
+    bool m_suspended;
+
+    static constexpr int FLUSH_INTERVAL_MS = 2000;    // 批量写盘间隔
+    static constexpr int FLUSH_THRESHOLD = 64 * 1024; // 缓冲超过此大小立即写盘
+};
@@ -0,0 +1,480 @@
+﻿#include "EditorHost.h"
+#include "BlockIndex.h"
+#include "UndoManager.h"
+#include "Trace.h"
+
+#include <QTextEdit>
+#include <QPlainTextEdit>
+#include <QTextDocument>
+#include <QTextBlock>
+#include <QScrollBar>
+#include <QGridLayout>
+#include <QSignalBlocker>
+#include <QKeyEvent>
+
+namespace {
+
+// 段尾附近有逗号或空白时在其后断开，否则硬切，但不拆开代理对
+qsizetype segmentEnd(const QString& text, qsizetype start, qsizetype lineEnd)
+{
+    qsizetype end = start + EditorHost::SEGMENT_LENGTH;
+    if (end >= lineEnd) return lineEnd;
+
+    const qsizetype lowest = end - EditorHost::SEGMENT_LENGTH / 4;
+    for (qsizetype i = end; i > lowest; --i) {
+        const QChar c = text[i - 1];
+        if (c == QLatin1Char(',') || c == QLatin1Char(' ') || c == QLatin1Char('\t')) {
+            return i;
+        }
+    }
+
+    if (text[end - 1].isHighSurrogate()) --end;
+    return end;
+}
+
+}
+
+EditorHost::EditorHost(QTextEdit* richEditor, QObject* parent)
+    : QObject(parent)
+    , m_richEditor(richEditor)
+    , m_plainEditor(nullptr)
+    , m_blockIndex(nullptr)
+    , m_undoManager(nullptr)
+    , m_mode(Mode::RichText)
+    , m_preferredMode(Mode::RichText)
+    , m_segmented(false)
+{
+    connect(m_richEditor, &QTextEdit::textChanged, this, &EditorHost::textChanged);
+    connect(m_richEditor, &QTextEdit::cursorPositionChanged, this, &EditorHost::cursorPositionChanged);
+    connect(m_richEditor, &QTextEdit::selectionChanged, this, &EditorHost::selectionChanged);
+
+    m_blockIndex = new BlockIndex(m_richEditor->document(), this);
+    m_undoManager = new UndoManager(this);
+}
+
+void EditorHost::ensurePlainEditor()
+{
+    if (m_plainEditor) return;
+
+    // 放在富文本编辑器所在的位置，两者只显示一个
+    QWidget* container = m_richEditor->parentWidget();
+    m_plainEditor = new QPlainTextEdit(container);
+    m_plainEditor->setPlaceholderText(m_richEditor->placeholderText());
+    m_plainEditor->setSizePolicy(m_richEditor->sizePolicy());
+    m_plainEditor->installEventFilter(this);
+    m_plainEditor->hide();
+
+    if (QGridLayout* grid = qobject_cast<QGridLayout*>(container ? container->layout() : nullptr)) {
+        int row = 0;
+        int column = 0;
+        int rowSpan = 1;
+        int columnSpan = 1;
+        const int index = grid->indexOf(m_richEditor);
+        if (index >= 0) grid->getItemPosition(index, &row, &column, &rowSpan, &columnSpan);
+        grid->addWidget(m_plainEditor, row, column, rowSpan, columnSpan);
+    }
+
+    connect(m_plainEditor, &QPlainTextEdit::textChanged, this, &EditorHost::textChanged);
+    connect(m_plainEditor, &QPlainTextEdit::cursorPositionChanged, this, &EditorHost::cursorPositionChanged);
+    connect(m_plainEditor, &QPlainTextEdit::selectionChanged, this, &EditorHost::selectionChanged);
+}
+
+EditorHost::Mode EditorHost::modeForSize(qint64 bytes) const
+{
+    return bytes > PLAIN_TEXT_THRESHOLD ? Mode::PlainText : m_preferredMode;
+}
+
+void EditorHost::setMode(Mode mode, bool keepText)
+{
+    if (mode == m_mode) return;
+
+    QTextDocument* oldDocument = document();
+    const QFont font = oldDocument->defaultFont();
+    const bool modified = oldDocument->isModified();
+    const int position = logicalPosition(textCursor().position());
+    const QString text = keepText ? toPlainText() : QString();
+
+    // 富文本控件一次排版整行，超长行会让界面卡死
+    if (mode == Mode::RichText && hasLongLine(text)) {
+        emit modeChanged(m_mode);
+        return;
+    }
+
+    if (mode == Mode::PlainText) {
+        ensurePlainEditor();
+    }
+
+    QWidget* oldWidget = widget();
+    m_mode = mode;
+    QWidget* newWidget = widget();
+    m_blockIndex->setDocument(document());
+
+    // 内容迁移完成后再通知，避免监听者看到半截状态；
+    // 富文本格式和撤销历史不随模式迁移
+    {
+        const QSignalBlocker blocker(this);
+        document()->setDefaultFont(font);
+        setFont(font);
+        setPlainText(text);
+        document()->setModified(modified && keepText);
+
+        QTextCursor cursor(document());
+        cursor.setPosition(qMin(documentPosition(position), document()->characterCount() - 1));
+        setTextCursor(cursor);
+    }
+
+    oldWidget->hide();
+    newWidget->show();
+    newWidget->setFocus();
+
+    // 先让监听者切换到新文档，再释放旧编辑器中的内容
+    emit documentReplaced(document());
+    resetDocument(oldWidget);
+
+    emit modeChanged(m_mode);
+    emit textChanged();
+}
+
+void EditorHost::setDocument(QTextDocument* document, Mode mode, bool segmented)
+{
+    if (mode == Mode::PlainText) {
+        ensurePlainEditor();
+    }
+
+    const QFont font = widget()->font();
+    QWidget* oldWidget = widget();
+    m_mode = mode;
+    m_segmented = segmented;
+    QWidget* newWidget = widget();
+
+    {
+        const QSignalBlocker blocker(newWidget);
+        if (m_mode == Mode::PlainText) m_plainEditor->setDocument(document);
+        else m_richEditor->setDocument(document);
+        document->setDefaultFont(font);
+        setFont(font);
+    }
+    m_blockIndex->setDocument(document);
+
+    if (oldWidget != newWidget) {
+        oldWidget->hide();
+        newWidget->show();
+        newWidget->setFocus();
+        resetDocument(oldWidget);
+    }
+
+    emit documentReplaced(document);
+    emit modeChanged(m_mode);
+    emit textChanged();
+    emit cursorPositionChanged();
+}
+
+QTextDocument* EditorHost::createDocument(Mode mode, QObject* parent)
+{
+    // QPlainTextEdit 只接受纯文本布局的文档，富文本布局由 QTextEdit 按需创建
+    QTextDocument* document = new QTextDocument(parent);
+    if (mode == Mode::PlainText) {
+        document->setDocumentLayout(new QPlainTextDocumentLayout(document));
+    }
+    return document;
+}
+
+void EditorHost::resetDocument(QWidget* editor)
+{
+    const QSignalBlocker blocker(editor);
+    if (editor == m_plainEditor) m_plainEditor->setDocument(nullptr);
+    else m_richEditor->setDocument(nullptr);
+}
+
+QWidget* EditorHost::widget() const
+{
+    if (m_mode == Mode::PlainText) return m_plainEditor;
+    return m_richEditor;
+}
+
+QWidget* EditorHost::viewport() const
+{
+    if (m_mode == Mode::PlainText) return m_plainEditor->viewport();
+    return m_richEditor->viewport();
+}
+
+QTextDocument* EditorHost::document() const
+{
+    if (m_mode == Mode::PlainText) return m_plainEditor->document();
+    return m_richEditor->document();
+}
+
+QTextCursor EditorHost::textCursor() const
+{
+    if (m_mode == Mode::PlainText) return m_plainEditor->textCursor();
+    return m_richEditor->textCursor();
+}
+
+void EditorHost::setTextCursor(const QTextCursor& cursor)
+{
+    if (m_mode == Mode::PlainText) m_plainEditor->setTextCursor(cursor);
+    else m_richEditor->setTextCursor(cursor);
+}
+
+QString EditorHost::toPlainText() const
+{
+    if (!m_segmented) {
+        if (m_mode == Mode::PlainText) return m_plainEditor->toPlainText();
+        return m_richEditor->toPlainText();
+    }
+
+    // 续行段之前的换行是拆分时插入的，拼接时去掉
+    QString text;
+    text.reserve(document()->characterCount());
+    for (QTextBlock block = document()->firstBlock(); block.isValid(); block = block.next()) {
+        if (block.position() > 0 && !isContinuation(block)) {
+            text += QLatin1Char('\n');
+        }
+        text += block.text();
+    }
+    return text;
+}
+
+void EditorHost::setPlainText(const QString& text)
+{
+    TRACE_SCOPE("EditorHost::setPlainText");
+
+    // 整篇替换不进入撤销历史，原有的历史也随之作废
+    const UndoManager::Suspender suspender(m_undoManager);
+    replacePlainText(text);
+    m_undoManager->clear();
+}
+
+void EditorHost::replacePlainText(const QString& text)
+{
+    QVector<int> continuationBlocks;
+    const QString segmented = splitLongLines(text, &continuationBlocks);
+
+    if (continuationBlocks.isEmpty()) {
+        m_segmented = false;
+        if (m_mode == Mode::PlainText) m_plainEditor->setPlainText(text);
+        else m_richEditor->setPlainText(text);
+        return;
+    }
+
+    // 拆分后的段落由 QPlainTextEdit 按块排版，只有滚动到可见区域的段才会布局
+    if (m_mode != Mode::PlainText) {
+        setMode(Mode::PlainText, false);
+    }
+    m_segmented = true;
+    {
+        // 续行标记设好之前文本还不能按逻辑行读取，推迟通知
+        const QSignalBlocker blocker(m_plainEditor);
+        m_plainEditor->setPlainText(segmented);
+
+        QTextDocument* doc = m_plainEditor->document();
+        for (int blockNumber : continuationBlocks) {
+            doc->findBlockByNumber(blockNumber).setUserState(CONTINUATION_FLAG);
+        }
+        m_blockIndex->rebuild();
+    }
+    emit textChanged();
+    emit cursorPositionChanged();
+}
+
+void EditorHost::clear()
+{
+    const UndoManager::Suspender suspender(m_undoManager);
+    m_segmented = false;
+    if (m_mode == Mode::PlainText) m_plainEditor->clear();
+    else m_richEditor->clear();
+    m_undoManager->clear();
+}
+
+void EditorHost::setFocus()
+{
+    widget()->setFocus();
+}
+
+QFont EditorHost::font() const
+{
+    return widget()->font();
+}
+
+void EditorHost::setFont(const QFont& font)
+{
+    widget()->setFont(font);
+}
+
+QTextCharFormat EditorHost::currentCharFormat() const
+{
+    if (m_mode == Mode::PlainText) return m_plainEditor->currentCharFormat();
+    return m_richEditor->currentCharFormat();
+}
+
+void EditorHost::setCurrentCharFormat(const QTextCharFormat& format)
+{
+    if (m_mode == Mode::PlainText) m_plainEditor->setCurrentCharFormat(format);
+    else m_richEditor->setCurrentCharFormat(format);
+}
+
+QScrollBar* EditorHost::verticalScrollBar() const
+{
+    if (m_mode == Mode::PlainText) return m_plainEditor->verticalScrollBar();
+    return m_richEditor->verticalScrollBar();
+}
+
+QTextCursor EditorHost::cursorForPosition(const QPoint& position) const
+{
+    if (m_mode == Mode::PlainText) return m_plainEditor->cursorForPosition(position);
+    return m_richEditor->cursorForPosition(position);
+}
+
+int EditorHost::logicalPosition(int documentPosition) const
+{
+    if (!m_segmented) return documentPosition;
+    return m_blockIndex->logicalPosition(documentPosition);
+}
+
+int EditorHost::documentPosition(int logicalPosition) const
+{
+    if (!m_segmented) return logicalPosition;
+    return m_blockIndex->documentPosition(logicalPosition);
+}
+
+QTextCursor EditorHost::cursorForRange(int logicalPosition, int length) const
+{
+    QTextCursor cursor(document());
+    cursor.setPosition(documentPosition(logicalPosition));
+    cursor.setPosition(documentPosition(logicalPosition + length), QTextCursor::KeepAnchor);
+    return cursor;
+}
+
+QString EditorHost::textRange(int logicalPosition, int length) const
+{
+    const QTextCursor cursor = cursorForRange(logicalPosition, length);
+    const int start = cursor.selectionStart();
+    const int end = cursor.selectionEnd();
+
+    QString text;
+    for (QTextBlock block = document()->findBlock(start);
+        block.isValid() && block.position() <= end; block = block.next()) {
+        if (block.position() > start && !isContinuation(block)) {
+            text += QLatin1Char('\n');
+        }
+        const int from = qMax(start, block.position()) - block.position();
+        const int to = qMin(end, block.position() + block.length() - 1) - block.position();
+        text += block.text().mid(from, to - from);
+    }
+    return text;
+}
+
+bool EditorHost::eventFilter(QObject* watched, QEvent* event)
+{
+    if (watched == m_plainEditor && m_segmented && event->type() == QEvent::KeyPress) {
+        return handleSegmentKey(static_cast<QKeyEvent*>(event));
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+bool EditorHost::handleSegmentKey(QKeyEvent* event)
+{
+    if (event->modifiers() & Qt::ControlModifier) return false;
+
+    QTextCursor cursor = m_plainEditor->textCursor();
+    const QTextBlock block = cursor.block();
+    const QTextCursor::MoveMode moveMode = (event->modifiers() & Qt::ShiftModifier)
+        ? QTextCursor::KeepAnchor : QTextCursor::MoveAnchor;
+
+    // 有选区时方向键和删除键作用于选区，不需要处理
+    if (cursor.hasSelection() && moveMode == QTextCursor::MoveAnchor) return false;
+
+    switch (event->key()) {
+    case Qt::Key_Home: {
+        // 移到逻辑行首，而不是当前段的开头
+        QTextBlock first = block;
+        while (isContinuation(first)) first = first.previous();
+        cursor.setPosition(first.position(), moveMode);
+        m_plainEditor->setTextCursor(cursor);
+        return true;
+    }
+    case Qt::Key_End: {
+        QTextBlock last = block;
+        while (isContinuation(last.next())) last = last.next();
+        cursor.setPosition(last.position() + last.length() - 1, moveMode);
+        m_plainEditor->setTextCursor(cursor);
+        return true;
+    }
+    case Qt::Key_Left:
+    case Qt::Key_Backspace:
+        // 先越过段之间的虚拟换行，再交给编辑器处理
+        if (cursor.position() == block.position() && isContinuation(block)) {
+            cursor.movePosition(QTextCursor::PreviousCharacter, moveMode);
+            m_plainEditor->setTextCursor(cursor);
+        }
+        return false;
+    case Qt::Key_Right:
+    case Qt::Key_Delete:
+        if (cursor.atBlockEnd() && isContinuation(block.next())) {
+            cursor.movePosition(QTextCursor::NextCharacter, moveMode);
+            m_plainEditor->setTextCursor(cursor);
+        }
+        return false;
+    default:
+        return false;
+    }
+}
+
+bool EditorHost::isContinuation(const QTextBlock& block)
+{
+    if (!block.isValid()) return false;
+
+    const int state = block.userState();
+    return state != -1 && (state & CONTINUATION_FLAG);
+}
+
+bool EditorHost::hasLongLine(const QString& text)
+{
+    qsizetype lineStart = 0;
+    while (lineStart <= text.size()) {
+        qsizetype lineEnd = text.indexOf(QLatin1Char('\n'), lineStart);
+        if (lineEnd < 0) lineEnd = text.size();
+        if (lineEnd - lineStart > LONG_LINE_LIMIT) return true;
+        lineStart = lineEnd + 1;
+    }
+    return false;
+}
+
+QString EditorHost::splitLongLines(const QString& text, QVector<int>* continuationBlocks)
+{
+    continuationBlocks->clear();
+    if (!hasLongLine(text)) return QString();
+
+    QString result;
+    result.reserve(text.size() + text.size() / SEGMENT_LENGTH + 1);
+
+    int blockNumber = 0;
+    qsizetype lineStart = 0;
+    while (lineStart <= text.size()) {
+        qsizetype lineEnd = text.indexOf(QLatin1Char('\n'), lineStart);
+        if (lineEnd < 0) lineEnd = text.size();
+
+        if (lineEnd - lineStart <= LONG_LINE_LIMIT) {
+            result += QStringView(text).mid(lineStart, lineEnd - lineStart);
+        }
+        else {
+            qsizetype start = lineStart;
+            while (start < lineEnd) {
+                const qsizetype end = segmentEnd(text, start, lineEnd);
+                if (start > lineStart) {
+                    result += QLatin1Char('\n');
+                    continuationBlocks->append(++blockNumber);
+                }
+                result += QStringView(text).mid(start, end - start);
+                start = end;
+            }
+        }
+
+        if (lineEnd < text.size()) {
+            result += QLatin1Char('\n');
+            ++blockNumber;
+        }
+        lineStart = lineEnd + 1;
+    }
+    return result;
+}
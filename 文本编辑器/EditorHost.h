@@ -0,0 +1,150 @@
+﻿#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QFont>
+#include <QTextCursor>
+#include <QTextCharFormat>
+#include <QVector>
+
+class QTextEdit;
+class QPlainTextEdit;
+class QTextDocument;
+class QScrollBar;
+class QWidget;
+class QTextBlock;
+class QKeyEvent;
+class BlockIndex;
+class UndoManager;
+
+// 富文本 QTextEdit 与纯文本 QPlainTextEdit 的统一接口，
+// 控制器通过它访问当前编辑器，不关心底层是哪种控件
+class EditorHost : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Mode {
+        RichText,
+        PlainText,
+    };
+
+    explicit EditorHost(QTextEdit* richEditor, QObject* parent = nullptr);
+    ~EditorHost() override = default;
+
+    Mode mode() const { return m_mode; }
+
+    // 切换编辑模式，keepText 为 false 时不迁移内容（随后会整体替换）
+    void setMode(Mode mode, bool keepText = true);
+
+    // 显示另一个已有的文档（多文档切换），文档由调用方持有；
+    // 隐藏的那个编辑器换成空文档，不会留着别的标签的文档
+    void setDocument(QTextDocument* document, Mode mode, bool segmented);
+
+    // 创建能放进指定模式编辑器的空文档
+    static QTextDocument* createDocument(Mode mode, QObject* parent);
+
+    // 用户选择的模式，小文件按它打开
+    Mode preferredMode() const { return m_preferredMode; }
+
+    void setPreferredMode(Mode mode) { m_preferredMode = mode; }
+
+    // 根据文件大小选择模式，超过阈值的文件总是使用纯文本模式
+    Mode modeForSize(qint64 bytes) const;
+
+    QWidget* widget() const;
+
+    QWidget* viewport() const;
+
+    QTextDocument* document() const;
+
+    QTextCursor textCursor() const;
+
+    void setTextCursor(const QTextCursor& cursor);
+
+    QString toPlainText() const;
+
+    void setPlainText(const QString& text);
+
+    void clear();
+
+    void setFocus();
+
+    QFont font() const;
+
+    void setFont(const QFont& font);
+
+    QTextCharFormat currentCharFormat() const;
+
+    void setCurrentCharFormat(const QTextCharFormat& format);
+
+    QScrollBar* verticalScrollBar() const;
+
+    // 视口坐标处的光标，用于确定可见的块
+    QTextCursor cursorForPosition(const QPoint& position) const;
+
+    // 超长行被拆成多段显示时，文档中每段之间多出一个虚拟换行，
+    // 对外的文本和位置都按逻辑行计算
+    bool hasLongLines() const { return m_segmented; }
+
+    // 当前文档的行索引
+    const BlockIndex* blockIndex() const { return m_blockIndex; }
+
+    // 撤销历史，代替文档自带的撤销栈
+    UndoManager* undoManager() const { return m_undoManager; }
+
+    static bool isContinuation(const QTextBlock& block);
+
+    int logicalPosition(int documentPosition) const;
+
+    int documentPosition(int logicalPosition) const;
+
+    // 选中逻辑位置 [logicalPosition, logicalPosition + length) 的光标
+    QTextCursor cursorForRange(int logicalPosition, int length) const;
+
+    QString textRange(int logicalPosition, int length) const;
+
+    static constexpr qint64 PLAIN_TEXT_THRESHOLD = 8 * 1024 * 1024;  // 超过此大小自动使用纯文本模式
+    static constexpr int LONG_LINE_LIMIT = 16 * 1024;                // 超过此长度的行拆分显示
+    static constexpr int SEGMENT_LENGTH = 4 * 1024;                  // 拆分后每段的长度
+    static constexpr int CONTINUATION_FLAG = 1 << 30;                // 块状态中标记续行段的位
+
+signals:
+    void textChanged();
+
+    void cursorPositionChanged();
+
+    void selectionChanged();
+
+    // 模式切换后当前文档对象发生变化，持有文档信号连接的对象需要重新连接
+    void documentReplaced(QTextDocument* document);
+
+    void modeChanged(EditorHost::Mode mode);
+
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
+private:
+    void ensurePlainEditor();
+
+    // 编辑器换成自己持有的空文档，原文档若由编辑器持有则随之释放
+    void resetDocument(QWidget* editor);
+
+    bool handleSegmentKey(QKeyEvent* event);
+
+    void replacePlainText(const QString& text);
+
+    static bool hasLongLine(const QString& text);
+
+    // 拆分超长行，continuationBlocks 返回续行段的块号
+    static QString splitLongLines(const QString& text, QVector<int>* continuationBlocks);
+
+private:
+    QTextEdit* m_richEditor;        // 界面文件中的 TextEdit
+    QPlainTextEdit* m_plainEditor;  // 首次需要时创建
+    BlockIndex* m_blockIndex;       // 跟随当前文档
+    UndoManager* m_undoManager;
+    Mode m_mode;
+    Mode m_preferredMode;
+    bool m_segmented;               // 当前文档中是否有拆分显示的超长行
+};
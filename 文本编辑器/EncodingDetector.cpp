@@ -0,0 +1,181 @@
+﻿#include "EncodingDetector.h"
+
+#include <cstring>
+
+namespace {
+
+constexpr quint64 HIGH_BITS = 0x8080808080808080ull;
+
+// 一次检查 8 个字节是否全部为 ASCII
+inline bool isAsciiWord(const uchar* p)
+{
+    quint64 word;
+    std::memcpy(&word, p, sizeof(word));
+    return (word & HIGH_BITS) == 0;
+}
+
+// 跳过连续的 ASCII 字节，返回第一个非 ASCII 字节的位置
+inline qsizetype skipAscii(const uchar* data, qsizetype pos, qsizetype size)
+{
+    while (pos + 8 <= size && isAsciiWord(data + pos)) {
+        pos += 8;
+    }
+    while (pos < size && data[pos] < 0x80) {
+        ++pos;
+    }
+    return pos;
+}
+
+} // namespace
+
+EncodingDetector::Encoding EncodingDetector::detect(const char* data, qsizetype size)
+{
+    const uchar* bytes = reinterpret_cast<const uchar*>(data);
+    size = qMin(size, SAMPLE_SIZE);
+
+    // BOM
+    if (size >= 3 && bytes[0] == 0xEF && bytes[1] == 0xBB && bytes[2] == 0xBF) {
+        return Encoding::Utf8Bom;
+    }
+    if (size >= 2 && bytes[0] == 0xFF && bytes[1] == 0xFE) {
+        return Encoding::Utf16LEBom;
+    }
+    if (size >= 2 && bytes[0] == 0xFE && bytes[1] == 0xFF) {
+        return Encoding::Utf16BEBom;
+    }
+
+    // 无 BOM 的 UTF-16：ASCII 字符的高字节为 0，零字节集中在奇数或偶数位置
+    const qsizetype probe = qMin<qsizetype>(size, 4096) & ~qsizetype(1);
+    int evenZeros = 0;
+    int oddZeros = 0;
+    for (qsizetype i = 0; i < probe; i += 2) {
+        evenZeros += (bytes[i] == 0);
+        oddZeros += (bytes[i + 1] == 0);
+    }
+    if (probe > 0) {
+        const int half = int(probe / 2);
+        if (oddZeros > half / 3 && evenZeros < half / 20) return Encoding::Utf16LE;
+        if (evenZeros > half / 3 && oddZeros < half / 20) return Encoding::Utf16BE;
+    }
+
+    if (isValidUtf8(bytes, size)) {
+        return Encoding::Utf8;
+    }
+    if (looksLikeGB18030(bytes, size)) {
+        return Encoding::GB18030;
+    }
+
+    // 无法判断时按 UTF-8 解码，非法字节会被替换
+    return Encoding::Utf8;
+}
+
+bool EncodingDetector::isValidUtf8(const uchar* data, qsizetype size)
+{
+    qsizetype pos = 0;
+    while (true) {
+        pos = skipAscii(data, pos, size);
+        if (pos >= size) return true;
+
+        const uchar lead = data[pos];
+        int extra = 0;
+        uint minValue = 0;
+        uint value = 0;
+        if (lead >= 0xC2 && lead <= 0xDF) { extra = 1; minValue = 0x80; value = lead & 0x1F; }
+        else if (lead >= 0xE0 && lead <= 0xEF) { extra = 2; minValue = 0x800; value = lead & 0x0F; }
+        else if (lead >= 0xF0 && lead <= 0xF4) { extra = 3; minValue = 0x10000; value = lead & 0x07; }
+        else return false;
+
+        // 采样截断在多字节序列中间时视为合法
+        if (pos + extra >= size) return true;
+
+        for (int k = 1; k <= extra; ++k) {
+            const uchar c = data[pos + k];
+            if ((c & 0xC0) != 0x80) return false;
+            value = (value << 6) | (c & 0x3F);
+        }
+        // 超长编码、代理区和超出 Unicode 范围的码点
+        if (value < minValue || (value >= 0xD800 && value <= 0xDFFF) || value > 0x10FFFF) {
+            return false;
+        }
+        pos += extra + 1;
+    }
+}
+
+bool EncodingDetector::looksLikeGB18030(const uchar* data, qsizetype size)
+{
+    int valid = 0;
+    int invalid = 0;
+
+    qsizetype pos = 0;
+    while (true) {
+        pos = skipAscii(data, pos, size);
+        if (pos + 1 >= size) break;
+
+        const uchar lead = data[pos];
+        const uchar trail = data[pos + 1];
+        if (lead >= 0x81 && lead <= 0xFE) {
+            // 双字节：尾字节 0x40-0x7E、0x80-0xFE
+            if ((trail >= 0x40 && trail <= 0x7E) || (trail >= 0x80 && trail <= 0xFE)) {
+                ++valid;
+                pos += 2;
+                continue;
+            }
+            // 四字节：lead 0x30-0x39 0x81-0xFE 0x30-0x39
+            if (trail >= 0x30 && trail <= 0x39 && pos + 3 < size
+                && data[pos + 2] >= 0x81 && data[pos + 2] <= 0xFE
+                && data[pos + 3] >= 0x30 && data[pos + 3] <= 0x39) {
+                ++valid;
+                pos += 4;
+                continue;
+            }
+        }
+        ++invalid;
+        ++pos;
+    }
+
+    return valid > 0 && invalid * 20 <= valid;
+}
+
+QString EncodingDetector::displayName(Encoding encoding)
+{
+    switch (encoding) {
+    case Encoding::Utf8:    return QStringLiteral("UTF-8");
+    case Encoding::Utf8Bom: return QStringLiteral("UTF-8 BOM");
+    case Encoding::Utf16LE: return QStringLiteral("UTF-16 LE");
+    case Encoding::Utf16LEBom: return QStringLiteral("UTF-16 LE BOM");
+    case Encoding::Utf16BE: return QStringLiteral("UTF-16 BE");
+    case Encoding::Utf16BEBom: return QStringLiteral("UTF-16 BE BOM");
+    case Encoding::GB18030: return QStringLiteral("GB18030");
+    }
+    return QString();
+}
+
+QStringDecoder EncodingDetector::createDecoder(Encoding encoding)
+{
+    switch (encoding) {
+    case Encoding::Utf16LE:
+    case Encoding::Utf16LEBom: return QStringDecoder(QStringConverter::Utf16LE);
+    case Encoding::Utf16BE:
+    case Encoding::Utf16BEBom: return QStringDecoder(QStringConverter::Utf16BE);
+    case Encoding::GB18030: return QStringDecoder("GB18030");
+    case Encoding::Utf8:
+    case Encoding::Utf8Bom:
+        break;
+    }
+    return QStringDecoder(QStringConverter::Utf8);
+}
+
+QStringEncoder EncodingDetector::createEncoder(Encoding encoding)
+{
+    switch (encoding) {
+    case Encoding::Utf8Bom: return QStringEncoder(QStringConverter::Utf8, QStringConverter::Flag::WriteBom);
+    case Encoding::Utf16LE: return QStringEncoder(QStringConverter::Utf16LE);
+    case Encoding::Utf16LEBom: return QStringEncoder(QStringConverter::Utf16LE, QStringConverter::Flag::WriteBom);
+    case Encoding::Utf16BE: return QStringEncoder(QStringConverter::Utf16BE);
+    case Encoding::Utf16BEBom: return QStringEncoder(QStringConverter::Utf16BE, QStringConverter::Flag::WriteBom);
+    case Encoding::GB18030: return QStringEncoder("GB18030");
+    case Encoding::Utf8:
+        break;
+    }
+    return QStringEncoder(QStringConverter::Utf8);
+}
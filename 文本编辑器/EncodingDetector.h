@@ -0,0 +1,44 @@
+﻿#pragma once
+
+#include <QString>
+#include <QStringDecoder>
+#include <QStringEncoder>
+
+class EncodingDetector
+{
+public:
+    enum class Encoding {
+        Utf8,
+        Utf8Bom,
+        Utf16LE,        // 无 BOM
+        Utf16LEBom,
+        Utf16BE,        // 无 BOM
+        Utf16BEBom,
+        GB18030,
+    };
+
+    EncodingDetector() = default;
+    ~EncodingDetector() = default;
+
+    // 根据文件头部采样判断编码：BOM -> UTF-16 零字节分布 -> UTF-8 校验 -> GB18030 双字节统计
+    static Encoding detect(const char* data, qsizetype size);
+
+    // 状态栏显示的编码名称
+    static QString displayName(Encoding encoding);
+
+    static bool isUtf16(Encoding encoding)
+    {
+        return encoding == Encoding::Utf16LE || encoding == Encoding::Utf16LEBom
+            || encoding == Encoding::Utf16BE || encoding == Encoding::Utf16BEBom;
+    }
+
+    // 创建可分块调用的解码器/编码器，BOM 由转换器自动去除，带 BOM 的编码保存时写回 BOM
+    static QStringDecoder createDecoder(Encoding encoding);
+    static QStringEncoder createEncoder(Encoding encoding);
+
+    static constexpr qsizetype SAMPLE_SIZE = 64 * 1024;  // 检测时采样的字节数
+
+private:
+    static bool isValidUtf8(const uchar* data, qsizetype size);
+    static bool looksLikeGB18030(const uchar* data, qsizetype size);
+};
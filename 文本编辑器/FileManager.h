@@ -3,25 +3,59 @@
 
 #include <QObject>
 #include <QString>
+#include <QFutureWatcher>
+
+#include "DocumentReader.h"
+#include "DocumentWriter.h"
+#include "EncodingDetector.h"
+#include "CompressionCodec.h"
+#include "MemoryAccounting.h"
 
-class QTextEdit;
 class QMainWindow;
+class QTextDocument;
+class EditorHost;
+class EditJournal;
+class TailFollower;
 
 class FileManager : public QObject
 {
     Q_OBJECT
 
 public:
-    explicit FileManager(QTextEdit* editor, QMainWindow* parentWindow);
-    ~FileManager() override = default;
+    // 多文档切换时随文档保存和恢复的文件状态
+    struct DocumentState {
+        QString fileName;
+        EncodingDetector::Encoding encoding = EncodingDetector::Encoding::Utf8;
+        bool crlf = NATIVE_CRLF;
+        CompressionCodec::Format compression = CompressionCodec::Format::None;
+        qint64 fileSize = 0;
+    };
+
+    explicit FileManager(EditorHost* editor, QMainWindow* parentWindow);
+    ~FileManager() override;
 
     bool newFile();
 
     bool openFile(const QString& fileName = QString());
 
+    // 文件已在后台读取解码，直接放进编辑器，其余与 openFile 相同
+    bool openFile(const QString& fileName, const DocumentReader::Result& result);
+
+    // 显示打开文件对话框，取消时返回空字符串
+    QString askOpenFileName();
+
+    // 文档有修改时询问是否保存，选择保存时等保存完成，失败返回 false
+    bool maybeSave();
+
+    // 切换到另一个文档之前调用：完成进行中的保存、停止跟踪，返回当前文档的状态
+    DocumentState detachDocument();
+
+    // 编辑器换上另一个文档之后恢复它的状态
+    void attachDocument(const DocumentState& state);
+
     bool save();
 
-    bool saveAs();
+    bool saveAs(const QString& suggestedName = QString());
 
     QString currentFileName() const { return m_currentFile; }
 
@@ -35,8 +69,26 @@ public:
 
     bool loadFile(const QString& fileName);
 
+    // 当前文件在磁盘上被改写后重新读取：重新挂上编辑日志、从新的末尾继续跟踪，
+    // 并发出 fileLoaded 和 requestUpdateStats
+    bool reload();
+
     void setCurrentFile(const QString& fileName);
 
+    EncodingDetector::Encoding currentEncoding() const { return m_currentEncoding; }
+
+    void setCurrentEncoding(EncodingDetector::Encoding encoding, bool crlf);
+
+    // 保存压缩文件时是否保持原压缩格式
+    void setKeepCompression(bool keep) { m_keepCompression = keep; }
+
+    bool keepCompression() const { return m_keepCompression; }
+
+    // 跟踪当前文件末尾，只读取新追加的内容
+    bool setFollowTail(bool enabled);
+
+    bool isFollowingTail() const;
+
 signals:
     void fileLoaded();
 
@@ -46,16 +98,73 @@ signals:
 
     void requestUpdateStats();
 
-private:
-    bool maybeSave();
+    void encodingChanged(const QString& encodingName);
+
+    // 跟踪模式下追加到文档末尾的文本，统计和匹配据此增量更新
+    void textAppended(int position, const QString& text);
 
+    void followTailChanged(bool following);
+
+private:
     bool saveToFile(const QString& fileName);
 
+    void waitForPendingSave();
+
+    // 等待进行中的保存并立即处理结果，不等完成信号
+    void finishPendingSave();
+
+    void recoverJournal(const QString& fileName);
+
+    // 把读取结果放进编辑器，读取失败时提示并返回 false
+    bool applyLoadResult(const QString& fileName, const DocumentReader::Result& result);
+
+    // 打开成功后更新文件名、恢复编辑日志并通知界面
+    void finishOpen(const QString& fileName);
+
+private slots:
+    void onSaveFinished();
+
+    void onContentsChanged();
+
+    void bindDocument(QTextDocument* document);
+
+    void onTailAppended(const QString& text);
+
+    void onTailReset();
+
 private:
-    QTextEdit* m_editor;          // 文本编辑器
+    EditorHost* m_editor;         // 文本编辑器
     QMainWindow* m_parentWindow;  // 父窗口
     QString m_currentFile;        // 当前文件名
 
+    QFutureWatcher<DocumentWriter::Result>* m_saveWatcher;  // 后台保存任务
+    QString m_pendingSaveFile;    // 正在保存的目标文件
+    quint64 m_pendingSaveRevision; // 快照时的内容版本
+    quint64 m_pendingSaveGeneration; // 快照时的文档代数
+    qint64 m_pendingSaveCheckpoint; // 快照时的日志位置
+    MemoryAccounting::Charge m_pendingSaveCharge; // 交给工作线程的文本快照
+    quint64 m_contentRevision;    // 内容每次变化递增
+    quint64 m_documentGeneration; // 新建或打开文档时递增
+    bool m_savePending;           // 保存结果尚未处理
+
+    EditJournal* m_journal;       // 编辑日志，用于崩溃恢复
+
+    EncodingDetector::Encoding m_currentEncoding;  // 当前文档的编码
+    bool m_crlf;                  // 当前文档使用 \r\n 换行
+    CompressionCodec::Format m_currentCompression;     // 当前文档的压缩格式
+    CompressionCodec::Format m_pendingSaveCompression; // 正在保存时使用的压缩格式
+    bool m_keepCompression;       // 原位保存时保持压缩
+    qint64 m_fileSize;            // 文档对应的磁盘文件字节数
+
+    TailFollower* m_tailFollower; // 文件末尾跟踪
+    bool m_resumeFollowAfterSave; // 保存完成后恢复跟踪
+
     static const QStringList SUPPORTED_FORMATS;  // 支持的文件格式
+
+#ifdef Q_OS_WIN
+    static constexpr bool NATIVE_CRLF = true;    // 新建文档的默认换行
+#else
+    static constexpr bool NATIVE_CRLF = false;
+#endif
 };
 
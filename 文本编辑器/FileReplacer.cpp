@@ -0,0 +1,313 @@
+﻿#include "FileReplacer.h"
+#include "EncodingDetector.h"
+#include "CompressionCodec.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QTemporaryFile>
+#include <QCoreApplication>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <vector>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+// 临时文件内容同步到磁盘后才改名，避免断电后留下空文件
+bool syncToDisk(QFile& file)
+{
+    if (!file.flush()) return false;
+#ifdef Q_OS_WIN
+    return FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(file.handle()))) != 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+// 同目录下的隐藏文件名，批量查找时会被跳过
+QString siblingName(const QString& fileName, const QString& suffix)
+{
+    const QFileInfo info(fileName);
+    return info.absoluteDir().filePath(QLatin1Char('.') + info.fileName() + suffix);
+}
+
+// 跨块的流式 KMP：未确定是否属于匹配的字符（最多 m-1 个）留到下一块
+class StreamReplacer
+{
+public:
+    StreamReplacer(const QString& pattern, const QString& replacement)
+        : m_pattern(pattern)
+        , m_replacement(replacement)
+        , m_failure(pattern.size(), 0)
+        , m_state(0)
+        , m_replaced(0)
+    {
+        for (qsizetype i = 1, j = 0; i < m_pattern.size(); ++i) {
+            while (j > 0 && m_pattern[i] != m_pattern[j]) j = m_failure[j - 1];
+            if (m_pattern[i] == m_pattern[j]) ++j;
+            m_failure[i] = j;
+        }
+    }
+
+    // 返回可以输出的文本
+    QString feed(const QString& chunk)
+    {
+        const QString buffer = m_carry + chunk;
+        const qsizetype m = m_pattern.size();
+
+        QString output;
+        output.reserve(buffer.size());
+        qsizetype emitted = 0;
+
+        // 上一块留下的字符已经推进过状态，从新数据开始扫描
+        for (qsizetype i = m_carry.size(); i < buffer.size(); ++i) {
+            while (m_state > 0 && buffer[i] != m_pattern[m_state]) m_state = m_failure[m_state - 1];
+            if (buffer[i] == m_pattern[m_state]) ++m_state;
+
+            if (m_state == m) {
+                // 匹配后状态清零，与 TextReplacer 一样只替换不重叠的匹配
+                output += QStringView(buffer).mid(emitted, i + 1 - m - emitted);
+                output += m_replacement;
+                emitted = i + 1;
+                m_state = 0;
+                ++m_replaced;
+            }
+        }
+
+        const qsizetype keep = qMin(m_state, buffer.size() - emitted);
+        output += QStringView(buffer).mid(emitted, buffer.size() - keep - emitted);
+        m_carry = buffer.right(keep);
+        return output;
+    }
+
+    // 输入结束，剩下的字符不可能再构成匹配
+    QString finish()
+    {
+        QString rest;
+        rest.swap(m_carry);
+        m_state = 0;
+        return rest;
+    }
+
+    int replaced() const { return m_replaced; }
+
+private:
+    QString m_pattern;
+    QString m_replacement;
+    std::vector<qsizetype> m_failure;
+    qsizetype m_state;          // 已匹配的字符数
+    QString m_carry;
+    int m_replaced;
+};
+
+struct FileJob {
+    QString fileName;
+    QString tempName;
+    FileReplacer::Result result;
+};
+
+}
+
+FileReplacer::Result FileReplacer::rewrite(const QString& fileName, const QString& outputName,
+    const QString& pattern, const QString& replacement)
+{
+    Result result;
+    if (pattern.isEmpty()) {
+        result.errorString = QCoreApplication::translate("FileReplacer", "查找字符串不能为空");
+        return result;
+    }
+
+    QFile input(fileName);
+    if (!input.open(QIODevice::ReadOnly)) {
+        result.errorString = input.errorString();
+        return result;
+    }
+
+    QFile output(outputName);
+    if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        result.errorString = output.errorString();
+        return result;
+    }
+
+    QByteArray chunk = input.read(CHUNK_SIZE);
+    const CompressionCodec::Format compression = CompressionCodec::detect(chunk.constData(), chunk.size());
+    CompressionCodec decompressor(compression, CompressionCodec::Mode::Decompress);
+    CompressionCodec compressor(compression, CompressionCodec::Mode::Compress);
+    if (!decompressor.isValid() || !compressor.isValid()) {
+        result.errorString = QCoreApplication::translate("FileReplacer", "无法初始化 %1 压缩")
+            .arg(CompressionCodec::displayName(compression));
+        return result;
+    }
+
+    // 换行不做转换，原样保留 \r\n；查找字符串不含换行，不受影响
+    StreamReplacer replacer(pattern, replacement);
+    QStringDecoder decoder;
+    QStringEncoder encoder;
+    QByteArray head;
+    bool decoding = false;
+
+    auto write = [&](const char* data, qsizetype size) -> bool {
+        return output.write(data, size) == size;
+    };
+
+    auto emitText = [&](const QString& text) -> bool {
+        if (text.isEmpty()) return true;
+        const QByteArray bytes = encoder(text);
+        return compressor.process(bytes.constData(), bytes.size(), write);
+    };
+
+    auto startDecoding = [&]() -> bool {
+        // 与 DocumentReader 相同：按解压后的头部采样检测编码，编码器写回原有的 BOM
+        const EncodingDetector::Encoding encoding = EncodingDetector::detect(head.constData(), head.size());
+        decoder = EncodingDetector::createDecoder(encoding);
+        encoder = EncodingDetector::createEncoder(encoding);
+        if (!decoder.isValid() || !encoder.isValid()) {
+            result.errorString = QCoreApplication::translate("FileReplacer", "不支持的编码 %1")
+                .arg(EncodingDetector::displayName(encoding));
+            return false;
+        }
+
+        decoding = true;
+        const QString text = decoder(head);
+        head.clear();
+        return emitText(replacer.feed(text));
+    };
+
+    auto sink = [&](const char* data, qsizetype size) -> bool {
+        if (decoding) {
+            const QString text = decoder(QByteArrayView(data, size));
+            return emitText(replacer.feed(text));
+        }
+        head.append(data, size);
+        return head.size() < EncodingDetector::SAMPLE_SIZE || startDecoding();
+    };
+
+    auto fail = [&](const QString& fallback) -> Result {
+        if (result.errorString.isEmpty()) result.errorString = fallback;
+        result.replaced = 0;
+        output.close();
+        QFile::remove(outputName);
+        return result;
+    };
+
+    while (!chunk.isEmpty()) {
+        if (!decompressor.process(chunk.constData(), chunk.size(), sink)) {
+            return fail(decompressor.errorString().isEmpty() ? output.errorString() : decompressor.errorString());
+        }
+        if (input.atEnd()) break;
+
+        chunk = input.read(CHUNK_SIZE);
+        if (chunk.isEmpty()) return fail(input.errorString());
+    }
+    if (!decompressor.finish(sink)) return fail(decompressor.errorString());
+
+    if (!decoding && !startDecoding()) return fail(output.errorString());
+
+    // 含无法解码的字节时不写回，以免破坏原文件
+    if (decoder.hasError()) {
+        return fail(QCoreApplication::translate("FileReplacer", "文件包含无法解码的字节"));
+    }
+
+    if (!emitText(replacer.finish()) || !compressor.finish(write)) {
+        return fail(compressor.errorString().isEmpty() ? output.errorString() : compressor.errorString());
+    }
+    if (!syncToDisk(output)) return fail(output.errorString());
+    output.close();
+
+    // 保留原文件的权限
+    output.setPermissions(input.permissions());
+
+    result.replaced = replacer.replaced();
+    result.ok = true;
+    return result;
+}
+
+FileReplacer::BatchResult FileReplacer::replaceInFiles(const QStringList& files, const QString& pattern,
+    const QString& replacement)
+{
+    BatchResult batch;
+
+    std::vector<FileJob> jobs;
+    jobs.reserve(size_t(files.size()));
+    for (const QString& fileName : files) {
+        // 在目标目录下预留临时文件名，改名时不跨文件系统
+        QTemporaryFile temp(siblingName(fileName, QStringLiteral(".XXXXXX")));
+        temp.setAutoRemove(false);
+        if (!temp.open()) {
+            for (const FileJob& job : jobs) QFile::remove(job.tempName);
+            batch.failedFile = fileName;
+            batch.errorString = temp.errorString();
+            return batch;
+        }
+        jobs.push_back({ fileName, temp.fileName(), Result() });
+    }
+
+    // 第一阶段：并行写出所有临时文件，原文件不动
+    QtConcurrent::blockingMap(jobs, [&pattern, &replacement](FileJob& job) {
+        job.result = rewrite(job.fileName, job.tempName, pattern, replacement);
+    });
+
+    for (const FileJob& job : jobs) {
+        if (!job.result.ok && batch.failedFile.isEmpty()) {
+            batch.failedFile = job.fileName;
+            batch.errorString = job.result.errorString;
+        }
+    }
+    if (!batch.failedFile.isEmpty()) {
+        for (const FileJob& job : jobs) QFile::remove(job.tempName);
+        return batch;
+    }
+
+    // 第二阶段：原文件改名为备份，临时文件改名为原文件；
+    // 目标存在时改名会失败（Windows），所以先移走原文件
+    struct Committed {
+        QString fileName;
+        QString backupName;
+    };
+    QVector<Committed> committed;
+
+    auto rollback = [&]() {
+        for (int i = committed.size() - 1; i >= 0; --i) {
+            QFile::remove(committed[i].fileName);
+            QFile::rename(committed[i].backupName, committed[i].fileName);
+        }
+        for (const FileJob& job : jobs) QFile::remove(job.tempName);
+    };
+
+    for (const FileJob& job : jobs) {
+        // 没有匹配的文件不改写
+        if (job.result.replaced == 0) continue;
+
+        const QString backupName = job.tempName + QStringLiteral(".bak");
+        if (!QFile::rename(job.fileName, backupName)) {
+            batch.failedFile = job.fileName;
+            batch.errorString = QCoreApplication::translate("FileReplacer", "无法备份原文件");
+            rollback();
+            return batch;
+        }
+        if (!QFile::rename(job.tempName, job.fileName)) {
+            QFile::rename(backupName, job.fileName);
+            batch.failedFile = job.fileName;
+            batch.errorString = QCoreApplication::translate("FileReplacer", "无法替换原文件");
+            rollback();
+            return batch;
+        }
+        committed.append({ job.fileName, backupName });
+        batch.replaced += job.result.replaced;
+    }
+
+    // 全部成功后才删除备份
+    for (const Committed& item : committed) QFile::remove(item.backupName);
+    for (const FileJob& job : jobs) QFile::remove(job.tempName);
+
+    batch.filesChanged = committed.size();
+    batch.ok = true;
+    return batch;
+}
@@ -0,0 +1,38 @@
+﻿#pragma once
+
+#include <QString>
+#include <QStringList>
+
+// 多文件替换：先把每个文件流式替换到同目录下的临时文件（并行），
+// 全部成功后再逐个改名替换原文件；任何一步失败都恢复所有原文件
+class FileReplacer
+{
+public:
+    struct Result {
+        bool ok = false;
+        int replaced = 0;             // 替换次数
+        QString errorString;
+    };
+
+    struct BatchResult {
+        bool ok = false;
+        int filesChanged = 0;
+        int replaced = 0;
+        QString failedFile;           // 导致回滚的文件
+        QString errorString;
+    };
+
+    FileReplacer() = default;
+    ~FileReplacer() = default;
+
+    // 读入、解压、解码、查找替换、编码、压缩一遍完成，内存占用与文件大小无关。
+    // 原编码、BOM、换行和压缩格式保持不变（可在工作线程调用）
+    static Result rewrite(const QString& fileName, const QString& outputName,
+        const QString& pattern, const QString& replacement);
+
+    // 阻塞到全部完成或回滚（可在工作线程调用）
+    static BatchResult replaceInFiles(const QStringList& files, const QString& pattern, const QString& replacement);
+
+private:
+    static constexpr qint64 CHUNK_SIZE = 1 << 20;  // 每次读取的字节数
+};
@@ -0,0 +1,136 @@
+﻿#include "FileSearcher.h"
+#include "WorkStealingPool.h"
+#include "KMPMatcher.h"
+#include "DocumentReader.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QtConcurrent/QtConcurrentRun>
+
+FileSearcher::FileSearcher(QObject* parent)
+    : QObject(parent)
+    , m_poolWatcher(new QFutureWatcher<void>(this))
+    , m_generation(0)
+    , m_filesSearched(0)
+    , m_filesMatched(0)
+    , m_totalMatches(0)
+{
+    connect(m_poolWatcher, &QFutureWatcher<void>::finished, this, &FileSearcher::onPoolFinished);
+}
+
+FileSearcher::~FileSearcher()
+{
+    stop();
+    m_poolWatcher->waitForFinished();
+}
+
+void FileSearcher::start(const QString& directory, const QString& pattern, const QStringList& nameFilters)
+{
+    // 上一次查找先取消并等它结束
+    if (m_pool) {
+        stop();
+        m_poolWatcher->waitForFinished();
+        m_pool.reset();
+    }
+
+    ++m_generation;
+    m_pattern = pattern;
+    m_nameFilters = nameFilters;
+    m_filesSearched = 0;
+    m_filesMatched = 0;
+    m_totalMatches = 0;
+    m_timer.start();
+
+    m_pool = std::make_unique<WorkStealingPool>();
+    const QString root = QDir::cleanPath(directory);
+    m_pool->submit([this, root]() { searchDirectory(root); });
+
+    WorkStealingPool* pool = m_pool.get();
+    m_poolWatcher->setFuture(QtConcurrent::run([pool]() { pool->wait(); }));
+}
+
+void FileSearcher::stop()
+{
+    if (m_pool) m_pool->cancel();
+}
+
+void FileSearcher::onPoolFinished()
+{
+    if (!m_pool) return;
+
+    m_pool.reset();
+    emit finished(m_filesSearched, m_filesMatched, m_totalMatches, m_timer.elapsed());
+}
+
+void FileSearcher::searchDirectory(const QString& directory)
+{
+    // 子目录和文件都拆成任务，由空闲线程窃取
+    QDirIterator it(directory, QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot | QDir::NoSymLinks);
+    while (it.hasNext() && !m_pool->isCancelled()) {
+        const QString path = it.next();
+        const QFileInfo info = it.fileInfo();
+
+        // 跳过隐藏文件和目录（包括编辑日志）
+        if (info.fileName().startsWith(QLatin1Char('.'))) continue;
+
+        if (info.isDir()) {
+            m_pool->submit([this, path]() { searchDirectory(path); });
+        }
+        else if (m_nameFilters.isEmpty() || QDir::match(m_nameFilters, info.fileName())) {
+            m_pool->submit([this, path]() { searchFile(path); });
+        }
+    }
+}
+
+void FileSearcher::searchFile(const QString& fileName)
+{
+    // 头部含 NUL 字节的二进制文件直接跳过
+    const DocumentReader::Result read = DocumentReader::readMapped(fileName, true);
+    ++m_filesSearched;
+    if (!read.ok) return;
+
+    const QString& text = read.text;
+
+    // 边查找边从上一个匹配处继续数换行，整个文件只扫描一遍；
+    // 超过上限的匹配只计数，不保存位置。与替换一致，重叠的匹配只算靠前的一个
+    QVector<Match> matches;
+    int matchCount = 0;
+    int line = 1;
+    qsizetype lineStart = 0;
+    qsizetype scanned = 0;
+    qsizetype nextFree = 0;
+    KMPMatcher::forEachMatch(text, m_pattern, [&](int pos) {
+        if (pos < nextFree) return true;
+        nextFree = pos + m_pattern.size();
+        ++matchCount;
+        if (matches.size() >= MAX_MATCHES_PER_FILE) return true;
+
+        for (; scanned < pos; ++scanned) {
+            if (text[scanned] == QLatin1Char('\n')) {
+                ++line;
+                lineStart = scanned + 1;
+            }
+        }
+
+        qsizetype lineEnd = text.indexOf(QLatin1Char('\n'), pos);
+        if (lineEnd < 0) lineEnd = text.size();
+        const qsizetype previewStart = qMax(lineStart, qsizetype(pos) - PREVIEW_CONTEXT);
+        const QString preview = text.mid(previewStart, qMin(lineEnd - previewStart, qsizetype(PREVIEW_CHARS)));
+
+        matches.append({ line, int(pos - lineStart) + 1, preview.trimmed() });
+        return true;
+        });
+    if (matchCount == 0) return;
+
+    ++m_filesMatched;
+    m_totalMatches += matchCount;
+
+    // 结果回到界面线程发出
+    const quint64 generation = m_generation;
+    QMetaObject::invokeMethod(this, [this, generation, fileName, matchCount, matches]() {
+        if (generation == m_generation) {
+            emit fileMatched(fileName, matchCount, matches);
+        }
+    }, Qt::QueuedConnection);
+}
@@ -0,0 +1,66 @@
+﻿#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+
+#include <atomic>
+#include <memory>
+
+class WorkStealingPool;
+
+// 在目录树中并行查找字符串：目录和文件都作为任务交给工作窃取线程池，
+// 文件映射到内存后用 KMP 查找，每个文件的结果找到后立即发出
+class FileSearcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Match {
+        int line = 0;               // 从 1 开始
+        int column = 0;             // 从 1 开始
+        QString preview;            // 匹配所在行的片段
+    };
+
+    explicit FileSearcher(QObject* parent = nullptr);
+    ~FileSearcher() override;
+
+    // nameFilters 为空时查找所有文件
+    void start(const QString& directory, const QString& pattern, const QStringList& nameFilters);
+
+    void stop();
+
+    bool isRunning() const { return m_pool != nullptr; }
+
+    static constexpr int MAX_MATCHES_PER_FILE = 1000;   // 每个文件最多列出的匹配数
+    static constexpr int PREVIEW_CHARS = 160;
+    static constexpr int PREVIEW_CONTEXT = 40;          // 长行中匹配之前保留的字符数
+
+signals:
+    // matchCount 为文件中的全部匹配数，matches 最多 MAX_MATCHES_PER_FILE 个
+    void fileMatched(const QString& fileName, int matchCount, const QVector<FileSearcher::Match>& matches);
+
+    void finished(int filesSearched, int filesMatched, int totalMatches, qint64 elapsedMs);
+
+private slots:
+    void onPoolFinished();
+
+private:
+    void searchDirectory(const QString& directory);
+
+    void searchFile(const QString& fileName);
+
+private:
+    std::unique_ptr<WorkStealingPool> m_pool;
+    QFutureWatcher<void>* m_poolWatcher;     // 在后台等待线程池完成
+    QString m_pattern;
+    QStringList m_nameFilters;
+    quint64 m_generation;                    // 每次查找递增，丢弃上一次查找迟到的结果
+    std::atomic<int> m_filesSearched;
+    std::atomic<int> m_filesMatched;
+    std::atomic<int> m_totalMatches;
+    QElapsedTimer m_timer;
+};
@@ -1,25 +1,94 @@
 ﻿#include "FileManager.h"
+#include "EditJournal.h"
+#include "DocumentReader.h"
+#include "TailFollower.h"
+#include "EditorHost.h"
+#include "UndoManager.h"
+#include "Trace.h"
 
-#include <QTextEdit>
 #include <QMainWindow>
 #include <QFileDialog>
 #include <QFile>
-#include <QTextStream>
 #include <QFileInfo>
+#include <QDir>
 #include <QMessageBox>
 #include <QStatusBar>
+#include <QTextDocument>
+#include <QTextCursor>
+#include <QScrollBar>
+#include <QSignalBlocker>
+#include <QtConcurrent/QtConcurrentRun>
 
 const QStringList FileManager::SUPPORTED_FORMATS = {
     tr("文本文件 (*.txt)"),
+    tr("压缩文本 (*.gz *.zst)"),
     tr("所有文件 (*)")
 };
 
-FileManager::FileManager(QTextEdit* editor, QMainWindow* parentWindow)
+FileManager::FileManager(EditorHost* editor, QMainWindow* parentWindow)
     : QObject(parentWindow)
     , m_editor(editor)
     , m_parentWindow(parentWindow)
     , m_currentFile()
+    , m_saveWatcher(new QFutureWatcher<DocumentWriter::Result>(this))
+    , m_pendingSaveRevision(0)
+    , m_pendingSaveGeneration(0)
+    , m_pendingSaveCheckpoint(0)
+    , m_pendingSaveCharge(MemoryAccounting::Tag::TextCopies)
+    , m_contentRevision(0)
+    , m_documentGeneration(0)
+    , m_savePending(false)
+    , m_journal(nullptr)
+    , m_currentEncoding(EncodingDetector::Encoding::Utf8)
+    , m_crlf(NATIVE_CRLF)
+    , m_currentCompression(CompressionCodec::Format::None)
+    , m_pendingSaveCompression(CompressionCodec::Format::None)
+    , m_keepCompression(true)
+    , m_fileSize(0)
+    , m_tailFollower(new TailFollower(this))
+    , m_resumeFollowAfterSave(false)
 {
+    connect(m_saveWatcher, &QFutureWatcher<DocumentWriter::Result>::finished,
+        this, &FileManager::onSaveFinished);
+    connect(m_tailFollower, &TailFollower::textAppended, this, &FileManager::onTailAppended);
+    connect(m_tailFollower, &TailFollower::fileReset, this, &FileManager::onTailReset);
+
+    if (m_editor) {
+        m_journal = new EditJournal(m_editor->document(), this);
+        bindDocument(m_editor->document());
+
+        // 编辑器切换纯文本/富文本模式后文档对象会变化
+        connect(m_editor, &EditorHost::documentReplaced, this, &FileManager::bindDocument);
+    }
+}
+
+void FileManager::bindDocument(QTextDocument* document)
+{
+    // 记录内容版本，用于判断保存期间文档是否又被修改
+    connect(document, &QTextDocument::contentsChanged,
+        this, &FileManager::onContentsChanged, Qt::UniqueConnection);
+    m_journal->setDocument(document);
+
+    // 切换模式时拆分出超长行的文档不再记录编辑日志
+    if (m_editor->hasLongLines()) {
+        m_journal->attach(QString());
+    }
+}
+
+void FileManager::onContentsChanged()
+{
+    ++m_contentRevision;
+}
+
+FileManager::~FileManager()
+{
+    // 退出前等待后台保存写完，避免留下半截的临时文件
+    waitForPendingSave();
+
+    // 没有未保存的修改时不需要保留日志
+    if (m_journal && !isModified()) {
+        m_journal->discard();
+    }
 }
 
 bool FileManager::newFile()
@@ -30,7 +99,12 @@ bool FileManager::newFile()
     }
 
     // 清空编辑器
+    setFollowTail(false);
+    ++m_documentGeneration;
+    m_journal->attach(QString());
     m_editor->clear();
+    m_currentCompression = CompressionCodec::Format::None;
+    setCurrentEncoding(EncodingDetector::Encoding::Utf8, NATIVE_CRLF);
     m_editor->setFocus();
 
     // 重置当前文件
@@ -57,40 +131,75 @@ bool FileManager::openFile(const QString& fileName)
 
     // 如果未指定文件名，显示打开对话框
     if (fileToOpen.isEmpty()) {
-        fileToOpen = QFileDialog::getOpenFileName(m_parentWindow,
-            tr("打开文件"),
-            QString(),
-            SUPPORTED_FORMATS.join(";;"));
+        fileToOpen = askOpenFileName();
         if (fileToOpen.isEmpty()) {
             return false; // 用户取消了对话框
         }
     }
 
     // 加载文件
+    setFollowTail(false);
     if (loadFile(fileToOpen)) {
-        setCurrentFile(fileToOpen);
-        showStatusMessage(tr("已打开 %1").arg(QFileInfo(fileToOpen).fileName()));
-        emit fileLoaded();
-        emit requestUpdateStats();
+        finishOpen(fileToOpen);
+        return true;
+    }
+
+    return false;
+}
+
+bool FileManager::openFile(const QString& fileName, const DocumentReader::Result& result)
+{
+    if (!maybeSave()) {
+        return false;
+    }
+
+    setFollowTail(false);
+    waitForPendingSave();
+    if (applyLoadResult(fileName, result)) {
+        finishOpen(fileName);
         return true;
     }
 
     return false;
 }
 
+void FileManager::finishOpen(const QString& fileName)
+{
+    setCurrentFile(fileName);
+    showStatusMessage(tr("已打开 %1").arg(QFileInfo(fileName).fileName()));
+    recoverJournal(fileName);
+    emit fileLoaded();
+    emit requestUpdateStats();
+}
+
+QString FileManager::askOpenFileName()
+{
+    return QFileDialog::getOpenFileName(m_parentWindow,
+        tr("打开文件"),
+        QString(),
+        SUPPORTED_FORMATS.join(";;"));
+}
+
 bool FileManager::save()
 {
     if (m_currentFile.isEmpty()) {
         return saveAs();
     }
+
+    // 不保持压缩时另存为去掉压缩扩展名的文件
+    if (m_currentCompression != CompressionCodec::Format::None && !m_keepCompression) {
+        const QFileInfo info(m_currentFile);
+        return saveAs(info.dir().filePath(info.completeBaseName()));
+    }
+
     return saveToFile(m_currentFile);
 }
 
-bool FileManager::saveAs()
+bool FileManager::saveAs(const QString& suggestedName)
 {
     QString fileName = QFileDialog::getSaveFileName(m_parentWindow,
         tr("另存为"),
-        QString(),
+        suggestedName,
         SUPPORTED_FORMATS.join(";;"));
     if (fileName.isEmpty()) {
         return false;
@@ -114,46 +223,120 @@ bool FileManager::maybeSave()
     );
 
     if (ret == QMessageBox::Save) {
-        return save();
+        // 保存在后台进行，这里等它完成，保存失败时不能丢掉文档
+        if (!save()) return false;
+        finishPendingSave();
+        return !isModified();
     }
     else if (ret == QMessageBox::Cancel) {
         return false;
     }
 
+    // 放弃修改时一并删除编辑日志
+    m_journal->discard();
     return true; // Discard
 }
 
 bool FileManager::saveToFile(const QString& fileName)
 {
-    QFile file(fileName);
-    if (!file.open(QFile::WriteOnly | QFile::Text)) {
-        QMessageBox::warning(m_parentWindow,
-            tr("保存失败"),
-            tr("无法保存到 %1:\n%2")
-            .arg(QFileInfo(fileName).fileName(),
-                file.errorString()));
-        return false;
+    TRACE_SCOPE("FileManager::saveToFile");
+
+    // 同一时间只允许一个保存任务，保证写入顺序
+    finishPendingSave();
+
+    // 保存会替换磁盘文件，跟踪暂停到保存完成
+    if (m_tailFollower->isFollowing()) {
+        m_tailFollower->stop();
+        m_resumeFollowAfterSave = true;
     }
 
-    // 获取文本内容
+    // GUI 线程上只做一次文本快照，编码和写入交给工作线程
     const QString content = m_editor->toPlainText();
-    QByteArray bytes = content.toUtf8();
+    m_pendingSaveFile = fileName;
+    m_pendingSaveRevision = m_contentRevision;
+    m_pendingSaveGeneration = m_documentGeneration;
+    m_pendingSaveCheckpoint = m_journal->checkpoint();
+    m_pendingSaveCharge.set(MemoryAccounting::bytesOf(content));
+
+    // 原位保存沿用打开时的压缩格式，另存为按扩展名决定
+    m_pendingSaveCompression = (fileName == m_currentFile && m_keepCompression)
+        ? m_currentCompression
+        : CompressionCodec::formatForFileName(fileName);
+
+    m_savePending = true;
+    m_saveWatcher->setFuture(QtConcurrent::run(&DocumentWriter::writeAtomically,
+        fileName, content, m_currentEncoding, m_crlf, m_pendingSaveCompression));
+
+    // 显示状态消息
+    showStatusMessage(tr("正在保存 %1 ...").arg(QFileInfo(fileName).fileName()), 0);
+
+    return true;
+}
+
+void FileManager::waitForPendingSave()
+{
+    if (m_saveWatcher->isRunning()) {
+        m_saveWatcher->waitForFinished();
+    }
+}
 
-    // 写入文件
-    qint64 written = file.write(bytes);
-    file.close();
+void FileManager::finishPendingSave()
+{
+    if (!m_savePending) return;
+
+    m_saveWatcher->waitForFinished();
+    onSaveFinished();
+}
+
+void FileManager::onSaveFinished()
+{
+    // 已经由 finishPendingSave 处理过时忽略随后到达的完成信号
+    if (!m_savePending) return;
+    m_savePending = false;
+    m_pendingSaveCharge.set(0);
 
-    if (written == -1) {
+    const DocumentWriter::Result result = m_saveWatcher->result();
+    const QString fileName = m_pendingSaveFile;
+
+    const bool resumeFollow = m_resumeFollowAfterSave;
+    m_resumeFollowAfterSave = false;
+
+    if (!result.ok) {
+        if (resumeFollow) {
+            m_tailFollower->start(m_currentFile, m_fileSize, m_currentEncoding);
+        }
+        showStatusMessage(QString());
         QMessageBox::warning(m_parentWindow,
             tr("保存失败"),
-            tr("写入文件 %1 时出错。")
-            .arg(QFileInfo(fileName).fileName()));
-        return false;
+            tr("无法保存到 %1:\n%2")
+            .arg(QFileInfo(fileName).fileName(),
+                result.errorString));
+        return;
     }
 
-    // 更新状态
-    m_editor->document()->setModified(false);
-    setCurrentFile(fileName);
+    // 保存期间没有新建或打开其他文档时才更新当前文档状态
+    if (m_pendingSaveGeneration == m_documentGeneration) {
+        // 快照之后又有输入时保持已修改状态
+        if (m_pendingSaveRevision == m_contentRevision) {
+            m_editor->document()->setModified(false);
+        }
+        setCurrentFile(fileName);
+
+        // 已保存的编辑不再需要日志，只保留快照之后的记录
+        m_journal->rebase(m_editor->hasLongLines() ? QString() : fileName, m_pendingSaveCheckpoint);
+
+        m_fileSize = result.bytesWritten;
+        if (m_currentCompression != m_pendingSaveCompression) {
+            m_currentCompression = m_pendingSaveCompression;
+            setCurrentEncoding(m_currentEncoding, m_crlf);
+        }
+        if (resumeFollow) {
+            m_tailFollower->start(fileName, m_fileSize, m_currentEncoding);
+        }
+    }
+    else if (fileName != m_currentFile) {
+        QFile::remove(EditJournal::journalPathFor(fileName));
+    }
 
     // 显示状态消息
     showStatusMessage(tr("保存成功"));
@@ -161,37 +344,235 @@ bool FileManager::saveToFile(const QString& fileName)
     // 发射信号
     emit fileSaved();
     emit requestUpdateStats();
-
-    return true;
 }
 
 bool FileManager::loadFile(const QString& fileName)
 {
-    QFile file(fileName);
-    if (!file.open(QFile::ReadOnly | QFile::Text)) {
+    TRACE_SCOPE("FileManager::loadFile");
+
+    // 避免读到正在写入的文件
+    waitForPendingSave();
+
+    // 检测编码并流式解码
+    return applyLoadResult(fileName, DocumentReader::read(fileName));
+}
+
+bool FileManager::applyLoadResult(const QString& fileName, const DocumentReader::Result& result)
+{
+    if (!result.ok) {
+        showStatusMessage(QString());
         QMessageBox::warning(m_parentWindow,
             tr("打开失败"),
             tr("无法打开文件 %1:\n%2")
             .arg(QFileInfo(fileName).fileName(),
-                file.errorString()));
+                result.errorString));
         return false;
     }
 
-    // 读取文件内容
-    QTextStream in(&file);
-#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
-    in.setCodec("UTF-8");
-#endif
-    const QString content = in.readAll();
-    file.close();
-
-    // 设置到编辑器
-    m_editor->setPlainText(content);
+    // 设置到编辑器，大文件使用纯文本模式
+    ++m_documentGeneration;
+    m_journal->attach(QString());
+    m_editor->setMode(m_editor->modeForSize(qint64(result.text.size()) * 2), false);
+    m_editor->setPlainText(result.text);
     m_editor->document()->setModified(false);
 
+    // 保存时沿用原文件的编码、换行和压缩格式
+    m_currentCompression = result.compression;
+    setCurrentEncoding(result.encoding, result.crlf);
+    m_fileSize = result.bytesRead;
+
     return true;
 }
 
+FileManager::DocumentState FileManager::detachDocument()
+{
+    // 保存结果要落到发起保存的文档上，切换之前处理掉
+    finishPendingSave();
+    setFollowTail(false);
+    m_journal->flush();
+
+    DocumentState state;
+    state.fileName = m_currentFile;
+    state.encoding = m_currentEncoding;
+    state.crlf = m_crlf;
+    state.compression = m_currentCompression;
+    state.fileSize = m_fileSize;
+    return state;
+}
+
+void FileManager::attachDocument(const DocumentState& state)
+{
+    ++m_documentGeneration;
+    m_currentCompression = state.compression;
+    m_fileSize = state.fileSize;
+    setCurrentEncoding(state.encoding, state.crlf);
+
+    // 有修改的文档在原日志后继续记录，未修改的文档没有需要保留的日志
+    if (m_editor->hasLongLines() || state.fileName.isEmpty()) {
+        m_journal->attach(QString());
+    }
+    else {
+        m_journal->attach(state.fileName, isModified());
+    }
+
+    setCurrentFile(state.fileName);
+    emit fileLoaded();
+    emit requestUpdateStats();
+}
+
+void FileManager::recoverJournal(const QString& fileName)
+{
+    // 超长行拆分显示后文档位置和文件内容对不上，不记录编辑日志
+    if (m_editor->hasLongLines()) {
+        m_journal->attach(QString());
+        return;
+    }
+
+    if (!EditJournal::hasJournal(fileName)) {
+        m_journal->attach(fileName);
+        return;
+    }
+
+    const QMessageBox::StandardButton ret = QMessageBox::question(
+        m_parentWindow,
+        tr("恢复编辑"),
+        tr("发现 %1 上次未保存的编辑记录，是否恢复？")
+        .arg(QFileInfo(fileName).fileName()),
+        QMessageBox::Yes | QMessageBox::No,
+        QMessageBox::Yes
+    );
+
+    if (ret != QMessageBox::Yes) {
+        m_journal->attach(fileName);
+        return;
+    }
+
+    // 回放期间不重复记录，回放后继续在原日志后追加；恢复的内容作为撤销历史的起点
+    int replayed = 0;
+    m_journal->setSuspended(true);
+    {
+        const UndoManager::Suspender suspender(m_editor->undoManager());
+        replayed = EditJournal::replay(fileName, m_editor->document());
+    }
+    m_journal->setSuspended(false);
+    m_journal->attach(fileName, replayed > 0);
+
+    if (replayed > 0) {
+        showStatusMessage(tr("已恢复 %1 条未保存的编辑").arg(replayed));
+        emit requestUpdateStats();
+    }
+}
+
+void FileManager::setCurrentEncoding(EncodingDetector::Encoding encoding, bool crlf)
+{
+    m_currentEncoding = encoding;
+    m_crlf = crlf;
+
+    QString name = EncodingDetector::displayName(encoding);
+    if (m_currentCompression != CompressionCodec::Format::None) {
+        name += QStringLiteral(" (%1)").arg(CompressionCodec::displayName(m_currentCompression));
+    }
+    emit encodingChanged(name);
+}
+
+bool FileManager::setFollowTail(bool enabled)
+{
+    if (enabled == m_tailFollower->isFollowing()) {
+        return enabled;
+    }
+
+    if (enabled) {
+        if (m_currentFile.isEmpty()) {
+            showStatusMessage(tr("未打开文件，无法跟踪"));
+            emit followTailChanged(false);
+            return false;
+        }
+        if (m_currentCompression != CompressionCodec::Format::None) {
+            showStatusMessage(tr("压缩文件不支持跟踪"));
+            emit followTailChanged(false);
+            return false;
+        }
+        m_tailFollower->start(m_currentFile, m_fileSize, m_currentEncoding);
+        showStatusMessage(tr("正在跟踪 %1 的新增内容").arg(displayFileName()));
+    }
+    else {
+        m_tailFollower->stop();
+    }
+
+    emit followTailChanged(enabled);
+    return enabled;
+}
+
+bool FileManager::isFollowingTail() const
+{
+    return m_tailFollower->isFollowing();
+}
+
+void FileManager::onTailAppended(const QString& text)
+{
+    QTextDocument* document = m_editor->document();
+    const bool wasModified = document->isModified();
+
+    // 视图停在末尾时追加后继续滚动到底
+    QScrollBar* scrollBar = m_editor->verticalScrollBar();
+    const bool atBottom = scrollBar->value() == scrollBar->maximum();
+
+    QTextCursor cursor(document);
+    cursor.movePosition(QTextCursor::End);
+    const int position = cursor.position();
+    {
+        // 统计和匹配通过 textAppended 增量更新，屏蔽 textChanged 避免整篇重算；
+        // 追加的内容来自磁盘，不写入编辑日志，也不能撤销
+        const QSignalBlocker blocker(m_editor);
+        const UndoManager::Suspender suspender(m_editor->undoManager());
+        m_journal->setSuspended(true);
+        cursor.insertText(text);
+        m_journal->setSuspended(false);
+    }
+    document->setModified(wasModified);
+
+    // 文档现在对应到跟踪读到的位置，重新开始跟踪时从这里接着读
+    m_fileSize = m_tailFollower->offset();
+
+    if (atBottom) {
+        scrollBar->setValue(scrollBar->maximum());
+    }
+
+    emit textAppended(m_editor->logicalPosition(position), text);
+}
+
+bool FileManager::reload()
+{
+    if (m_currentFile.isEmpty() || !loadFile(m_currentFile)) {
+        return false;
+    }
+
+    m_journal->attach(m_editor->hasLongLines() ? QString() : m_currentFile);
+    if (m_tailFollower->isFollowing()) {
+        m_tailFollower->start(m_currentFile, m_fileSize, m_currentEncoding);
+    }
+    emit fileLoaded();
+    emit requestUpdateStats();
+    return true;
+}
+
+void FileManager::onTailReset()
+{
+    const QString fileName = m_currentFile;
+
+    // 有未保存修改时不覆盖文档，只从新文件开头继续追加
+    if (isModified()) {
+        m_tailFollower->start(fileName, 0, m_currentEncoding);
+        showStatusMessage(tr("%1 已被截断或轮转").arg(displayFileName()));
+        return;
+    }
+
+    if (!reload()) {
+        m_tailFollower->start(fileName, m_fileSize, m_currentEncoding);
+    }
+    showStatusMessage(tr("%1 已被截断或轮转，已重新加载").arg(displayFileName()));
+}
+
 void FileManager::setCurrentFile(const QString& fileName)
 {
     m_currentFile = fileName;
@@ -0,0 +1,163 @@
+﻿#include "FilteredLineModel.h"
+#include "EditorHost.h"
+#include "BlockIndex.h"
+#include "KMPMatcher.h"
+
+#include <QTextDocument>
+#include <QTimer>
+
+#include <algorithm>
+
+FilteredLineModel::FilteredLineModel(EditorHost* editor, QObject* parent)
+    : QAbstractListModel(parent)
+    , m_editor(editor)
+    , m_invert(false)
+    , m_linesCharge(MemoryAccounting::Tag::FilteredLines)
+    , m_lineCount(0)
+    , m_refilterTimer(new QTimer(this))
+{
+    m_refilterTimer->setSingleShot(true);
+    m_refilterTimer->setInterval(0);
+    connect(m_refilterTimer, &QTimer::timeout, this, &FilteredLineModel::refilter);
+
+    // 行索引跟随编辑器切换文档，连接一次即可
+    const BlockIndex* index = m_editor->blockIndex();
+    connect(index, &BlockIndex::linesChanged, this, &FilteredLineModel::onLinesChanged);
+    connect(index, &BlockIndex::indexReset, m_refilterTimer, qOverload<>(&QTimer::start));
+}
+
+void FilteredLineModel::setFilter(const QString& pattern, bool invert)
+{
+    if (pattern == m_pattern && invert == m_invert) return;
+
+    m_pattern = pattern;
+    m_invert = invert;
+    m_refilterTimer->stop();
+    refilter();
+}
+
+int FilteredLineModel::lineAt(int row) const
+{
+    return row >= 0 && row < m_lines.size() ? m_lines[row] : -1;
+}
+
+int FilteredLineModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : int(m_lines.size());
+}
+
+QVariant FilteredLineModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_lines.size()) return QVariant();
+
+    const int line = m_lines[index.row()];
+    switch (role) {
+    case Qt::DisplayRole: {
+        // 只在视图需要显示时取文本，超长行截断
+        const int begin = lineBegin(line);
+        const int length = qMin(lineEnd(line) - begin, MAX_DISPLAY_CHARS);
+        const int width = int(QString::number(m_lineCount).size());
+        return QStringLiteral("%1  %2").arg(line + 1, width).arg(m_editor->textRange(begin, length));
+    }
+    case Qt::UserRole:
+        return line;
+    default:
+        return QVariant();
+    }
+}
+
+void FilteredLineModel::onLinesChanged(int firstLine, int removedLines, int addedLines)
+{
+    if (m_pattern.isEmpty() || m_refilterTimer->isActive()) return;
+
+    // 整篇替换（打开文件、拆分长行）时等索引稳定后再完整重算
+    if (removedLines >= m_lineCount) {
+        m_refilterTimer->start();
+        return;
+    }
+
+    // 去掉旧范围内的行，之后的行号整体平移，再扫描新范围
+    const int oldEnd = firstLine + removedLines;
+    const int delta = addedLines - removedLines;
+    const int first = int(std::lower_bound(m_lines.begin(), m_lines.end(), firstLine) - m_lines.begin());
+    const int last = int(std::lower_bound(m_lines.begin(), m_lines.end(), oldEnd) - m_lines.begin());
+
+    if (last > first) {
+        beginRemoveRows(QModelIndex(), first, last - 1);
+        m_lines.remove(first, last - first);
+        endRemoveRows();
+    }
+
+    m_lineCount += delta;
+    if (delta != 0 && first < m_lines.size()) {
+        for (int i = first; i < m_lines.size(); ++i) m_lines[i] += delta;
+        emit dataChanged(index(first), index(int(m_lines.size()) - 1), { Qt::DisplayRole, Qt::UserRole });
+    }
+
+    const QVector<int> lines = scanLines(firstLine, firstLine + addedLines - 1);
+    if (!lines.isEmpty()) {
+        beginInsertRows(QModelIndex(), first, first + int(lines.size()) - 1);
+        m_lines.insert(first, lines.size(), 0);
+        std::copy(lines.begin(), lines.end(), m_lines.begin() + first);
+        endInsertRows();
+    }
+    m_linesCharge.set(MemoryAccounting::bytesOf(m_lines));
+
+    emit filterUpdated(int(m_lines.size()), m_lineCount);
+}
+
+void FilteredLineModel::refilter()
+{
+    beginResetModel();
+    m_lineCount = m_editor->blockIndex()->lineCount();
+    m_lines = m_pattern.isEmpty() ? QVector<int>() : scanLines(0, m_lineCount - 1);
+    endResetModel();
+    m_linesCharge.set(MemoryAccounting::bytesOf(m_lines));
+
+    emit filterUpdated(int(m_lines.size()), m_lineCount);
+}
+
+QVector<int> FilteredLineModel::scanLines(int firstLine, int lastLine) const
+{
+    QVector<int> lines;
+    if (firstLine > lastLine) return lines;
+
+    // 整个范围一次查找，再顺序数换行把匹配位置换成行号
+    const int begin = lineBegin(firstLine);
+    const QString text = m_editor->textRange(begin, lineEnd(lastLine) - begin);
+    int line = firstLine;
+    qsizetype scanned = 0;
+    KMPMatcher::forEachMatch(text, m_pattern, [&](int pos) {
+        for (; scanned < pos; ++scanned) {
+            if (text[scanned] == QLatin1Char('\n')) ++line;
+        }
+        if (lines.isEmpty() || lines.last() != line) lines.append(line);
+        return true;
+        });
+
+    if (!m_invert) return lines;
+
+    QVector<int> inverted;
+    inverted.reserve(lastLine - firstLine + 1 - int(lines.size()));
+    auto matched = lines.cbegin();
+    for (int l = firstLine; l <= lastLine; ++l) {
+        if (matched != lines.cend() && *matched == l) {
+            ++matched;
+            continue;
+        }
+        inverted.append(l);
+    }
+    return inverted;
+}
+
+int FilteredLineModel::lineBegin(int line) const
+{
+    return m_editor->logicalPosition(m_editor->blockIndex()->lineStart(line));
+}
+
+int FilteredLineModel::lineEnd(int line) const
+{
+    const BlockIndex* index = m_editor->blockIndex();
+    if (line + 1 < index->lineCount()) return lineBegin(line + 1) - 1;
+    return m_editor->logicalPosition(m_editor->document()->characterCount() - 1);
+}
@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include <QAbstractListModel>
+#include <QString>
+#include <QVector>
+
+#include "MemoryAccounting.h"
+
+class EditorHost;
+class QTimer;
+
+// 只含匹配行的虚拟列表：模型里只保存行号，显示时才从文档取出可见行的文本。
+// 文档变化时按 BlockIndex 报告的行范围增量更新
+class FilteredLineModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit FilteredLineModel(EditorHost* editor, QObject* parent = nullptr);
+    ~FilteredLineModel() override = default;
+
+    // invert 为 true 时列出不含 pattern 的行
+    void setFilter(const QString& pattern, bool invert);
+
+    QString pattern() const { return m_pattern; }
+
+    bool isInverted() const { return m_invert; }
+
+    // 行号从 0 开始
+    int lineAt(int row) const;
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+signals:
+    void filterUpdated(int matchedLines, int totalLines);
+
+private slots:
+    void onLinesChanged(int firstLine, int removedLines, int addedLines);
+
+    void refilter();
+
+private:
+    // 逻辑行 [firstLine, lastLine] 中符合条件的行
+    QVector<int> scanLines(int firstLine, int lastLine) const;
+
+    // 逻辑行起止的逻辑位置，不含换行符
+    int lineBegin(int line) const;
+
+    int lineEnd(int line) const;
+
+private:
+    EditorHost* m_editor;
+    QString m_pattern;
+    bool m_invert;
+    QVector<int> m_lines;       // 符合条件的行号，升序
+    MemoryAccounting::Charge m_linesCharge;
+    int m_lineCount;            // 计算 m_lines 时的总行数
+    QTimer* m_refilterTimer;    // 整篇替换时合并为一次完整重算
+
+    static constexpr int MAX_DISPLAY_CHARS = 1000;  // 每行最多显示的字符数
+};
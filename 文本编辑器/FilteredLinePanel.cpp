@@ -0,0 +1,71 @@
+﻿#include "FilteredLinePanel.h"
+#include "FilteredLineModel.h"
+
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QLineEdit>
+#include <QCheckBox>
+#include <QListView>
+#include <QLabel>
+#include <QFontDatabase>
+
+FilteredLinePanel::FilteredLinePanel(EditorHost* editor, QWidget* parent)
+    : QDockWidget(tr("筛选行"), parent)
+    , m_model(new FilteredLineModel(editor, this))
+    , m_patternEdit(new QLineEdit(this))
+    , m_invertBox(new QCheckBox(tr("反向筛选"), this))
+    , m_view(new QListView(this))
+    , m_statusLabel(new QLabel(this))
+{
+    setObjectName(QStringLiteral("FilteredLinePanel"));
+
+    QWidget* content = new QWidget(this);
+    QVBoxLayout* layout = new QVBoxLayout(content);
+
+    m_patternEdit->setPlaceholderText(tr("要筛选的字符串，回车应用"));
+    QHBoxLayout* filterRow = new QHBoxLayout();
+    filterRow->addWidget(m_patternEdit, 1);
+    filterRow->addWidget(m_invertBox);
+    layout->addLayout(filterRow);
+
+    // 每行等高，视图只向模型请求可见的行
+    m_view->setModel(m_model);
+    m_view->setUniformItemSizes(true);
+    m_view->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    layout->addWidget(m_view, 1);
+    layout->addWidget(m_statusLabel);
+
+    setWidget(content);
+
+    connect(m_patternEdit, &QLineEdit::returnPressed, this, &FilteredLinePanel::applyFilter);
+    connect(m_invertBox, &QCheckBox::toggled, this, &FilteredLinePanel::applyFilter);
+    connect(m_view, &QListView::clicked, this, &FilteredLinePanel::onRowClicked);
+    connect(m_view, &QListView::activated, this, &FilteredLinePanel::onRowClicked);
+    connect(m_model, &FilteredLineModel::filterUpdated, this, &FilteredLinePanel::onFilterUpdated);
+}
+
+void FilteredLinePanel::setPattern(const QString& pattern)
+{
+    m_patternEdit->setText(pattern);
+    applyFilter();
+}
+
+void FilteredLinePanel::applyFilter()
+{
+    m_model->setFilter(m_patternEdit->text(), m_invertBox->isChecked());
+}
+
+void FilteredLinePanel::onRowClicked(const QModelIndex& index)
+{
+    const int line = m_model->lineAt(index.row());
+    if (line >= 0) emit lineActivated(line);
+}
+
+void FilteredLinePanel::onFilterUpdated(int matchedLines, int totalLines)
+{
+    if (m_model->pattern().isEmpty()) {
+        m_statusLabel->setText(tr("共 %1 行").arg(totalLines));
+        return;
+    }
+    m_statusLabel->setText(tr("%1 / %2 行").arg(matchedLines).arg(totalLines));
+}
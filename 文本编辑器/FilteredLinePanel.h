@@ -0,0 +1,42 @@
+﻿#pragma once
+
+#include <QDockWidget>
+
+class EditorHost;
+class FilteredLineModel;
+class QLineEdit;
+class QCheckBox;
+class QListView;
+class QLabel;
+class QModelIndex;
+
+// 筛选行停靠面板：只列出含（或不含）指定字符串的行，点击跳到对应行
+class FilteredLinePanel : public QDockWidget
+{
+    Q_OBJECT
+
+public:
+    explicit FilteredLinePanel(EditorHost* editor, QWidget* parent = nullptr);
+    ~FilteredLinePanel() override = default;
+
+public slots:
+    void setPattern(const QString& pattern);
+
+signals:
+    // 行号从 0 开始
+    void lineActivated(int line);
+
+private slots:
+    void applyFilter();
+
+    void onRowClicked(const QModelIndex& index);
+
+    void onFilterUpdated(int matchedLines, int totalLines);
+
+private:
+    FilteredLineModel* m_model;
+    QLineEdit* m_patternEdit;
+    QCheckBox* m_invertBox;
+    QListView* m_view;
+    QLabel* m_statusLabel;
+};
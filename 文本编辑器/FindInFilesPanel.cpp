@@ -0,0 +1,221 @@
+﻿#include "FindInFilesPanel.h"
+
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFormLayout>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QToolButton>
+#include <QTreeWidget>
+#include <QHeaderView>
+#include <QLabel>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QDir>
+#include <QtConcurrent/QtConcurrentRun>
+
+FindInFilesPanel::FindInFilesPanel(QWidget* parent)
+    : QDockWidget(tr("在文件中查找"), parent)
+    , m_searcher(new FileSearcher(this))
+    , m_directoryEdit(new QLineEdit(this))
+    , m_patternEdit(new QLineEdit(this))
+    , m_filterEdit(new QLineEdit(this))
+    , m_replaceEdit(new QLineEdit(this))
+    , m_searchButton(new QPushButton(tr("查找"), this))
+    , m_replaceButton(new QPushButton(tr("全部替换"), this))
+    , m_results(new QTreeWidget(this))
+    , m_statusLabel(new QLabel(this))
+    , m_replaceWatcher(new QFutureWatcher<FileReplacer::BatchResult>(this))
+{
+    setObjectName(QStringLiteral("FindInFilesPanel"));
+
+    QWidget* content = new QWidget(this);
+    QVBoxLayout* layout = new QVBoxLayout(content);
+
+    QToolButton* browseButton = new QToolButton(content);
+    browseButton->setText(QStringLiteral("..."));
+    QHBoxLayout* directoryRow = new QHBoxLayout();
+    directoryRow->addWidget(m_directoryEdit);
+    directoryRow->addWidget(browseButton);
+
+    m_filterEdit->setPlaceholderText(tr("例如 *.txt;*.log，留空查找全部文件"));
+
+    QFormLayout* form = new QFormLayout();
+    form->addRow(tr("目录:"), directoryRow);
+    form->addRow(tr("查找:"), m_patternEdit);
+    form->addRow(tr("替换为:"), m_replaceEdit);
+    form->addRow(tr("文件类型:"), m_filterEdit);
+    layout->addLayout(form);
+
+    QHBoxLayout* buttonRow = new QHBoxLayout();
+    buttonRow->addWidget(m_statusLabel, 1);
+    buttonRow->addWidget(m_searchButton);
+    buttonRow->addWidget(m_replaceButton);
+    layout->addLayout(buttonRow);
+
+    m_results->setColumnCount(2);
+    m_results->setHeaderLabels({ tr("位置"), tr("内容") });
+    m_results->header()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
+    layout->addWidget(m_results, 1);
+
+    setWidget(content);
+
+    connect(browseButton, &QToolButton::clicked, this, &FindInFilesPanel::onBrowseClicked);
+    connect(m_searchButton, &QPushButton::clicked, this, &FindInFilesPanel::onSearchClicked);
+    connect(m_replaceButton, &QPushButton::clicked, this, &FindInFilesPanel::onReplaceClicked);
+    connect(m_patternEdit, &QLineEdit::returnPressed, this, &FindInFilesPanel::onSearchClicked);
+    connect(m_replaceWatcher, &QFutureWatcher<FileReplacer::BatchResult>::finished,
+        this, &FindInFilesPanel::onReplaceFinished);
+    connect(m_results, &QTreeWidget::itemActivated, this, &FindInFilesPanel::onItemActivated);
+    connect(m_searcher, &FileSearcher::fileMatched, this, &FindInFilesPanel::onFileMatched);
+    connect(m_searcher, &FileSearcher::finished, this, &FindInFilesPanel::onSearchFinished);
+}
+
+void FindInFilesPanel::setPattern(const QString& pattern)
+{
+    if (!pattern.isEmpty()) m_patternEdit->setText(pattern);
+}
+
+void FindInFilesPanel::setDirectory(const QString& directory)
+{
+    if (!directory.isEmpty() && m_directoryEdit->text().isEmpty()) {
+        m_directoryEdit->setText(QDir::toNativeSeparators(directory));
+    }
+}
+
+void FindInFilesPanel::onBrowseClicked()
+{
+    const QString directory = QFileDialog::getExistingDirectory(this, tr("选择目录"), m_directoryEdit->text());
+    if (!directory.isEmpty()) {
+        m_directoryEdit->setText(QDir::toNativeSeparators(directory));
+    }
+}
+
+void FindInFilesPanel::onSearchClicked()
+{
+    // 查找进行中时按钮用于停止
+    if (m_searcher->isRunning()) {
+        m_searcher->stop();
+        return;
+    }
+
+    const QString directory = QDir::fromNativeSeparators(m_directoryEdit->text().trimmed());
+    const QString pattern = m_patternEdit->text();
+    if (directory.isEmpty() || !QDir(directory).exists()) {
+        m_statusLabel->setText(tr("目录不存在"));
+        return;
+    }
+    if (pattern.isEmpty()) {
+        m_statusLabel->setText(tr("请输入查找字符串"));
+        return;
+    }
+
+    QStringList filters;
+    for (const QString& filter : m_filterEdit->text().split(QLatin1Char(';'), Qt::SkipEmptyParts)) {
+        filters.append(filter.trimmed());
+    }
+
+    m_results->clear();
+    m_searchedPattern = pattern;
+    m_statusLabel->setText(tr("正在查找..."));
+    m_searchButton->setText(tr("停止"));
+    m_replaceButton->setEnabled(false);
+    m_searcher->start(directory, pattern, filters);
+}
+
+void FindInFilesPanel::onFileMatched(const QString& fileName, int matchCount, const QVector<FileSearcher::Match>& matches)
+{
+    QTreeWidgetItem* fileItem = new QTreeWidgetItem(m_results);
+    fileItem->setText(0, QDir::toNativeSeparators(fileName));
+    fileItem->setText(1, tr("%1 个匹配").arg(matchCount));
+    fileItem->setData(0, FileRole, fileName);
+    fileItem->setFlags(fileItem->flags() | Qt::ItemIsUserCheckable);
+    fileItem->setCheckState(0, Qt::Checked);
+    fileItem->setData(0, CountRole, matchCount);
+
+    for (const FileSearcher::Match& match : matches) {
+        QTreeWidgetItem* item = new QTreeWidgetItem(fileItem);
+        item->setText(0, QStringLiteral("%1:%2").arg(match.line).arg(match.column));
+        item->setText(1, match.preview);
+        item->setData(0, FileRole, fileName);
+        item->setData(0, LineRole, match.line);
+        item->setData(0, ColumnRole, match.column);
+    }
+
+    if (matchCount > matches.size()) {
+        QTreeWidgetItem* more = new QTreeWidgetItem(fileItem);
+        more->setText(1, tr("还有 %1 个匹配未列出").arg(matchCount - matches.size()));
+    }
+}
+
+void FindInFilesPanel::onSearchFinished(int filesSearched, int filesMatched, int totalMatches, qint64 elapsedMs)
+{
+    m_searchButton->setText(tr("查找"));
+    m_replaceButton->setEnabled(true);
+    m_statusLabel->setText(tr("在 %1 个文件中找到 %2 个匹配，共查找 %3 个文件，用时 %4 ms")
+        .arg(filesMatched).arg(totalMatches).arg(filesSearched).arg(elapsedMs));
+}
+
+void FindInFilesPanel::onItemActivated(QTreeWidgetItem* item)
+{
+    const int line = item->data(0, LineRole).toInt();
+    if (line <= 0) return;
+
+    emit matchActivated(item->data(0, FileRole).toString(), line,
+        item->data(0, ColumnRole).toInt(), int(m_searchedPattern.size()));
+}
+
+void FindInFilesPanel::onReplaceClicked()
+{
+    if (m_searcher->isRunning() || m_replaceWatcher->isRunning()) return;
+
+    // 只替换查找结果中勾选的文件，匹配数即为预览
+    QStringList files;
+    int matches = 0;
+    for (int i = 0; i < m_results->topLevelItemCount(); ++i) {
+        const QTreeWidgetItem* item = m_results->topLevelItem(i);
+        if (item->checkState(0) != Qt::Checked) continue;
+        files.append(item->data(0, FileRole).toString());
+        matches += item->data(0, CountRole).toInt();
+    }
+    if (files.isEmpty() || m_searchedPattern.isEmpty()) {
+        m_statusLabel->setText(tr("请先查找并勾选要替换的文件"));
+        return;
+    }
+
+    const QString replacement = m_replaceEdit->text();
+    const auto ret = QMessageBox::question(this, tr("在文件中替换"),
+        tr("将在 %1 个文件中把 %2 处“%3”替换为“%4”，确定吗？\n任何文件失败时所有文件都保持原样。")
+            .arg(files.size()).arg(matches).arg(m_searchedPattern, replacement),
+        QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
+    if (ret != QMessageBox::Yes) return;
+
+    setBusy(true);
+    m_replacingFiles = files;
+    m_statusLabel->setText(tr("正在替换..."));
+    m_replaceWatcher->setFuture(QtConcurrent::run(&FileReplacer::replaceInFiles, files, m_searchedPattern, replacement));
+}
+
+void FindInFilesPanel::onReplaceFinished()
+{
+    setBusy(false);
+
+    const FileReplacer::BatchResult result = m_replaceWatcher->result();
+    if (!result.ok) {
+        m_statusLabel->setText(tr("替换失败，所有文件已恢复原样：%1：%2")
+            .arg(QDir::toNativeSeparators(result.failedFile), result.errorString));
+        return;
+    }
+
+    // 文件内容已变化，旧的结果不再有效
+    m_results->clear();
+    m_statusLabel->setText(tr("已在 %1 个文件中替换 %2 处").arg(result.filesChanged).arg(result.replaced));
+    emit filesReplaced(m_replacingFiles);
+}
+
+void FindInFilesPanel::setBusy(bool busy)
+{
+    m_searchButton->setEnabled(!busy);
+    m_replaceButton->setEnabled(!busy);
+    m_results->setEnabled(!busy);
+}
@@ -0,0 +1,74 @@
+﻿#pragma once
+
+#include <QDockWidget>
+#include <QFutureWatcher>
+
+#include "FileSearcher.h"
+#include "FileReplacer.h"
+
+class QLineEdit;
+class QPushButton;
+class QTreeWidget;
+class QTreeWidgetItem;
+class QLabel;
+
+// 在文件中查找和替换的停靠面板：结果按文件分组，双击匹配项跳转，
+// 勾选的文件可以一次全部替换
+class FindInFilesPanel : public QDockWidget
+{
+    Q_OBJECT
+
+public:
+    explicit FindInFilesPanel(QWidget* parent = nullptr);
+    ~FindInFilesPanel() override = default;
+
+    void setPattern(const QString& pattern);
+
+    void setDirectory(const QString& directory);
+
+signals:
+    // 行列从 1 开始
+    void matchActivated(const QString& fileName, int line, int column, int length);
+
+    // 替换成功后被改写的文件
+    void filesReplaced(const QStringList& fileNames);
+
+private slots:
+    void onSearchClicked();
+
+    void onReplaceClicked();
+
+    void onReplaceFinished();
+
+    void onBrowseClicked();
+
+    void onFileMatched(const QString& fileName, int matchCount, const QVector<FileSearcher::Match>& matches);
+
+    void onSearchFinished(int filesSearched, int filesMatched, int totalMatches, qint64 elapsedMs);
+
+    void onItemActivated(QTreeWidgetItem* item);
+
+private:
+    void setBusy(bool busy);
+
+private:
+    enum ItemRole {
+        FileRole = Qt::UserRole,
+        LineRole,
+        ColumnRole,
+        CountRole,
+    };
+
+    FileSearcher* m_searcher;
+    QLineEdit* m_directoryEdit;
+    QLineEdit* m_patternEdit;
+    QLineEdit* m_filterEdit;
+    QLineEdit* m_replaceEdit;
+    QPushButton* m_searchButton;
+    QPushButton* m_replaceButton;
+    QTreeWidget* m_results;
+    QLabel* m_statusLabel;
+    QString m_searchedPattern;      // 当前结果对应的查找字符串
+    QFutureWatcher<FileReplacer::BatchResult>* m_replaceWatcher;
+    QStringList m_replacingFiles;   // 正在替换的文件
+};
@@ -1,7 +1,11 @@
 ﻿#include "FindReplaceController.h"
 #include "KMPMatcher.h"
+#include "EditorHost.h"
+#include "BlockIndex.h"
+#include "TextReplacer.h"
+#include "UndoManager.h"
+#include "Trace.h"
 
-#include <QTextEdit>
 #include <QMainWindow>
 #include <QInputDialog>
 #include <QMessageBox>
@@ -10,10 +14,11 @@
 #include <QLineEdit>
 #include <QStatusBar>
 
-FindReplaceController::FindReplaceController(QTextEdit* editor, QMainWindow* parentWindow)
+FindReplaceController::FindReplaceController(EditorHost* editor, QMainWindow* parentWindow)
     : QObject(parentWindow)
     , m_editor(editor)
     , m_parentWindow(parentWindow)
+    , m_matchesCharge(MemoryAccounting::Tag::Matches)
     , m_currentMatch(-1)
 {
 }
@@ -27,16 +32,33 @@ void FindReplaceController::showStatus(const QString& message, int timeout)
     }
 }
 
+void FindReplaceController::setLastPattern(const QString& pattern)
+{
+    if (pattern == m_lastPattern) return;
+
+    m_lastPattern = pattern;
+    emit patternChanged(pattern);
+}
+
 void FindReplaceController::updateMatches()
 {
+    TRACE_SCOPE("FindReplaceController::updateMatches");
+
     if (!m_editor || m_lastPattern.isEmpty()) {
         m_matches.clear();
+        m_matchesCharge.set(0);
         m_currentMatch = -1;
         return;
     }
 
     QString text = m_editor->toPlainText();
-    m_matches = KMPMatcher::search(text, m_lastPattern);
+    const MemoryAccounting::Charge textCopy(MemoryAccounting::Tag::TextCopies, MemoryAccounting::bytesOf(text));
+    m_matches.clear();
+    KMPMatcher::forEachMatch(text, m_lastPattern, [this](int pos) {
+        m_matches.append(pos);
+        return true;
+        });
+    m_matchesCharge.set(m_matches.bytes());
     m_currentMatch = m_matches.isEmpty() ? -1 : 0;
 }
 
@@ -45,16 +67,14 @@ void FindReplaceController::highlightMatch(int matchIndex)
     if (!m_editor || matchIndex < 0 || matchIndex >= m_matches.size())
         return;
 
-    int pos = m_matches[matchIndex];
-    int patternLen = m_lastPattern.size();
-
-    QTextCursor cursor = m_editor->textCursor();
-    cursor.setPosition(pos);
-    cursor.setPosition(pos + patternLen, QTextCursor::KeepAnchor);
+    QTextCursor cursor = m_editor->cursorForRange(m_matches[matchIndex], m_lastPattern.size());
     m_editor->setTextCursor(cursor);
     m_editor->setFocus();
 
-    showStatus(tr("匹配 %1 / %2").arg(matchIndex + 1).arg(m_matches.size()));
+    const BlockIndex* index = m_editor->blockIndex();
+    const int start = cursor.selectionStart();
+    showStatus(tr("匹配 %1 / %2  行 %3, 列 %4").arg(matchIndex + 1).arg(m_matches.size())
+        .arg(index->lineNumber(start) + 1).arg(index->columnNumber(start) + 1));
 }
 
 void FindReplaceController::find()
@@ -73,7 +93,7 @@ void FindReplaceController::find()
     if (!ok || patternStr.isEmpty())
         return;
 
-    m_lastPattern = patternStr;
+    setLastPattern(patternStr);
     updateMatches();
 
     if (m_matches.isEmpty()) {
@@ -132,7 +152,7 @@ void FindReplaceController::replace()
     if (!ok)
         return;
 
-    m_lastPattern = patternStr;
+    setLastPattern(patternStr);
     m_lastReplace = replaceStr;
     updateMatches();
 
@@ -161,11 +181,8 @@ void FindReplaceController::replace()
         showStatus(tr("已替换当前匹配"));
     }
     else if (msgBox.clickedButton() == replaceAllBtn) {
-        // 替换全部（从后往前替换）
-        for (int i = m_matches.size() - 1; i >= 0; --i) {
-            replaceAtIndex(i, m_lastReplace);
-        }
-        showStatus(tr("已替换全部 %1 个匹配").arg(m_matches.size()));
+        const int replaced = replaceAll(m_lastReplace);
+        showStatus(tr("已替换全部 %1 个匹配").arg(replaced));
     }
 }
 
@@ -183,18 +200,12 @@ void FindReplaceController::replaceNext()
 
     // 找到当前光标位置之后的第一个匹配
     QTextCursor cursor = m_editor->textCursor();
-    int cursorPos = cursor.position();
+    int cursorPos = m_editor->logicalPosition(cursor.position());
 
-    int nextIndex = -1;
-    for (int i = 0; i < m_matches.size(); ++i) {
-        if (m_matches[i] >= cursorPos) {
-            nextIndex = i;
-            break;
-        }
-    }
+    int nextIndex = m_matches.lowerBound(cursorPos);
 
     // 如果没找到后面的，循环到第一个
-    if (nextIndex == -1 && !m_matches.isEmpty()) {
+    if (nextIndex == m_matches.size()) {
         nextIndex = 0;
     }
 
@@ -224,18 +235,12 @@ void FindReplaceController::replacePrev()
 
     // 找到当前光标位置之前的最后一个匹配
     QTextCursor cursor = m_editor->textCursor();
-    int cursorPos = cursor.position();
+    int cursorPos = m_editor->logicalPosition(cursor.position());
 
-    int prevIndex = -1;
-    for (int i = m_matches.size() - 1; i >= 0; --i) {
-        if (m_matches[i] < cursorPos) {
-            prevIndex = i;
-            break;
-        }
-    }
+    int prevIndex = m_matches.lowerBound(cursorPos) - 1;
 
     // 如果没找到前面的，循环到最后一个
-    if (prevIndex == -1 && !m_matches.isEmpty()) {
+    if (prevIndex == -1) {
         prevIndex = m_matches.size() - 1;
     }
 
@@ -267,7 +272,7 @@ void FindReplaceController::deleteAllMatches()
         if (!ok || pattern.isEmpty())
             return;
 
-        m_lastPattern = pattern;
+        setLastPattern(pattern);
     }
 
     updateMatches();
@@ -277,36 +282,86 @@ void FindReplaceController::deleteAllMatches()
         return;
     }
 
-    // 从后向前删除
-    for (int i = m_matches.size() - 1; i >= 0; --i) {
-        int pos = m_matches[i];
-        int len = m_lastPattern.size();
-
-        QTextCursor cursor(m_editor->document());
-        cursor.setPosition(pos);
-        cursor.setPosition(pos + len, QTextCursor::KeepAnchor);
-        cursor.removeSelectedText();
-    }
+    replaceAll(QString());
 
     // 清理状态
     m_matches.clear();
+    m_matchesCharge.set(0);
     m_currentMatch = -1;
-    emit requestUpdate();
 
     showStatus(tr("已删除全部 %1 个匹配").arg(m_lastPattern), 3000);
 }
 
+void FindReplaceController::appendMatches(int position, const QString& appended)
+{
+    if (!m_editor || m_lastPattern.isEmpty() || appended.isEmpty())
+        return;
+
+    // 只在追加的文本和它前面 m-1 个字符里查找，跨越衔接处的匹配也不会漏掉
+    const int overlap = qMin(position, int(m_lastPattern.size()) - 1);
+    const int base = position - overlap;
+
+    QString window = m_editor->textRange(base, overlap);
+    window += appended;
+
+    // 匹配列表不随用户编辑更新，删过文本后新匹配可能落在已有位置之前，
+    // 这时列表已经过时，整篇重新查找
+    bool stale = false;
+    KMPMatcher::forEachMatch(window, m_lastPattern, [this, base, &stale](int offset) {
+        if (base + offset <= m_matches.last()) {
+            stale = true;
+            return false;
+        }
+        m_matches.append(base + offset);
+        return true;
+        });
+    if (stale) {
+        updateMatches();
+        return;
+    }
+    m_matchesCharge.set(m_matches.bytes());
+
+    if (m_currentMatch < 0 && !m_matches.isEmpty()) {
+        m_currentMatch = 0;
+    }
+}
+
+int FindReplaceController::replaceAll(const QString& replaceStr)
+{
+    TRACE_SCOPE("FindReplaceController::replaceAll");
+
+    const QVector<int> targets = TextReplacer::nonOverlapping(m_matches, m_lastPattern.size());
+
+    // 从后向前替换，前面的位置不受影响，不必每次重新查找；
+    // 放在一个编辑块里，只产生一次 contentsChange。
+    // 撤销历史只记下各处位置和前后两个字符串，不保存被替换的整段原文
+    {
+        const UndoManager::Suspender suspender(m_editor->undoManager());
+        QTextCursor block(m_editor->document());
+        block.beginEditBlock();
+        for (int i = targets.size() - 1; i >= 0; --i) {
+            QTextCursor cursor = m_editor->cursorForRange(targets[i], m_lastPattern.size());
+            cursor.insertText(replaceStr);
+        }
+        block.endEditBlock();
+    }
+    m_editor->undoManager()->recordReplaceAll(targets, m_lastPattern, replaceStr);
+
+    updateMatches();
+    emit requestUpdate();
+
+    return targets.size();
+}
+
 bool FindReplaceController::replaceAtIndex(int index, const QString& replaceStr)
 {
+    TRACE_SCOPE("FindReplaceController::replaceAtIndex");
+
     if (!m_editor || index < 0 || index >= m_matches.size())
         return false;
 
-    int pos = m_matches[index];
-    int patternLen = m_lastPattern.size();
-
-    QTextCursor cursor(m_editor->document());
-    cursor.setPosition(pos);
-    cursor.setPosition(pos + patternLen, QTextCursor::KeepAnchor);
+    QTextCursor cursor = m_editor->cursorForRange(m_matches[index], m_lastPattern.size());
+    m_editor->undoManager()->prepareEdit(cursor);
     cursor.insertText(replaceStr);
 
     // 替换后更新匹配列表
@@ -2,17 +2,21 @@
 
 #include <QObject>
 #include <QString>
+#include "MemoryAccounting.h"
+#include "MatchList.h"
 
-class QTextEdit;
+class EditorHost;
 class QMainWindow;
 
 class FindReplaceController : public QObject
 {
     Q_OBJECT
 public:
-    explicit FindReplaceController(QTextEdit* editor, QMainWindow* parentWindow = nullptr);
+    explicit FindReplaceController(EditorHost* editor, QMainWindow* parentWindow = nullptr);
     ~FindReplaceController() override;
 
+    QString lastPattern() const { return m_lastPattern; }
+
 public slots:
     void find();            // ҶԻλһƥ
     void replace();         // 滻Ի滻ǰȫ
@@ -21,26 +25,34 @@ public slots:
     void replaceNext();     // 滻һF4
     void replacePrev();     // 滻һ (Shift+F4)
     void deleteAllMatches(); // ֱɾƥ
+    void appendMatches(int position, const QString& appended); // ı׷ӵĩβ
 
 signals:
     void requestUpdate();
 
+    // һβҵַ仯ɸѡͼݴ˸
+    void patternChanged(const QString& pattern);
+
 private:
     // ƥ
     void highlightMatch(int matchIndex);
     // ָλ滻
     bool replaceAtIndex(int index, const QString& replaceStr);
+    // 滻ȫصƥ䣬滻
+    int replaceAll(const QString& replaceStr);
+    void setLastPattern(const QString& pattern);
     // ƥ
     void updateMatches();
     // ʾ״̬Ϣ
     void showStatus(const QString& message, int timeout = 2000);
 
 private:
-    QTextEdit* m_editor;
+    EditorHost* m_editor;
     QMainWindow* m_parentWindow;
 
     QString m_lastPattern;   // һβҵַ
     QString m_lastReplace;   // һ滻ַ
-    QVector<int> m_matches;  // ƥλбıеλã0-based
+    MatchList m_matches;     // ƥλбıеλã0-based
+    MemoryAccounting::Charge m_matchesCharge;   // ƥбڴ
     int m_currentMatch;      // ǰѡеƥ
 };
\ No newline at end of file
@@ -1,19 +1,74 @@
-#include "fonttextmenu.h"
+#include "FontTextMenu.h"
+#include "UndoManager.h"
 
 #include <QAction>
 #include <QMenu>
 #include <QFontDialog>
 #include <QInputDialog>
-#include <QTextEdit>
 #include <QTextCursor>
 #include <QTextCharFormat>
+#include <QTextDocument>
+#include <QTextBlock>
 #include <QMainWindow>
 #include <QStatusBar>
 #include <QMessageBox>
 #include <QApplication>
 #include <QRegularExpressionValidator>
 
-FontTextMenu::FontTextMenu(QTextEdit* editor, QMainWindow* parentWindow,
+namespace {
+
+// QTextCharFormat::setFont дԣ
+// Ӿɰ浥һ FontFamilyճĵеƬοܴ
+const QTextFormat::Property FONT_PROPERTIES[] = {
+    QTextFormat::FontFamily,
+    QTextFormat::FontFamilies,
+    QTextFormat::FontStyleName,
+    QTextFormat::FontPointSize,
+    QTextFormat::FontPixelSize,
+    QTextFormat::FontSizeAdjustment,
+    QTextFormat::FontWeight,
+    QTextFormat::FontItalic,
+    QTextFormat::FontUnderline,
+    QTextFormat::FontOverline,
+    QTextFormat::FontStrikeOut,
+    QTextFormat::FontFixedPitch,
+    QTextFormat::FontStretch,
+    QTextFormat::FontLetterSpacing,
+    QTextFormat::FontLetterSpacingType,
+    QTextFormat::FontWordSpacing,
+    QTextFormat::FontCapitalization,
+    QTextFormat::FontKerning,
+    QTextFormat::FontStyleHint,
+    QTextFormat::FontStyleStrategy,
+    QTextFormat::FontHintingPreference,
+};
+
+const QTextFormat::Property SIZE_PROPERTIES[] = {
+    QTextFormat::FontPointSize,
+    QTextFormat::FontPixelSize,
+    QTextFormat::FontSizeAdjustment,
+};
+
+template <size_t N>
+bool hasAnyProperty(const QTextFormat& format, const QTextFormat::Property (&properties)[N])
+{
+    for (QTextFormat::Property property : properties) {
+        if (format.hasProperty(property)) return true;
+    }
+    return false;
+}
+
+template <size_t N>
+void clearProperties(QTextFormat& format, const QTextFormat::Property (&properties)[N])
+{
+    for (QTextFormat::Property property : properties) {
+        format.clearProperty(property);
+    }
+}
+
+} // namespace
+
+FontTextMenu::FontTextMenu(EditorHost* editor, QMainWindow* parentWindow,
     QAction* fontAction, QAction* textSizeAction,
     QMenu* targetMenu)
     : QObject(parentWindow)
@@ -106,7 +161,8 @@ void FontTextMenu::onTextSizeTriggered()
     // ȡǰֺ
     qreal currentSize = currentSelectionFontSize();
     if (currentSize <= 0) {
-        currentSize = m_editor->fontPointSize() > 0 ? m_editor->fontPointSize() : 12.0;
+        currentSize = m_editor->document()->defaultFont().pointSizeF() > 0
+            ? m_editor->document()->defaultFont().pointSizeF() : 12.0;
     }
 
     // ԶԻ
@@ -166,19 +222,13 @@ void FontTextMenu::setFont(const QFont& font, bool selectionOnly)
         // Ӧѡı
         QTextCharFormat fmt;
         fmt.setFont(font);
+        m_editor->undoManager()->prepareEdit(cursor);
         cursor.mergeCharFormat(fmt);
         m_editor->setTextCursor(cursor);
     }
     else {
         // Ӧĵ
-        QTextCursor docCursor(m_editor->document());
-        docCursor.select(QTextCursor::Document);
-        QTextCharFormat fmt;
-        fmt.setFont(font);
-        docCursor.mergeCharFormat(fmt);
-
-        // ͬʱñ༭Ĭ壨ں룩
-        m_editor->setFont(font);
+        applyDocumentFont(font, false);
     }
 }
 
@@ -192,21 +242,76 @@ void FontTextMenu::setFontPointSize(qreal pointSize, bool selectionOnly)
         // Ӧѡı
         QTextCharFormat fmt;
         fmt.setFontPointSize(pointSize);
+        m_editor->undoManager()->prepareEdit(cursor);
         cursor.mergeCharFormat(fmt);
         m_editor->setTextCursor(cursor);
     }
     else {
         // Ӧĵ
-        QTextCursor docCursor(m_editor->document());
-        docCursor.select(QTextCursor::Document);
-        QTextCharFormat fmt;
-        fmt.setFontPointSize(pointSize);
-        docCursor.mergeCharFormat(fmt);
-
-        // ͬʱñ༭ĬС
-        QFont font = m_editor->font();
+        QFont font = m_editor->document()->defaultFont();
         font.setPointSizeF(pointSize);
-        m_editor->setFont(font);
+        applyDocumentFont(font, true);
+    }
+}
+
+void FontTextMenu::applyDocumentFont(const QFont& font, bool sizeOnly)
+{
+    QTextDocument* document = m_editor->document();
+
+    // ֱʹĵĬ壬޸ҪдκƬΣҲ볷ջ
+    document->setDefaultFont(font);
+    m_editor->setFont(font);
+
+    auto hasOverride = [sizeOnly](const QTextFormat& format) {
+        return sizeOnly ? hasAnyProperty(format, SIZE_PROPERTIES) : hasAnyProperty(format, FONT_PROPERTIES);
+    };
+
+    // ȲʽûƬδʽԣıĳʱֱӷ
+    bool anyOverride = false;
+    for (const QTextFormat& format : document->allFormats()) {
+        if (format.isCharFormat() && hasOverride(format)) {
+            anyOverride = true;
+            break;
+        }
+    }
+
+    if (anyOverride) {
+        // ռʽԵƬΣ޸ĸʽϲƬΣԲܱ߱߸
+        struct Range {
+            int position;
+            int length;
+            QTextCharFormat format;
+        };
+        QVector<Range> ranges;
+        for (QTextBlock block = document->begin(); block.isValid(); block = block.next()) {
+            for (QTextBlock::iterator it = block.begin(); !it.atEnd(); ++it) {
+                const QTextFragment fragment = it.fragment();
+                if (fragment.isValid() && hasOverride(fragment.charFormat())) {
+                    ranges.append({ fragment.position(), fragment.length(), fragment.charFormat() });
+                }
+            }
+        }
+
+        // ֻĸʽı䣬볷ʷ
+        const UndoManager::Suspender suspender(m_editor->undoManager());
+        QTextCursor cursor(document);
+        cursor.beginEditBlock();
+        for (Range& range : ranges) {
+            if (sizeOnly) clearProperties(range.format, SIZE_PROPERTIES);
+            else clearProperties(range.format, FONT_PROPERTIES);
+            cursor.setPosition(range.position);
+            cursor.setPosition(range.position + range.length, QTextCursor::KeepAnchor);
+            cursor.setCharFormat(range.format);
+        }
+        cursor.endEditBlock();
+    }
+
+    // ҲʹĬ
+    QTextCharFormat current = m_editor->currentCharFormat();
+    if (hasOverride(current)) {
+        if (sizeOnly) clearProperties(current, SIZE_PROPERTIES);
+        else clearProperties(current, FONT_PROPERTIES);
+        m_editor->setCurrentCharFormat(current);
     }
 }
 
@@ -221,8 +326,8 @@ QFont FontTextMenu::currentSelectionFont() const
         return format.font();
     }
 
-    // ûѡıر༭ĵǰ
-    return m_editor->currentFont();
+    // ûѡıصǰʽ壬δõȡĵĬ
+    return m_editor->currentCharFormat().font().resolve(m_editor->document()->defaultFont());
 }
 
 qreal FontTextMenu::currentSelectionFontSize() const
@@ -237,5 +342,5 @@ qreal FontTextMenu::currentSelectionFontSize() const
     }
 
     // ûѡıر༭ĵǰС
-    return m_editor->fontPointSize();
+    return currentSelectionFont().pointSizeF();
 }
\ No newline at end of file
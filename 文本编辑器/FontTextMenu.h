@@ -1,8 +1,8 @@
 #pragma once
 
 #include <QObject>
-#include <QTextEdit>
 #include <QMainWindow>
+#include "EditorHost.h"
 
 class QAction;
 class QMenu;
@@ -12,7 +12,7 @@ class FontTextMenu : public QObject
     Q_OBJECT
 
 public:
-    explicit FontTextMenu(QTextEdit* editor, QMainWindow* parentWindow,
+    explicit FontTextMenu(EditorHost* editor, QMainWindow* parentWindow,
         QAction* fontAction = nullptr,
         QAction* textSizeAction = nullptr,
         QMenu* targetMenu = nullptr);
@@ -42,7 +42,11 @@ private slots:
     void onTextSizeTriggered();
 
 private:
-    QTextEdit* m_editor;
+    // ƪĵЧ޸ĵĬ壬ֻʽԵƬ
+    void applyDocumentFont(const QFont& font, bool sizeOnly);
+
+private:
+    EditorHost* m_editor;
     QMainWindow* m_parentWindow;
     QAction* m_fontAction;    // ʹôģ½
     QAction* m_textSizeAction; // ʹôģ½
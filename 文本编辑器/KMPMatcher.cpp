@@ -1,43 +1,43 @@
 ﻿#include "KMPMatcher.h"
+#include "Trace.h"
 
 QVector<int> KMPMatcher::search(const QString& text, const QString& pattern)
 {
+    TRACE_SCOPE("KMPMatcher::search");
+
     QVector<int> matches;
-    const int n = text.size();
-    const int m = pattern.size();
+    forEachMatch(text, pattern, [&matches](int pos) {
+        matches.append(pos);
+        return true;
+        });
+    return matches;
+}
 
-    if (m == 0 || n == 0 || m > n) {
-        return matches;
-    }
+qsizetype KMPMatcher::count(QStringView text, QStringView pattern)
+{
+    TRACE_SCOPE("KMPMatcher::count");
 
-    // 构建 KMP 数组
-    QString t = "@" + pattern;  // 哨兵，索引从1开始
-    QVector<int> kmp(m + 1, 0);
+    qsizetype result = 0;
+    forEachMatch(text, pattern, [&result](int) {
+        ++result;
+        return true;
+        });
+    return result;
+}
 
-    for (int i = 2, j = 0; i <= m; ++i) {
-        while (j && t[i] != t[j + 1]) {
-            j = kmp[j];
-        }
-        j += (t[i] == t[j + 1]);
-        kmp[i] = j;
-    }
+QVector<int> KMPMatcher::prefixTable(QStringView pattern)
+{
+    const qsizetype m = pattern.size();
+    QVector<int> prefix(m, 0);
 
-    // KMP 匹配
-    QString s = "@" + text;
-    for (int i = 1, j = 0; i <= n; ++i) {
-        while (j && s[i] != t[j + 1]) {
-            j = kmp[j];
-        }
-        if (s[i] == t[j + 1]) {
-            ++j;
-        }
-        if (j == m) {
-            matches.append(i - m);  // 0-bs
-            j = kmp[j];
+    for (qsizetype i = 1, j = 0; i < m; ++i) {
+        while (j && pattern[i] != pattern[j]) {
+            j = prefix[j - 1];
         }
+        j += (pattern[i] == pattern[j]);
+        prefix[i] = int(j);
     }
-
-    return matches;
+    return prefix;
 }
 
 int KMPMatcher::findNext(const QString& text, const QString& pattern, int startPos)
@@ -45,13 +45,13 @@ int KMPMatcher::findNext(const QString& text, const QString& pattern, int startP
     if (startPos < 0) startPos = 0;
     if (startPos >= text.size()) return -1;
 
-    QString subText = text.mid(startPos);
-    QVector<int> matches = search(subText, pattern);
-
-    if (!matches.isEmpty()) {
-        return startPos + matches.first();
-    }
-    return -1;
+    // 找到第一个就停，不复制后半段文本
+    int result = -1;
+    forEachMatch(QStringView(text).mid(startPos), pattern, [&result, startPos](int pos) {
+        result = startPos + pos;
+        return false;
+        });
+    return result;
 }
 
 int KMPMatcher::findPrev(const QString& text, const QString& pattern, int startPos)
@@ -60,11 +60,10 @@ int KMPMatcher::findPrev(const QString& text, const QString& pattern, int startP
         startPos = text.size();
     }
 
-    QString subText = text.left(startPos);
-    QVector<int> matches = search(subText, pattern);
-
-    if (!matches.isEmpty()) {
-        return matches.last();
-    }
-    return -1;
-}
\ No newline at end of file
+    int result = -1;
+    forEachMatch(QStringView(text).left(startPos), pattern, [&result](int pos) {
+        result = pos;
+        return true;
+        });
+    return result;
+}
@@ -2,6 +2,7 @@
 
 #include <QVector>
 #include <QString>
+#include <QStringView>
 
 class KMPMatcher
 {
@@ -11,9 +12,46 @@ public:
 
     static QVector<int> search(const QString& text, const QString& pattern);
 
+    // 按顺序把每个匹配位置（0-based，允许重叠）交给 onMatch，不保存匹配列表。
+    // onMatch 返回 false 时提前结束
+    template <typename Callback>
+    static void forEachMatch(QStringView text, QStringView pattern, Callback&& onMatch);
+
+    // 只计数，不分配匹配列表
+    static qsizetype count(QStringView text, QStringView pattern);
+
     // 查找下一个匹配位置
     static int findNext(const QString& text, const QString& pattern, int startPos = 0);
 
     // 查找上一个匹配位置
     static int findPrev(const QString& text, const QString& pattern, int startPos = -1);
-};
\ No newline at end of file
+
+    // 部分匹配表：prefix[j] 是 pattern 前 j + 1 个字符最长的相等真前后缀的长度
+    static QVector<int> prefixTable(QStringView pattern);
+};
+
+template <typename Callback>
+void KMPMatcher::forEachMatch(QStringView text, QStringView pattern, Callback&& onMatch)
+{
+    const qsizetype n = text.size();
+    const qsizetype m = pattern.size();
+    if (m == 0 || n == 0 || m > n) return;
+
+    const QVector<int> prefix = prefixTable(pattern);
+    const QChar* s = text.data();
+    const QChar* t = pattern.data();
+
+    qsizetype j = 0;
+    for (qsizetype i = 0; i < n; ++i) {
+        while (j && s[i] != t[j]) {
+            j = prefix[j - 1];
+        }
+        if (s[i] == t[j]) {
+            ++j;
+        }
+        if (j == m) {
+            if (!onMatch(int(i + 1 - m))) return;
+            j = prefix[j - 1];
+        }
+    }
+}
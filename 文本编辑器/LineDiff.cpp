@@ -0,0 +1,379 @@
+﻿#include "LineDiff.h"
+
+#include <QThread>
+#include <QElapsedTimer>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+constexpr quint64 HASH_MULTIPLIER = 0xFF51AFD7ED558CCDULL;
+
+// 一次混合 4 个 UTF-16 单元（8 字节），乘法次数是逐字符哈希的四分之一
+quint64 hashLine(QStringView line)
+{
+    const char16_t* data = line.utf16();
+    size_t remaining = size_t(line.size());
+
+    quint64 hash = 0x9E3779B97F4A7C15ULL ^ quint64(remaining);
+    for (; remaining >= 4; remaining -= 4, data += 4) {
+        quint64 word;
+        std::memcpy(&word, data, sizeof(word));
+        hash = (hash ^ word) * HASH_MULTIPLIER;
+        hash ^= hash >> 32;
+    }
+
+    quint64 tail = 0;
+    std::memcpy(&tail, data, remaining * sizeof(char16_t));
+    hash = (hash ^ tail) * HASH_MULTIPLIER;
+    return hash ^ (hash >> 29);
+}
+
+std::vector<QStringView> splitLines(QStringView text)
+{
+    std::vector<QStringView> lines;
+    lines.reserve(size_t(text.count(QLatin1Char('\n')) + 1));
+    for (qsizetype start = 0;;) {
+        const qsizetype end = text.indexOf(QLatin1Char('\n'), start);
+        if (end < 0) {
+            lines.push_back(text.mid(start));
+            break;
+        }
+        lines.push_back(text.mid(start, end - start));
+        start = end + 1;
+    }
+    return lines;
+}
+
+// 按段并行计算行哈希
+std::vector<quint64> hashLines(const std::vector<QStringView>& lines)
+{
+    std::vector<quint64> hashes(lines.size());
+    const size_t chunks = std::clamp<size_t>(lines.size() / 16384, 1, size_t(qMax(QThread::idealThreadCount(), 1)));
+
+    std::vector<size_t> indexes(chunks);
+    std::iota(indexes.begin(), indexes.end(), 0);
+    QtConcurrent::blockingMap(indexes, [&](size_t chunk) {
+        const size_t end = lines.size() * (chunk + 1) / chunks;
+        for (size_t i = lines.size() * chunk / chunks; i < end; ++i) {
+            hashes[i] = hashLine(lines[i]);
+        }
+    });
+    return hashes;
+}
+
+// 线性空间的 Myers 算法：找到中间蛇形后分治，结果为两侧每个元素是否被修改。
+// 编辑距离最多扩展到 costLimit，两个方向的数组按它分配一次，各层递归共用
+template<typename T>
+class Myers
+{
+public:
+    Myers(const T* a, int n, const T* b, int m, int costLimit)
+        : changedA(size_t(n), 0)
+        , changedB(size_t(m), 0)
+        , m_a(a)
+        , m_b(b)
+        , m_costLimit(costLimit)
+        , m_forward(size_t(2 * std::min((n + m + 1) / 2, costLimit + 1) + 2))
+        , m_backward(m_forward.size())
+    {
+        run(0, n, 0, m);
+    }
+
+    std::vector<char> changedA;
+    std::vector<char> changedB;
+
+private:
+    void run(int x0, int x1, int y0, int y1)
+    {
+        // 公共前后缀直接跳过
+        while (x0 < x1 && y0 < y1 && m_a[x0] == m_b[y0]) {
+            ++x0;
+            ++y0;
+        }
+        while (x0 < x1 && y0 < y1 && m_a[x1 - 1] == m_b[y1 - 1]) {
+            --x1;
+            --y1;
+        }
+
+        if (x0 == x1 || y0 == y1) {
+            std::fill(changedA.begin() + x0, changedA.begin() + x1, char(1));
+            std::fill(changedB.begin() + y0, changedB.begin() + y1, char(1));
+            return;
+        }
+
+        int xMid = 0;
+        int yMid = 0;
+        if (!bisect(x0, x1, y0, y1, &xMid, &yMid)) {
+            std::fill(changedA.begin() + x0, changedA.begin() + x1, char(1));
+            std::fill(changedB.begin() + y0, changedB.begin() + y1, char(1));
+            return;
+        }
+        run(x0, xMid, y0, yMid);
+        run(xMid, x1, yMid, y1);
+    }
+
+    // 前向和后向同时扩展，路径重叠处即为分割点
+    bool bisect(int x0, int x1, int y0, int y1, int* xMid, int* yMid)
+    {
+        const T* a = m_a + x0;
+        const T* b = m_b + y0;
+        const int n = x1 - x0;
+        const int m = y1 - y0;
+
+        // d 不超过 costLimit，用到的对角线只有 2 * reach + 2 条
+        const int maxD = (n + m + 1) / 2;
+        const int reach = std::min(maxD, m_costLimit + 1);
+        const int offset = reach;
+        const int length = 2 * reach + 2;
+        int* forward = m_forward.data();
+        int* backward = m_backward.data();
+        std::fill_n(forward, length, -1);
+        std::fill_n(backward, length, -1);
+        forward[offset + 1] = 0;
+        backward[offset + 1] = 0;
+
+        const int delta = n - m;
+        const bool front = (delta % 2 != 0);
+        int k1Start = 0;
+        int k1End = 0;
+        int k2Start = 0;
+        int k2End = 0;
+        int bestX = 0;
+        int bestY = 0;
+        int bestBackX = 0;
+        int bestBackY = 0;
+
+        for (int d = 0; d < maxD; ++d) {
+            // 差异太多时不再求最优，取两个方向中走得更远的点分割，保证大文件的耗时可控；
+            // 只看前向时分割点总靠近开头，剩下的大半段又要从头扩展
+            if (d > m_costLimit) {
+                if (bestBackX + bestBackY > bestX + bestY) {
+                    bestX = n - bestBackX;
+                    bestY = m - bestBackY;
+                }
+                if (bestX + bestY == 0 || (bestX == n && bestY == m)) {
+                    bestX = n / 2;
+                    bestY = m / 2;
+                }
+                *xMid = x0 + bestX;
+                *yMid = y0 + bestY;
+                return true;
+            }
+
+            for (int k1 = -d + k1Start; k1 <= d - k1End; k1 += 2) {
+                const int k1Offset = offset + k1;
+                int x = (k1 == -d || (k1 != d && forward[k1Offset - 1] < forward[k1Offset + 1]))
+                    ? forward[k1Offset + 1] : forward[k1Offset - 1] + 1;
+                int y = x - k1;
+                while (x < n && y < m && a[x] == b[y]) {
+                    ++x;
+                    ++y;
+                }
+                forward[k1Offset] = x;
+
+                if (x > n) {
+                    k1End += 2;
+                }
+                else if (y > m) {
+                    k1Start += 2;
+                }
+                else {
+                    if (x + y > bestX + bestY) {
+                        bestX = x;
+                        bestY = y;
+                    }
+                    if (front) {
+                        const int k2Offset = offset + delta - k1;
+                        if (k2Offset >= 0 && k2Offset < length && backward[k2Offset] != -1
+                            && x >= n - backward[k2Offset]) {
+                            *xMid = x0 + x;
+                            *yMid = y0 + y;
+                            return true;
+                        }
+                    }
+                }
+            }
+
+            for (int k2 = -d + k2Start; k2 <= d - k2End; k2 += 2) {
+                const int k2Offset = offset + k2;
+                int x = (k2 == -d || (k2 != d && backward[k2Offset - 1] < backward[k2Offset + 1]))
+                    ? backward[k2Offset + 1] : backward[k2Offset - 1] + 1;
+                int y = x - k2;
+                while (x < n && y < m && a[n - x - 1] == b[m - y - 1]) {
+                    ++x;
+                    ++y;
+                }
+                backward[k2Offset] = x;
+
+                if (x > n) {
+                    k2End += 2;
+                }
+                else if (y > m) {
+                    k2Start += 2;
+                }
+                else {
+                    if (x + y > bestBackX + bestBackY) {
+                        bestBackX = x;
+                        bestBackY = y;
+                    }
+                    if (front) continue;
+
+                    const int k1Offset = offset + delta - k2;
+                    if (k1Offset >= 0 && k1Offset < length && forward[k1Offset] != -1) {
+                        const int forwardX = forward[k1Offset];
+                        if (forwardX >= n - x) {
+                            *xMid = x0 + forwardX;
+                            *yMid = y0 + offset + forwardX - k1Offset;
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+private:
+    const T* m_a;
+    const T* m_b;
+    int m_costLimit;
+    std::vector<int> m_forward;     // 按对角线记录走到的 x
+    std::vector<int> m_backward;
+};
+
+void appendRow(QString& text, QStringView line)
+{
+    text += line;
+    text += QLatin1Char('\n');
+}
+
+}
+
+LineDiff::Result LineDiff::compare(const QString& left, const QString& right)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    Result result;
+    const std::vector<QStringView> leftLines = splitLines(left);
+    const std::vector<QStringView> rightLines = splitLines(right);
+    const std::vector<quint64> leftHashes = hashLines(leftLines);
+    const std::vector<quint64> rightHashes = hashLines(rightLines);
+    const int n = int(leftLines.size());
+    const int m = int(rightLines.size());
+    result.leftLines = n;
+    result.rightLines = m;
+
+    // 只在一侧出现的行不可能匹配，先标记为修改，不进入 Myers 算法
+    const std::unordered_set<quint64> leftSet(leftHashes.begin(), leftHashes.end());
+    const std::unordered_set<quint64> rightSet(rightHashes.begin(), rightHashes.end());
+
+    std::vector<char> changedA(size_t(n), 1);
+    std::vector<char> changedB(size_t(m), 1);
+    std::vector<quint64> filteredA;
+    std::vector<quint64> filteredB;
+    std::vector<int> indexA;
+    std::vector<int> indexB;
+    for (int i = 0; i < n; ++i) {
+        if (rightSet.count(leftHashes[i])) {
+            filteredA.push_back(leftHashes[i]);
+            indexA.push_back(i);
+        }
+    }
+    for (int j = 0; j < m; ++j) {
+        if (leftSet.count(rightHashes[j])) {
+            filteredB.push_back(rightHashes[j]);
+            indexB.push_back(j);
+        }
+    }
+
+    const Myers<quint64> myers(filteredA.data(), int(filteredA.size()),
+        filteredB.data(), int(filteredB.size()), COST_LIMIT);
+    for (size_t i = 0; i < indexA.size(); ++i) changedA[size_t(indexA[i])] = myers.changedA[i];
+    for (size_t j = 0; j < indexB.size(); ++j) changedB[size_t(indexB[j])] = myers.changedB[j];
+
+    // 哈希相同不一定是同一行，按顺序配对的未修改行再比较一次文本，碰撞的一对按修改处理
+    for (int i = 0, j = 0;; ++i, ++j) {
+        while (i < n && changedA[size_t(i)]) ++i;
+        while (j < m && changedB[size_t(j)]) ++j;
+        if (i >= n || j >= m) break;
+        if (leftLines[size_t(i)] != rightLines[size_t(j)]) {
+            changedA[size_t(i)] = 1;
+            changedB[size_t(j)] = 1;
+        }
+    }
+
+    // 未修改的行两侧按顺序一一对应，其间连续的修改行组成一处差异
+    result.leftText.reserve(left.size() + m);
+    result.rightText.reserve(right.size() + n);
+    int i = 0;
+    int j = 0;
+    int row = 0;
+    while (i < n || j < m) {
+        if (i < n && j < m && !changedA[size_t(i)] && !changedB[size_t(j)]) {
+            appendRow(result.leftText, leftLines[size_t(i++)]);
+            appendRow(result.rightText, rightLines[size_t(j++)]);
+            ++row;
+            continue;
+        }
+
+        Hunk hunk;
+        hunk.leftStart = i;
+        hunk.rightStart = j;
+        while (i < n && (changedA[size_t(i)] || j >= m)) ++i;
+        while (j < m && (changedB[size_t(j)] || i >= n)) ++j;
+        hunk.leftCount = i - hunk.leftStart;
+        hunk.rightCount = j - hunk.rightStart;
+        hunk.row = row;
+        hunk.rows = qMax(hunk.leftCount, hunk.rightCount);
+
+        for (int r = 0; r < hunk.rows; ++r) {
+            appendRow(result.leftText, r < hunk.leftCount ? leftLines[size_t(hunk.leftStart + r)] : QStringView());
+            appendRow(result.rightText, r < hunk.rightCount ? rightLines[size_t(hunk.rightStart + r)] : QStringView());
+        }
+        row += hunk.rows;
+        result.removedLines += hunk.leftCount;
+        result.addedLines += hunk.rightCount;
+        result.hunks.append(hunk);
+    }
+    result.leftText.chop(1);
+    result.rightText.chop(1);
+
+    result.elapsedMs = timer.elapsed();
+    return result;
+}
+
+void LineDiff::refine(QStringView left, QStringView right, QVector<Range>* leftRanges, QVector<Range>* rightRanges)
+{
+    leftRanges->clear();
+    rightRanges->clear();
+
+    if (left.size() > MAX_REFINE_CHARS || right.size() > MAX_REFINE_CHARS) {
+        if (!left.isEmpty()) leftRanges->append({ 0, int(left.size()) });
+        if (!right.isEmpty()) rightRanges->append({ 0, int(right.size()) });
+        return;
+    }
+
+    const Myers<char16_t> myers(left.utf16(), int(left.size()), right.utf16(), int(right.size()), COST_LIMIT);
+
+    // 连续修改的字符合并成一个范围
+    const auto toRanges = [](const std::vector<char>& changed, QVector<Range>* ranges) {
+        for (int i = 0; i < int(changed.size());) {
+            if (!changed[size_t(i)]) {
+                ++i;
+                continue;
+            }
+            const int start = i;
+            while (i < int(changed.size()) && changed[size_t(i)]) ++i;
+            ranges->append({ start, i - start });
+        }
+    };
+    toRanges(myers.changedA, leftRanges);
+    toRanges(myers.changedB, rightRanges);
+}
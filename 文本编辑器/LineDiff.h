@@ -0,0 +1,50 @@
+﻿#pragma once
+
+#include <QString>
+#include <QVector>
+
+// 按行比较两份文本：行先哈希成 64 位整数，在哈希数组上做线性空间的 Myers 差异算法；
+// 字符级的细化只在显示到的差异行上按需计算
+class LineDiff
+{
+public:
+    // 一处差异，对齐显示时占 rows 行
+    struct Hunk {
+        int leftStart = 0;
+        int leftCount = 0;
+        int rightStart = 0;
+        int rightCount = 0;
+        int row = 0;            // 在对齐视图中的起始行
+        int rows = 0;           // max(leftCount, rightCount)
+    };
+
+    struct Result {
+        QString leftText;       // 对齐后的文本，缺少的行以空行填充
+        QString rightText;
+        QVector<Hunk> hunks;
+        int leftLines = 0;
+        int rightLines = 0;
+        int removedLines = 0;   // 左侧独有或被修改的行
+        int addedLines = 0;
+        qint64 elapsedMs = 0;
+    };
+
+    // 字符范围 [start, start + length)
+    struct Range {
+        int start;
+        int length;
+    };
+
+    LineDiff() = default;
+    ~LineDiff() = default;
+
+    // 可在工作线程调用
+    static Result compare(const QString& left, const QString& right);
+
+    // 对一对被修改的行做字符级比较，返回两侧不同的字符范围
+    static void refine(QStringView left, QStringView right, QVector<Range>* leftRanges, QVector<Range>* rightRanges);
+
+private:
+    static constexpr int COST_LIMIT = 4096;         // 编辑距离超过此值时改用近似的分割点
+    static constexpr int MAX_REFINE_CHARS = 10000;  // 超过此长度的行不做字符级比较
+};
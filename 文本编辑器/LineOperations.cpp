@@ -0,0 +1,221 @@
+﻿#include "LineOperations.h"
+#include "StringProcessor.h"
+
+#include <QCollator>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <numeric>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+// 排序键：行和预先解析的行首数字，按值复制不涉及分配
+struct SortKey {
+    QStringView line;
+    double number;
+};
+
+// 解析行首的数字（可带空白、符号和小数），没有数字时按 0 处理
+double leadingNumber(QStringView line)
+{
+    qsizetype i = 0;
+    const qsizetype n = line.size();
+    while (i < n && line[i].isSpace()) ++i;
+
+    bool negative = false;
+    if (i < n && (line[i] == QLatin1Char('-') || line[i] == QLatin1Char('+'))) {
+        negative = line[i] == QLatin1Char('-');
+        ++i;
+    }
+
+    double value = 0;
+    for (; i < n && line[i] >= QLatin1Char('0') && line[i] <= QLatin1Char('9'); ++i) {
+        value = value * 10 + (line[i].unicode() - '0');
+    }
+    if (i < n && line[i] == QLatin1Char('.')) {
+        double scale = 0.1;
+        for (++i; i < n && line[i] >= QLatin1Char('0') && line[i] <= QLatin1Char('9'); ++i) {
+            value += (line[i].unicode() - '0') * scale;
+            scale *= 0.1;
+        }
+    }
+    return negative ? -value : value;
+}
+
+// QCollator 不是线程安全的，每个排序任务构造自己的比较器
+class LineComparator
+{
+public:
+    explicit LineComparator(const LineOperations::Options& options)
+        : m_options(options)
+    {
+        if (m_options.localeAware) {
+            m_collator.setCaseSensitivity(m_options.caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive);
+            m_collator.setNumericMode(m_options.numeric);
+        }
+    }
+
+    bool operator()(const SortKey& a, const SortKey& b) const
+    {
+        const int result = compare(a, b);
+        return m_options.descending ? result > 0 : result < 0;
+    }
+
+private:
+    int compare(const SortKey& a, const SortKey& b) const
+    {
+        if (m_options.localeAware) return m_collator.compare(a.line, b.line);
+
+        if (m_options.numeric && a.number != b.number) return a.number < b.number ? -1 : 1;
+        return a.line.compare(b.line, m_options.caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive);
+    }
+
+private:
+    const LineOperations::Options& m_options;
+    QCollator m_collator;
+};
+
+// 分段并行稳定排序，再逐轮两两归并
+void parallelSort(std::vector<SortKey>& keys, const LineOperations::Options& options, size_t minChunk)
+{
+    const size_t n = keys.size();
+    const size_t chunks = std::clamp<size_t>(n / minChunk, 1, size_t(qMax(QThread::idealThreadCount(), 1)));
+
+    std::vector<size_t> bounds(chunks + 1);
+    for (size_t i = 0; i <= chunks; ++i) bounds[i] = n * i / chunks;
+
+    std::vector<size_t> runs(chunks);
+    std::iota(runs.begin(), runs.end(), 0);
+    QtConcurrent::blockingMap(runs, [&](size_t run) {
+        std::stable_sort(keys.begin() + bounds[run], keys.begin() + bounds[run + 1], LineComparator(options));
+    });
+
+    std::vector<SortKey> buffer(n);
+    std::vector<SortKey>* source = &keys;
+    std::vector<SortKey>* target = &buffer;
+    while (bounds.size() > 2) {
+        // 每轮把相邻两段归并成一段，落单的一段直接复制
+        std::vector<size_t> merged;
+        std::vector<size_t> pairs;
+        for (size_t i = 0; i + 1 < bounds.size(); i += 2) {
+            merged.push_back(bounds[i]);
+            pairs.push_back(i);
+        }
+        merged.push_back(n);
+
+        QtConcurrent::blockingMap(pairs, [&](size_t i) {
+            const auto begin = source->begin();
+            if (i + 2 < bounds.size()) {
+                std::merge(begin + bounds[i], begin + bounds[i + 1], begin + bounds[i + 1], begin + bounds[i + 2],
+                    target->begin() + bounds[i], LineComparator(options));
+            }
+            else {
+                std::copy(begin + bounds[i], begin + bounds[i + 1], target->begin() + bounds[i]);
+            }
+        });
+
+        bounds.swap(merged);
+        std::swap(source, target);
+    }
+
+    if (source != &keys) keys.swap(*source);
+}
+
+struct LineHash {
+    bool caseSensitive;
+    size_t operator()(QStringView line) const noexcept
+    {
+        return caseSensitive ? size_t(qHash(line)) : size_t(StringProcessor::foldedHash(line));
+    }
+};
+
+struct LineEqual {
+    bool caseSensitive;
+    bool operator()(QStringView a, QStringView b) const noexcept
+    {
+        return a.size() == b.size()
+            && a.compare(b, caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive) == 0;
+    }
+};
+
+}
+
+LineOperations::Result LineOperations::apply(const QString& text, const Options& options)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    Result result;
+    if (text.isEmpty()) return result;
+
+    // 末尾的换行不算作一个空行参与处理
+    const QStringView view(text);
+    const bool trailingNewline = view.endsWith(QLatin1Char('\n'));
+    const QStringView body = trailingNewline ? view.chopped(1) : view;
+
+    std::vector<QStringView> lines;
+    lines.reserve(size_t(body.count(QLatin1Char('\n')) + 1));
+    for (qsizetype start = 0;;) {
+        const qsizetype end = body.indexOf(QLatin1Char('\n'), start);
+        if (end < 0) {
+            lines.push_back(body.mid(start));
+            break;
+        }
+        lines.push_back(body.mid(start, end - start));
+        start = end + 1;
+    }
+    result.linesBefore = int(lines.size());
+
+    const Qt::CaseSensitivity cs = options.caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
+    switch (options.operation) {
+    case Operation::Sort: {
+        std::vector<SortKey> keys(lines.size());
+        for (size_t i = 0; i < lines.size(); ++i) {
+            keys[i] = { lines[i], options.numeric && !options.localeAware ? leadingNumber(lines[i]) : 0.0 };
+        }
+        parallelSort(keys, options, MIN_SORT_CHUNK);
+        for (size_t i = 0; i < keys.size(); ++i) lines[i] = keys[i].line;
+        break;
+    }
+    case Operation::Unique: {
+        std::unordered_set<QStringView, LineHash, LineEqual> seen(lines.size(),
+            LineHash{ options.caseSensitive }, LineEqual{ options.caseSensitive });
+        const auto end = std::remove_if(lines.begin(), lines.end(), [&seen](QStringView line) {
+            return !seen.insert(line).second;
+        });
+        lines.erase(end, lines.end());
+        break;
+    }
+    case Operation::Reverse:
+        std::reverse(lines.begin(), lines.end());
+        break;
+    case Operation::Keep:
+    case Operation::Drop: {
+        const bool keep = options.operation == Operation::Keep;
+        const QString& pattern = options.pattern;
+        const auto end = std::remove_if(lines.begin(), lines.end(), [&](QStringView line) {
+            return line.contains(pattern, cs) != keep;
+        });
+        lines.erase(end, lines.end());
+        break;
+    }
+    }
+    result.linesAfter = int(lines.size());
+
+    // 结果一次分配，按顺序拼接各行
+    qsizetype size = trailingNewline ? 1 : 0;
+    for (QStringView line : lines) size += line.size() + 1;
+    result.text.reserve(size);
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if (i > 0) result.text += QLatin1Char('\n');
+        result.text += lines[i];
+    }
+    if (trailingNewline) result.text += QLatin1Char('\n');
+
+    result.elapsedMs = timer.elapsed();
+    return result;
+}
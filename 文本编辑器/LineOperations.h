@@ -0,0 +1,42 @@
+﻿#pragma once
+
+#include <QString>
+
+// 大文本的行操作：排序、去重、反转、保留或删除含指定字符串的行。
+// 所有行都是同一份快照上的 QStringView，处理过程中不为单行分配 QString
+class LineOperations
+{
+public:
+    enum class Operation {
+        Sort,
+        Unique,         // 保留每行第一次出现
+        Reverse,
+        Keep,           // 只保留含 pattern 的行
+        Drop,           // 删除含 pattern 的行
+    };
+
+    struct Options {
+        Operation operation = Operation::Sort;
+        bool descending = false;
+        bool numeric = false;           // 按行首的数字排序
+        bool caseSensitive = true;      // 排序、去重和查找都适用
+        bool localeAware = false;       // 按系统区域设置的排序规则比较
+        QString pattern;
+    };
+
+    struct Result {
+        QString text;
+        int linesBefore = 0;
+        int linesAfter = 0;
+        qint64 elapsedMs = 0;
+    };
+
+    LineOperations() = default;
+    ~LineOperations() = default;
+
+    // 以 \n 分行，文本末尾的换行保持不变（可在工作线程调用）
+    static Result apply(const QString& text, const Options& options);
+
+private:
+    static constexpr size_t MIN_SORT_CHUNK = 64 * 1024;  // 并行排序时每段至少的行数
+};
@@ -0,0 +1,84 @@
+﻿#include "LineOperationsDialog.h"
+
+#include <QFormLayout>
+#include <QVBoxLayout>
+#include <QComboBox>
+#include <QCheckBox>
+#include <QLineEdit>
+#include <QDialogButtonBox>
+#include <QPushButton>
+
+LineOperationsDialog::LineOperationsDialog(bool hasSelection, const QString& pattern, QWidget* parent)
+    : QDialog(parent)
+    , m_operationBox(new QComboBox(this))
+    , m_descendingBox(new QCheckBox(tr("降序"), this))
+    , m_numericBox(new QCheckBox(tr("按数值排序"), this))
+    , m_caseSensitiveBox(new QCheckBox(tr("区分大小写"), this))
+    , m_localeBox(new QCheckBox(tr("按区域设置排序"), this))
+    , m_patternEdit(new QLineEdit(pattern, this))
+    , m_selectionBox(new QCheckBox(tr("只处理选中的行"), this))
+    , m_buttons(new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this))
+{
+    setWindowTitle(tr("行操作"));
+
+    m_operationBox->addItem(tr("排序"), int(LineOperations::Operation::Sort));
+    m_operationBox->addItem(tr("去除重复行"), int(LineOperations::Operation::Unique));
+    m_operationBox->addItem(tr("反转行序"), int(LineOperations::Operation::Reverse));
+    m_operationBox->addItem(tr("保留含有字符串的行"), int(LineOperations::Operation::Keep));
+    m_operationBox->addItem(tr("删除含有字符串的行"), int(LineOperations::Operation::Drop));
+
+    m_caseSensitiveBox->setChecked(true);
+    m_selectionBox->setEnabled(hasSelection);
+    m_selectionBox->setChecked(hasSelection);
+
+    QFormLayout* form = new QFormLayout();
+    form->addRow(tr("操作:"), m_operationBox);
+    form->addRow(tr("字符串:"), m_patternEdit);
+
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    layout->addLayout(form);
+    layout->addWidget(m_descendingBox);
+    layout->addWidget(m_numericBox);
+    layout->addWidget(m_localeBox);
+    layout->addWidget(m_caseSensitiveBox);
+    layout->addWidget(m_selectionBox);
+    layout->addWidget(m_buttons);
+
+    connect(m_operationBox, &QComboBox::currentIndexChanged, this, &LineOperationsDialog::updateControls);
+    connect(m_patternEdit, &QLineEdit::textChanged, this, &LineOperationsDialog::updateControls);
+    connect(m_buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(m_buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    updateControls();
+}
+
+LineOperations::Options LineOperationsDialog::options() const
+{
+    LineOperations::Options options;
+    options.operation = LineOperations::Operation(m_operationBox->currentData().toInt());
+    options.descending = m_descendingBox->isChecked();
+    options.numeric = m_numericBox->isChecked();
+    options.caseSensitive = m_caseSensitiveBox->isChecked();
+    options.localeAware = m_localeBox->isChecked();
+    options.pattern = m_patternEdit->text();
+    return options;
+}
+
+bool LineOperationsDialog::selectionOnly() const
+{
+    return m_selectionBox->isChecked();
+}
+
+void LineOperationsDialog::updateControls()
+{
+    // 只启用当前操作用得到的选项
+    const auto operation = LineOperations::Operation(m_operationBox->currentData().toInt());
+    const bool sort = operation == LineOperations::Operation::Sort;
+    const bool filter = operation == LineOperations::Operation::Keep || operation == LineOperations::Operation::Drop;
+
+    m_descendingBox->setEnabled(sort);
+    m_numericBox->setEnabled(sort);
+    m_localeBox->setEnabled(sort);
+    m_caseSensitiveBox->setEnabled(operation != LineOperations::Operation::Reverse);
+    m_patternEdit->setEnabled(filter);
+    m_buttons->button(QDialogButtonBox::Ok)->setEnabled(!filter || !m_patternEdit->text().isEmpty());
+}
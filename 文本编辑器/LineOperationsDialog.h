@@ -0,0 +1,38 @@
+﻿#pragma once
+
+#include <QDialog>
+
+#include "LineOperations.h"
+
+class QComboBox;
+class QCheckBox;
+class QLineEdit;
+class QDialogButtonBox;
+
+// 选择行操作及其选项
+class LineOperationsDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    LineOperationsDialog(bool hasSelection, const QString& pattern, QWidget* parent = nullptr);
+    ~LineOperationsDialog() override = default;
+
+    LineOperations::Options options() const;
+
+    // 只处理选中内容所在的行
+    bool selectionOnly() const;
+
+private slots:
+    void updateControls();
+
+private:
+    QComboBox* m_operationBox;
+    QCheckBox* m_descendingBox;
+    QCheckBox* m_numericBox;
+    QCheckBox* m_caseSensitiveBox;
+    QCheckBox* m_localeBox;
+    QLineEdit* m_patternEdit;
+    QCheckBox* m_selectionBox;
+    QDialogButtonBox* m_buttons;
+};
@@ -0,0 +1,136 @@
+﻿#include "MatchList.h"
+#include "MemoryAccounting.h"
+
+MatchList::MatchList()
+    : m_chunks()
+    , m_data()
+    , m_count(0)
+    , m_last(-1)
+{
+}
+
+void MatchList::append(int position)
+{
+    Q_ASSERT(position > m_last);
+
+    if (m_count % CHUNK_SIZE == 0) {
+        m_chunks.append({ position, m_data.size() });
+    }
+    else {
+        // 每字节低 7 位存数据，最高位表示后面还有字节
+        quint32 delta = quint32(position - m_last);
+        while (delta >= 0x80) {
+            m_data.append(char((delta & 0x7F) | 0x80));
+            delta >>= 7;
+        }
+        m_data.append(char(delta));
+    }
+
+    m_last = position;
+    ++m_count;
+}
+
+void MatchList::clear()
+{
+    m_chunks = QVector<Chunk>();
+    m_data = QByteArray();
+    m_count = 0;
+    m_last = -1;
+}
+
+int MatchList::at(int index) const
+{
+    Q_ASSERT(index >= 0 && index < m_count);
+
+    const Chunk& chunk = m_chunks[index / CHUNK_SIZE];
+    int value = chunk.first;
+    qsizetype offset = chunk.offset;
+    for (int i = index % CHUNK_SIZE; i > 0; --i) {
+        value += readDelta(offset);
+    }
+    return value;
+}
+
+int MatchList::lowerBound(int position) const
+{
+    if (m_count == 0 || position > m_last) return m_count;
+
+    // 先按块首二分，再在块内顺序解码
+    int low = 0;
+    int high = int(m_chunks.size());
+    while (low < high) {
+        const int mid = (low + high) / 2;
+        if (m_chunks[mid].first < position) low = mid + 1;
+        else high = mid;
+    }
+    if (low == 0) return 0;
+
+    const int chunkIndex = low - 1;
+    const int end = qMin(m_count, (chunkIndex + 1) * CHUNK_SIZE);
+    const_iterator it(this, chunkIndex * CHUNK_SIZE);
+    int index = chunkIndex * CHUNK_SIZE;
+    for (; index < end && *it < position; ++index) {
+        ++it;
+    }
+    return index;
+}
+
+QVector<int> MatchList::toVector() const
+{
+    QVector<int> result;
+    result.reserve(m_count);
+    for (int position : *this) {
+        result.append(position);
+    }
+    return result;
+}
+
+qint64 MatchList::bytes() const
+{
+    return MemoryAccounting::bytesOf(m_chunks) + m_data.capacity();
+}
+
+int MatchList::readDelta(qsizetype& offset) const
+{
+    const uchar* data = reinterpret_cast<const uchar*>(m_data.constData());
+    quint32 delta = 0;
+    int shift = 0;
+    uchar byte;
+    do {
+        byte = data[offset++];
+        delta |= quint32(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return int(delta);
+}
+
+MatchList::const_iterator::const_iterator(const MatchList* list, int index)
+    : m_list(list)
+    , m_index(index)
+    , m_value(0)
+    , m_offset(0)
+{
+    if (index < list->m_count) {
+        // 只从块首开始构造，块内的位置由 ++ 依次解码
+        Q_ASSERT(index % CHUNK_SIZE == 0);
+        const Chunk& chunk = list->m_chunks[index / CHUNK_SIZE];
+        m_value = chunk.first;
+        m_offset = chunk.offset;
+    }
+}
+
+MatchList::const_iterator& MatchList::const_iterator::operator++()
+{
+    ++m_index;
+    if (m_index >= m_list->m_count) return *this;
+
+    if (m_index % CHUNK_SIZE == 0) {
+        const Chunk& chunk = m_list->m_chunks[m_index / CHUNK_SIZE];
+        m_value = chunk.first;
+        m_offset = chunk.offset;
+    }
+    else {
+        m_value += m_list->readDelta(m_offset);
+    }
+    return *this;
+}
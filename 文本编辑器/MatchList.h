@@ -0,0 +1,78 @@
+﻿#pragma once
+
+#include <QByteArray>
+#include <QVector>
+
+// 递增的匹配位置列表的紧凑存储。每 CHUNK_SIZE 个位置为一块，块首的位置原样记下，
+// 其余记与前一个位置的差，用变长整数编码（差小于 128 时只占 1 字节）。
+// 常见字符的匹配间隔很小，平均每个位置 1 字节多一点，QVector<int> 要 4 字节。
+// at 只需解码所在块内靠前的部分，顺序访问用迭代器
+class MatchList
+{
+public:
+    MatchList();
+    ~MatchList() = default;
+
+    // 位置必须严格递增
+    void append(int position);
+
+    void clear();
+
+    int size() const { return m_count; }
+
+    bool isEmpty() const { return m_count == 0; }
+
+    int at(int index) const;
+
+    int operator[](int index) const { return at(index); }
+
+    // 最后一个位置，空列表为 -1
+    int last() const { return m_last; }
+
+    // 第一个不小于 position 的位置的下标，都小于时返回 size()
+    int lowerBound(int position) const;
+
+    QVector<int> toVector() const;
+
+    // 实际占用的堆内存（按容量）
+    qint64 bytes() const;
+
+    class const_iterator
+    {
+    public:
+        const_iterator(const MatchList* list, int index);
+
+        int operator*() const { return m_value; }
+
+        const_iterator& operator++();
+
+        bool operator==(const const_iterator& other) const { return m_index == other.m_index; }
+        bool operator!=(const const_iterator& other) const { return m_index != other.m_index; }
+
+    private:
+        const MatchList* m_list;
+        int m_index;
+        int m_value;
+        qsizetype m_offset;     // 下一个差值在 m_data 中的位置
+    };
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, m_count); }
+
+    static constexpr int CHUNK_SIZE = 64;
+
+private:
+    struct Chunk {
+        int first;              // 块首的位置
+        qsizetype offset;       // 块内差值在 m_data 中的起点
+    };
+
+    // 从 offset 处解码一个差值并前移 offset
+    int readDelta(qsizetype& offset) const;
+
+private:
+    QVector<Chunk> m_chunks;
+    QByteArray m_data;
+    int m_count;
+    int m_last;                 // 最后一个位置，计算下一个差值用
+};
@@ -0,0 +1,65 @@
+﻿#include "MemoryAccounting.h"
+
+#include <QCoreApplication>
+
+void MemoryAccounting::add(Tag tag, qint64 bytes)
+{
+    Counter& counter = s_counters[int(tag)];
+    const qint64 value = counter.current.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    if (bytes > 0) raisePeak(counter, value);
+}
+
+void MemoryAccounting::sample(Tag tag, qint64 bytes)
+{
+    Counter& counter = s_counters[int(tag)];
+    counter.current.store(bytes, std::memory_order_relaxed);
+    raisePeak(counter, bytes);
+}
+
+QVector<MemoryAccounting::Entry> MemoryAccounting::entries()
+{
+    QVector<Entry> result;
+    for (int i = 0; i < int(Tag::Count); ++i) {
+        const Counter& counter = s_counters[i];
+        result.append({ Tag(i), counter.current.load(std::memory_order_relaxed),
+            counter.peak.load(std::memory_order_relaxed) });
+    }
+    return result;
+}
+
+void MemoryAccounting::resetPeaks()
+{
+    for (Counter& counter : s_counters) {
+        counter.peak.store(counter.current.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+}
+
+QString MemoryAccounting::name(Tag tag)
+{
+    switch (tag) {
+    case Tag::Documents:
+        return QCoreApplication::translate("MemoryAccounting", "文档文本（估计）");
+    case Tag::Formats:
+        return QCoreApplication::translate("MemoryAccounting", "文字格式（估计）");
+    case Tag::UndoHistory:
+        return QCoreApplication::translate("MemoryAccounting", "撤销历史");
+    case Tag::BlockIndex:
+        return QCoreApplication::translate("MemoryAccounting", "行索引");
+    case Tag::Matches:
+        return QCoreApplication::translate("MemoryAccounting", "查找结果");
+    case Tag::FilteredLines:
+        return QCoreApplication::translate("MemoryAccounting", "行过滤结果");
+    case Tag::TextCopies:
+        return QCoreApplication::translate("MemoryAccounting", "文本副本");
+    case Tag::Count:
+        break;
+    }
+    return QString();
+}
+
+void MemoryAccounting::raisePeak(Counter& counter, qint64 value)
+{
+    qint64 peak = counter.peak.load(std::memory_order_relaxed);
+    while (value > peak && !counter.peak.compare_exchange_weak(peak, value, std::memory_order_relaxed)) {
+    }
+}
@@ -0,0 +1,88 @@
+﻿#pragma once
+
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+
+// 按类别记账的内存统计：程序自己的数据结构（匹配列表、撤销历史、行索引等）
+// 在容量变化时用 Charge 登记占用，QTextDocument 内部的内存无法逐项统计，
+// 按字符数、块数和格式数估计后用 sample 登记。每个类别记录当前值和峰值
+class MemoryAccounting
+{
+public:
+    enum class Tag {
+        Documents,          // 已加载文档的文本和块（估计）
+        Formats,            // 文档的文字格式（估计）
+        UndoHistory,        // 撤销历史在内存中的部分
+        BlockIndex,         // 行索引的节点
+        Matches,            // 查找结果的位置列表
+        FilteredLines,      // 行过滤结果
+        TextCopies,         // 整篇或大段文本的副本（查找、保存、撤销快照）
+        Count,
+    };
+
+    struct Entry {
+        Tag tag;
+        qint64 current;
+        qint64 peak;
+    };
+
+    MemoryAccounting() = default;
+    ~MemoryAccounting() = default;
+
+    // 增减某个类别的占用，bytes 为负表示释放
+    static void add(Tag tag, qint64 bytes);
+
+    // 直接设置估计类别的当前值
+    static void sample(Tag tag, qint64 bytes);
+
+    static QVector<Entry> entries();
+
+    // 峰值重新从当前值开始记录
+    static void resetPeaks();
+
+    static QString name(Tag tag);
+
+    // 估计类别的数值由采样得到，峰值只反映采样到的最大值
+    static bool isEstimated(Tag tag) { return tag == Tag::Documents || tag == Tag::Formats; }
+
+    template <typename T>
+    static qint64 bytesOf(const QVector<T>& vector) { return qint64(vector.capacity()) * qint64(sizeof(T)); }
+
+    static qint64 bytesOf(const QString& text) { return qint64(text.capacity()) * qint64(sizeof(QChar)); }
+
+    // 某个对象在一个类别下的占用，对象销毁时自动释放
+    class Charge
+    {
+    public:
+        explicit Charge(Tag tag, qint64 bytes = 0) : m_tag(tag), m_bytes(0) { set(bytes); }
+        ~Charge() { set(0); }
+
+        Charge(const Charge&) = delete;
+        Charge& operator=(const Charge&) = delete;
+
+        void set(qint64 bytes)
+        {
+            if (bytes == m_bytes) return;
+            add(m_tag, bytes - m_bytes);
+            m_bytes = bytes;
+        }
+
+        qint64 bytes() const { return m_bytes; }
+
+    private:
+        Tag m_tag;
+        qint64 m_bytes;
+    };
+
+private:
+    struct Counter {
+        std::atomic<qint64> current{ 0 };
+        std::atomic<qint64> peak{ 0 };
+    };
+
+    static void raisePeak(Counter& counter, qint64 value);
+
+    static inline Counter s_counters[int(Tag::Count)];
+};
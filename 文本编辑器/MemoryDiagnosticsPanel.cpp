@@ -0,0 +1,162 @@
+﻿#include "MemoryDiagnosticsPanel.h"
+#include "MemoryAccounting.h"
+#include "DocumentTabs.h"
+
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QPushButton>
+#include <QLabel>
+#include <QTimer>
+#include <QLocale>
+#include <QDateTime>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QMessageBox>
+#include <QSaveFile>
+
+MemoryDiagnosticsPanel::MemoryDiagnosticsPanel(DocumentTabs* tabs, QWidget* parent)
+    : QDockWidget(tr("内存诊断"), parent)
+    , m_tabs(tabs)
+    , m_table(new QTableWidget(0, 3, this))
+    , m_totalLabel(new QLabel(this))
+    , m_refreshTimer(new QTimer(this))
+{
+    setObjectName(QStringLiteral("MemoryDiagnosticsPanel"));
+
+    QWidget* content = new QWidget(this);
+    QVBoxLayout* layout = new QVBoxLayout(content);
+
+    m_table->setHorizontalHeaderLabels({ tr("类别"), tr("当前"), tr("峰值") });
+    m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_table->verticalHeader()->hide();
+    m_table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    layout->addWidget(m_table, 1);
+    layout->addWidget(m_totalLabel);
+
+    QPushButton* resetButton = new QPushButton(tr("重置峰值"), this);
+    QPushButton* exportButton = new QPushButton(tr("导出..."), this);
+    exportButton->setToolTip(tr("把各类别和各文档的内存占用写入文本文件"));
+    QHBoxLayout* buttonRow = new QHBoxLayout();
+    buttonRow->addStretch(1);
+    buttonRow->addWidget(resetButton);
+    buttonRow->addWidget(exportButton);
+    layout->addLayout(buttonRow);
+
+    setWidget(content);
+
+    m_refreshTimer->setInterval(REFRESH_INTERVAL_MS);
+    connect(m_refreshTimer, &QTimer::timeout, this, &MemoryDiagnosticsPanel::refresh);
+    connect(this, &QDockWidget::visibilityChanged, this, [this](bool visible) {
+        if (visible) {
+            refresh();
+            m_refreshTimer->start();
+        }
+        else {
+            m_refreshTimer->stop();
+        }
+        });
+    connect(resetButton, &QPushButton::clicked, this, &MemoryDiagnosticsPanel::resetPeaks);
+    connect(exportButton, &QPushButton::clicked, this, &MemoryDiagnosticsPanel::exportReport);
+}
+
+void MemoryDiagnosticsPanel::refresh()
+{
+    if (!isVisible()) return;
+
+    sampleDocuments();
+
+    const QVector<MemoryAccounting::Entry> entries = MemoryAccounting::entries();
+    const QLocale locale;
+    const auto rightAligned = [](const QString& text) {
+        QTableWidgetItem* item = new QTableWidgetItem(text);
+        item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        return item;
+    };
+
+    qint64 total = 0;
+    m_table->setRowCount(int(entries.size()));
+    for (int row = 0; row < entries.size(); ++row) {
+        const MemoryAccounting::Entry& entry = entries[row];
+
+        QTableWidgetItem* name = new QTableWidgetItem(MemoryAccounting::name(entry.tag));
+        if (MemoryAccounting::isEstimated(entry.tag)) {
+            name->setToolTip(tr("按字符数、块数和格式数估计，峰值为刷新时见到的最大值"));
+        }
+        m_table->setItem(row, 0, name);
+        m_table->setItem(row, 1, rightAligned(locale.formattedDataSize(entry.current)));
+        m_table->setItem(row, 2, rightAligned(locale.formattedDataSize(entry.peak)));
+
+        total += entry.current;
+    }
+
+    m_totalLabel->setText(tr("合计约 %1（QTextDocument 的布局缓存和 Qt 自身的开销不在其中）")
+        .arg(locale.formattedDataSize(total)));
+}
+
+void MemoryDiagnosticsPanel::resetPeaks()
+{
+    MemoryAccounting::resetPeaks();
+    refresh();
+}
+
+void MemoryDiagnosticsPanel::exportReport()
+{
+    const QString fileName = QFileDialog::getSaveFileName(this, tr("导出内存报告"),
+        QStringLiteral("memory-report.txt"), tr("文本文件 (*.txt)"));
+    if (fileName.isEmpty()) return;
+
+    sampleDocuments();
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)
+        || file.write(report().toUtf8()) < 0 || !file.commit()) {
+        QMessageBox::warning(this, tr("导出失败"),
+            tr("无法写入 %1:\n%2").arg(QFileInfo(fileName).fileName(), file.errorString()));
+    }
+}
+
+void MemoryDiagnosticsPanel::sampleDocuments()
+{
+    qint64 documents = 0;
+    qint64 formats = 0;
+    for (const DocumentTabs::TabInfo& info : m_tabs->tabInfos()) {
+        documents += info.bytes;
+        formats += info.formatBytes;
+    }
+    MemoryAccounting::sample(MemoryAccounting::Tag::Documents, documents);
+    MemoryAccounting::sample(MemoryAccounting::Tag::Formats, formats);
+}
+
+QString MemoryDiagnosticsPanel::report() const
+{
+    // 制表符分隔、字节为单位，便于比较前后两次导出
+    QStringList lines;
+    lines << QStringLiteral("# ") + QDateTime::currentDateTime().toString(Qt::ISODate);
+
+    lines << QString() << QStringLiteral("[categories]");
+    lines << QStringList{ tr("类别"), tr("当前"), tr("峰值") }.join(QLatin1Char('\t'));
+    qint64 total = 0;
+    for (const MemoryAccounting::Entry& entry : MemoryAccounting::entries()) {
+        lines << QStringList{ MemoryAccounting::name(entry.tag),
+            QString::number(entry.current), QString::number(entry.peak) }.join(QLatin1Char('\t'));
+        total += entry.current;
+    }
+    lines << tr("合计") + QLatin1Char('\t') + QString::number(total);
+
+    lines << QString() << QStringLiteral("[documents]");
+    lines << QStringList{ tr("文档"), tr("状态"), tr("字符数"), tr("估计内存"),
+        tr("文字格式"), tr("撤销历史"), tr("撤销临时文件") }.join(QLatin1Char('\t'));
+    for (const DocumentTabs::TabInfo& info : m_tabs->tabInfos()) {
+        const QString state = !info.loaded ? tr("已释放")
+            : info.current ? tr("当前")
+            : info.modified ? tr("已修改")
+            : tr("已加载");
+        lines << QStringList{ info.fileName.isEmpty() ? info.title : info.fileName, state,
+            QString::number(info.characters), QString::number(info.bytes), QString::number(info.formatBytes),
+            QString::number(info.undoBytes), QString::number(info.undoSpilledBytes) }.join(QLatin1Char('\t'));
+    }
+    return lines.join(QLatin1Char('\n')) + QLatin1Char('\n');
+}
@@ -0,0 +1,40 @@
+﻿#pragma once
+
+#include <QDockWidget>
+
+class DocumentTabs;
+class QTableWidget;
+class QLabel;
+class QTimer;
+
+// 内存诊断停靠面板：按类别列出程序自己的数据结构和文档（估计）占用的内存，
+// 显示当前值和峰值，可重置峰值或把报告导出到文件
+class MemoryDiagnosticsPanel : public QDockWidget
+{
+    Q_OBJECT
+
+public:
+    explicit MemoryDiagnosticsPanel(DocumentTabs* tabs, QWidget* parent = nullptr);
+    ~MemoryDiagnosticsPanel() override = default;
+
+private slots:
+    void refresh();
+
+    void resetPeaks();
+
+    void exportReport();
+
+private:
+    // 按当前标签重新估计文档和格式的占用
+    void sampleDocuments();
+
+    QString report() const;
+
+private:
+    DocumentTabs* m_tabs;
+    QTableWidget* m_table;
+    QLabel* m_totalLabel;
+    QTimer* m_refreshTimer;     // 面板可见时定期刷新
+
+    static constexpr int REFRESH_INTERVAL_MS = 1000;
+};
@@ -0,0 +1,134 @@
+﻿#include "PerfOverlay.h"
+#include "Trace.h"
+
+#include <QTimer>
+#include <QEvent>
+#include <QFontDatabase>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const char* const PAINT_SPAN = "editor.paint";
+
+bool isPaint(const Trace::Event& event)
+{
+    return std::strcmp(event.name, PAINT_SPAN) == 0;
+}
+
+QString milliseconds(qint64 nanoseconds)
+{
+    return QString::number(double(nanoseconds) / 1e6, 'f', 2) + QStringLiteral(" ms");
+}
+
+}
+
+PerfOverlay::PerfOverlay(QWidget* parent)
+    : QLabel(parent)
+    , m_refreshTimer(new QTimer(this))
+{
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    setStyleSheet(QStringLiteral("background-color: rgba(0, 0, 0, 170); color: #e0e0e0; padding: 6px;"));
+    setTextFormat(Qt::PlainText);
+
+    parent->installEventFilter(this);
+
+    m_refreshTimer->setInterval(REFRESH_INTERVAL_MS);
+    connect(m_refreshTimer, &QTimer::timeout, this, &PerfOverlay::refresh);
+}
+
+bool PerfOverlay::eventFilter(QObject* watched, QEvent* event)
+{
+    if (watched == parent() && event->type() == QEvent::Resize) {
+        reposition();
+    }
+    return QLabel::eventFilter(watched, event);
+}
+
+void PerfOverlay::showEvent(QShowEvent* event)
+{
+    QLabel::showEvent(event);
+    refresh();
+    raise();
+    m_refreshTimer->start();
+}
+
+void PerfOverlay::hideEvent(QHideEvent* event)
+{
+    m_refreshTimer->stop();
+    QLabel::hideEvent(event);
+}
+
+void PerfOverlay::refresh()
+{
+    const QVector<Trace::Event> events = Trace::events(RECENT_EVENTS);
+    const quint32 thread = Trace::currentThread();
+
+    // 浮层刷新本身会引起编辑区重绘，绘制单独显示，不算作一次操作
+    int operation = -1;
+    int paint = -1;
+    for (int i = events.size() - 1; i >= 0 && (operation < 0 || paint < 0); --i) {
+        const Trace::Event& event = events[i];
+        if (event.thread != thread) continue;
+        if (isPaint(event)) {
+            if (paint < 0) paint = i;
+        }
+        else if (event.depth == 0 && operation < 0) {
+            operation = i;
+        }
+    }
+
+    QStringList lines;
+    if (!Trace::isEnabled()) {
+        lines << tr("性能跟踪未开启");
+    }
+    if (operation < 0) {
+        lines << tr("还没有记录到操作");
+    }
+    else {
+        // 子区间先于父区间结束，写在它前面；按开始时间排回调用顺序
+        const Trace::Event& parent = events[operation];
+        const qint64 end = parent.startNs + parent.durationNs;
+        QVector<Trace::Event> children;
+        qint64 direct = 0;
+        for (int i = operation - 1; i >= 0; --i) {
+            const Trace::Event& event = events[i];
+            if (event.thread != thread || event.depth == 0) continue;
+            if (event.startNs < parent.startNs) break;
+            if (event.startNs + event.durationNs > end) continue;
+            children.append(event);
+            if (event.depth == 1) direct += event.durationNs;
+        }
+        std::sort(children.begin(), children.end(), [](const Trace::Event& a, const Trace::Event& b) {
+            return a.startNs < b.startNs;
+            });
+
+        lines << QStringLiteral("%1  %2").arg(QString::fromUtf8(parent.name), milliseconds(parent.durationNs));
+        for (const Trace::Event& child : children) {
+            if (lines.size() >= MAX_LINES) {
+                lines << QStringLiteral("  ...");
+                break;
+            }
+            lines << QStringLiteral("%1%2  %3").arg(QString(int(child.depth) * 2, QLatin1Char(' ')),
+                QString::fromUtf8(child.name), milliseconds(child.durationNs));
+        }
+        if (!children.isEmpty() && parent.durationNs > direct) {
+            lines << tr("  其他  %1").arg(milliseconds(parent.durationNs - direct));
+        }
+    }
+    if (paint >= 0) {
+        lines << tr("最近一次绘制  %1").arg(milliseconds(events[paint].durationNs));
+    }
+
+    setText(lines.join(QLatin1Char('\n')));
+    reposition();
+}
+
+void PerfOverlay::reposition()
+{
+    const QWidget* area = parentWidget();
+    adjustSize();
+    move(qMax(0, area->width() - width() - MARGIN), MARGIN);
+}
@@ -0,0 +1,37 @@
+﻿#pragma once
+
+#include <QLabel>
+
+class QTimer;
+
+// 性能浮层：盖在编辑区右上角，显示主线程上最近一次操作的耗时分解
+// （顶层跟踪区间及其嵌套的子区间）和最近一次绘制的耗时。不接收鼠标事件
+class PerfOverlay : public QLabel
+{
+    Q_OBJECT
+
+public:
+    explicit PerfOverlay(QWidget* parent);
+    ~PerfOverlay() override = default;
+
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
+    void showEvent(QShowEvent* event) override;
+
+    void hideEvent(QHideEvent* event) override;
+
+private slots:
+    void refresh();
+
+private:
+    void reposition();
+
+private:
+    QTimer* m_refreshTimer;     // 可见时定期读取跟踪缓冲区
+
+    static constexpr int REFRESH_INTERVAL_MS = 250;
+    static constexpr int RECENT_EVENTS = 4096;      // 只在最近的这些事件里找
+    static constexpr int MAX_LINES = 16;
+    static constexpr int MARGIN = 8;
+};
@@ -4,6 +4,22 @@
 #include "FindReplaceController.h"
 #include "FontTextMenu.h"
 #include "FileManager.h" 
+#include "EncodingDetector.h"
+#include "EditorHost.h"
+#include "BlockIndex.h"
+#include "TextAnalytics.h"
+#include "AnalyticsDialog.h"
+#include "FindInFilesPanel.h"
+#include "FilteredLinePanel.h"
+#include "SyntaxHighlighter.h"
+#include "LineOperationsDialog.h"
+#include "DiffDialog.h"
+#include "DocumentReader.h"
+#include "DocumentTabs.h"
+#include "DocumentMemoryPanel.h"
+#include "MemoryDiagnosticsPanel.h"
+#include "UndoManager.h"
+#include "PerfOverlay.h"
 
 #include <QMessageBox>
 #include <QGridLayout>
@@ -16,15 +32,42 @@
 #include <QShortcut>
 #include <QTimer>
 #include <QMenu> 
+#include <QInputDialog>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QSignalBlocker>
+#include <QPointer>
+#include <QCloseEvent>
+
+namespace {
+
+// 后台读取并比较的结果，读取失败时不做比较
+struct CompareOutcome {
+    bool ok = false;
+    QString errorString;
+    LineDiff::Result diff;
+};
+
+}
 
 QtWidgetsApplication::QtWidgetsApplication(QWidget* parent)
     : QMainWindow(parent)
     , m_editor(nullptr)
+    , m_editorHost(nullptr)
     , m_fileManager(nullptr)     
-    , m_processor(nullptr)
+    , m_documentTabs(nullptr)
     , m_findController(nullptr)
     , m_fontController(nullptr)
+    , m_highlighter(nullptr)
+    , m_findInFilesPanel(nullptr)
+    , m_filteredLinePanel(nullptr)
+    , m_memoryPanel(nullptr)
+    , m_diagnosticsPanel(nullptr)
+    , m_perfOverlay(nullptr)
+    , m_paintProbe(nullptr)
     , m_statsLabel(nullptr)
+    , m_positionLabel(nullptr)
+    , m_encodingLabel(nullptr)
     , m_findAction(nullptr)
     , m_replaceAction(nullptr)
     , m_deleteAction(nullptr)
@@ -47,19 +90,32 @@ QtWidgetsApplication::QtWidgetsApplication(QWidget* parent)
 
     initShortcuts();
 
-    initFontMenu();
-
-    updateStats();
+    // 查找替换和字体控制器在首次使用时创建；空文档的统计就是初始的全 0，不必计算
+    connect(ui.MenuText, &QMenu::aboutToShow, this, &QtWidgetsApplication::initFontMenu);
 }
 
 QtWidgetsApplication::~QtWidgetsApplication()
 {
     delete m_findController;
-    delete m_processor;
     delete m_fontController;
     delete m_fileManager; 
 }
 
+void QtWidgetsApplication::openFileInBackground(const QString& fileName)
+{
+    statusBar()->showMessage(tr("正在打开 %1 ...").arg(QFileInfo(fileName).fileName()));
+    m_documentTabs->openFileInBackground(fileName);
+}
+
+void QtWidgetsApplication::closeEvent(QCloseEvent* event)
+{
+    if (m_documentTabs && !m_documentTabs->maybeSaveAll()) {
+        event->ignore();
+        return;
+    }
+    QMainWindow::closeEvent(event);
+}
+
 
 void QtWidgetsApplication::initEditor()
 {
@@ -70,12 +126,24 @@ void QtWidgetsApplication::initEditor()
     if (!ui.centralWidget->layout()) {
         QGridLayout* layout = new QGridLayout(ui.centralWidget);
         layout->setContentsMargins(0, 0, 0, 0);
-        layout->addWidget(m_editor, 0, 0, 1, 1); // 占据整个网格
-        layout->setRowStretch(0, 1);
+        layout->setSpacing(0);
+        layout->addWidget(m_editor, 1, 0, 1, 1); // 第 0 行留给文档标签
+        layout->setRowStretch(1, 1);
         layout->setColumnStretch(0, 1);
     }
 
     m_editor->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+
+    // 控制器统一通过 EditorHost 访问编辑器，纯文本控件按需创建
+    m_editorHost = new EditorHost(m_editor, this);
+    m_paintProbe = new Trace::PaintProbe(this);
+    m_editorHost->viewport()->installEventFilter(m_paintProbe);
+    connect(m_editorHost, &EditorHost::modeChanged, this, [this](EditorHost::Mode mode) {
+        const QSignalBlocker blocker(ui.PlainTextMode);
+        ui.PlainTextMode->setChecked(mode == EditorHost::Mode::PlainText);
+        // 纯文本编辑器首次切换时才创建，重复安装不会重复过滤
+        m_editorHost->viewport()->installEventFilter(m_paintProbe);
+        });
 }
 
 
@@ -100,32 +168,70 @@ void QtWidgetsApplication::initActions()
     if (m_deleteAction) {
         connect(m_deleteAction, &QAction::triggered, this, &QtWidgetsApplication::on_Delete_triggered);
     }
+
+    // 命令行 --trace-file 会在启动时开启跟踪
+    const QSignalBlocker traceBlocker(ui.EnableTrace);
+    ui.EnableTrace->setChecked(Trace::isEnabled());
 }
 
 void QtWidgetsApplication::initControllers()
 {
     // 创建文件管理器
-    m_fileManager = new FileManager(m_editor, this);
+    m_fileManager = new FileManager(m_editorHost, this);
 
     // 连接文件管理器信号
     connect(m_fileManager, &FileManager::requestUpdateStats,
         this, &QtWidgetsApplication::updateStats);
+    connect(m_fileManager, &FileManager::encodingChanged, this, [this](const QString& name) {
+        if (m_encodingLabel) m_encodingLabel->setText(name);
+        });
+    connect(m_fileManager, &FileManager::followTailChanged, ui.FollowTail, &QAction::setChecked);
 
-    // 创建查找/替换控制器
-    m_findController = new FindReplaceController(m_editor, this);
-    connect(m_findController, &FindReplaceController::requestUpdate,
-        this, &QtWidgetsApplication::updateStats);
+    // 文档标签放在编辑器上方，每个标签持有自己的文档
+    m_documentTabs = new DocumentTabs(m_editorHost, m_fileManager, ui.centralWidget);
+    if (QGridLayout* grid = qobject_cast<QGridLayout*>(ui.centralWidget->layout())) {
+        grid->addWidget(m_documentTabs, 0, 0, 1, 1);
+    }
+
+    // 跟踪文件末尾时只处理新增的文本
+    connect(m_fileManager, &FileManager::textAppended,
+        this, &QtWidgetsApplication::onTextAppended);
+
+    // 打开和另存为后按新的文件名选择语法
+    m_highlighter = new SyntaxHighlighter(m_editorHost, this);
+    connect(m_fileManager, &FileManager::fileLoaded, this, &QtWidgetsApplication::updateSyntax);
+    connect(m_fileManager, &FileManager::fileSaved, this, &QtWidgetsApplication::updateSyntax);
 }
 
 void QtWidgetsApplication::initStats()
 {
-    m_processor = new StringProcessor();
     m_statsLabel = new QLabel(this);
     m_statsLabel->setText(tr("总: 0 中文: 0 英文: 0 数字: 0 符号: 0"));
     statusBar()->addPermanentWidget(m_statsLabel);
 
+    // 光标位置，行列号由行索引得到，不扫描全文
+    m_positionLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(m_positionLabel);
+    connect(m_editorHost, &EditorHost::cursorPositionChanged,
+        this, &QtWidgetsApplication::updateCursorPosition);
+    connect(m_editorHost, &EditorHost::documentReplaced,
+        this, &QtWidgetsApplication::updateCursorPosition);
+    updateCursorPosition();
+
+    // 当前文档的编码
+    m_encodingLabel = new QLabel(this);
+    m_encodingLabel->setText(EncodingDetector::displayName(m_fileManager->currentEncoding()));
+    statusBar()->addPermanentWidget(m_encodingLabel);
+
+    // 选区变化时只重新统计选区
+    connect(m_editorHost, &EditorHost::selectionChanged, this, &QtWidgetsApplication::showStats);
+
     // 文本变化时更新统计
-    connect(m_editor, &QTextEdit::textChanged, this, &QtWidgetsApplication::updateStats);
+    connect(m_editorHost, &EditorHost::textChanged, this, &QtWidgetsApplication::updateStats);
+
+    connect(m_editorHost->undoManager(), &UndoManager::historyTruncated, this, [this]() {
+        showTemporaryHint(tr("修改范围过大，之前的撤销历史已清空"), 4000);
+        });
 }
 
 void QtWidgetsApplication::initShortcuts()
@@ -138,25 +244,43 @@ void QtWidgetsApplication::initShortcuts()
 
     // 连接快捷键
     connect(m_shortcutFindNext, &QShortcut::activated, this, [this]() {
-        if (m_findController) m_findController->findNext();
+        findController()->findNext();
         });
     connect(m_shortcutFindPrev, &QShortcut::activated, this, [this]() {
-        if (m_findController) m_findController->findPrev();
+        findController()->findPrev();
         });
     connect(m_shortcutReplaceNext, &QShortcut::activated, this, [this]() {
-        if (m_findController) m_findController->replaceNext();
+        findController()->replaceNext();
         });
     connect(m_shortcutReplacePrev, &QShortcut::activated, this, [this]() {
-        if (m_findController) m_findController->replacePrev();
+        findController()->replacePrev();
         });
 }
 
+FindReplaceController* QtWidgetsApplication::findController()
+{
+    if (m_findController) return m_findController;
+
+    m_findController = new FindReplaceController(m_editorHost, this);
+    connect(m_findController, &FindReplaceController::requestUpdate,
+        this, &QtWidgetsApplication::updateStats);
+
+    // 筛选行面板可能先于控制器打开
+    if (m_filteredLinePanel) {
+        connect(m_findController, &FindReplaceController::patternChanged,
+            m_filteredLinePanel, &FilteredLinePanel::setPattern);
+    }
+    return m_findController;
+}
+
 void QtWidgetsApplication::initFontMenu()
 {
+    if (m_fontController) return;
+
     QMenu* formatMenu = findChild<QMenu*>("MenuText");
 
     // 创建字体控制器
-    m_fontController = new FontTextMenu(m_editor, this, m_fontAction, m_textSizeAction, formatMenu);
+    m_fontController = new FontTextMenu(m_editorHost, this, m_fontAction, m_textSizeAction, formatMenu);
 
     // 连接字体控制器的信号
     connect(m_fontController, &FontTextMenu::fontChanged, this, [this](const QFont& font) {
@@ -171,12 +295,12 @@ void QtWidgetsApplication::initFontMenu()
 
 void QtWidgetsApplication::on_NewFile_triggered()
 {
-    m_fileManager->newFile();
+    m_documentTabs->newTab();
 }
 
 void QtWidgetsApplication::on_OpenFile_triggered()
 {
-    m_fileManager->openFile();
+    m_documentTabs->openFile();
 }
 
 void QtWidgetsApplication::on_SaveFile_triggered()
@@ -184,40 +308,406 @@ void QtWidgetsApplication::on_SaveFile_triggered()
     m_fileManager->save();
 }
 
+void QtWidgetsApplication::on_CloseTab_triggered()
+{
+    m_documentTabs->closeTab(m_documentTabs->currentIndex());
+}
+
+void QtWidgetsApplication::on_FollowTail_toggled(bool checked)
+{
+    m_fileManager->setFollowTail(checked);
+}
+
+void QtWidgetsApplication::on_KeepCompression_toggled(bool checked)
+{
+    m_fileManager->setKeepCompression(checked);
+}
+
+void QtWidgetsApplication::on_PlainTextMode_toggled(bool checked)
+{
+    const EditorHost::Mode mode = checked ? EditorHost::Mode::PlainText : EditorHost::Mode::RichText;
+    m_editorHost->setPreferredMode(mode);
+    m_editorHost->setMode(mode);
+}
+
 
 void QtWidgetsApplication::on_Find_triggered()
 {
     showTemporaryHint(tr("查找: 按 F3 查找下一个, Shift+F3 查找上一个"), 4000);
-    if (m_findController) m_findController->find();
+    findController()->find();
 }
 
 void QtWidgetsApplication::on_Replace_triggered()
 {
     showTemporaryHint(tr("替换: 按 F4 替换下一个, Shift+F4 替换上一个"), 5000);
-    if (m_findController) m_findController->replace();
+    findController()->replace();
 }
 
 void QtWidgetsApplication::on_Delete_triggered()
 {
-    if (!m_findController) return;
-
     auto ret = QMessageBox::question(this, tr("删除匹配"),
-        tr("确定要删除所有与最近一次查找匹配的字符串吗？此操作不可撤销。"),
+        tr("确定要删除所有与最近一次查找匹配的字符串吗？删除后可按 Ctrl+Z 撤销。"),
         QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
     if (ret != QMessageBox::Yes) return;
 
     showTemporaryHint(tr("正在删除所有匹配..."), 2000);
-    m_findController->deleteAllMatches();
+    findController()->deleteAllMatches();
+}
+
+
+void QtWidgetsApplication::on_GoToLine_triggered()
+{
+    const BlockIndex* index = m_editorHost->blockIndex();
+    const int current = index->lineNumber(m_editorHost->textCursor().position()) + 1;
+
+    bool ok = false;
+    const int line = QInputDialog::getInt(this, tr("转到行"),
+        tr("行号 (1 - %1)：").arg(index->lineCount()),
+        current, 1, index->lineCount(), 1, &ok);
+    if (!ok) return;
+
+    moveCursorToLine(line - 1);
+}
+
+
+void QtWidgetsApplication::moveCursorToLine(int line)
+{
+    QTextCursor cursor = m_editorHost->textCursor();
+    cursor.setPosition(m_editorHost->blockIndex()->lineStart(line));
+    m_editorHost->setTextCursor(cursor);
+    m_editorHost->setFocus();
+}
+
+
+void QtWidgetsApplication::on_Analyze_triggered()
+{
+    // 在后台分析当前文本的快照，完成后弹出结果
+    QFutureWatcher<TextAnalytics::Result>* watcher = new QFutureWatcher<TextAnalytics::Result>(this);
+    connect(watcher, &QFutureWatcher<TextAnalytics::Result>::finished, this, [this, watcher]() {
+        watcher->deleteLater();
+        ui.Analyze->setEnabled(true);
+        statusBar()->clearMessage();
+
+        AnalyticsDialog* dialog = new AnalyticsDialog(watcher->result(), this);
+        dialog->setAttribute(Qt::WA_DeleteOnClose);
+        dialog->show();
+        });
+
+    ui.Analyze->setEnabled(false);
+    statusBar()->showMessage(tr("正在分析..."));
+    watcher->setFuture(QtConcurrent::run(&TextAnalytics::analyze, m_editorHost->toPlainText(), 50, 0));
+}
+
+
+void QtWidgetsApplication::on_FindInFiles_triggered()
+{
+    if (!m_findInFilesPanel) {
+        m_findInFilesPanel = new FindInFilesPanel(this);
+        addDockWidget(Qt::BottomDockWidgetArea, m_findInFilesPanel);
+        connect(m_findInFilesPanel, &FindInFilesPanel::matchActivated, this, &QtWidgetsApplication::openMatch);
+        connect(m_findInFilesPanel, &FindInFilesPanel::filesReplaced, this, &QtWidgetsApplication::onFilesReplaced);
+    }
+
+    // 默认在当前文件所在目录下查找最近一次查找的字符串
+    const QString currentFile = m_fileManager->currentFileName();
+    if (!currentFile.isEmpty()) m_findInFilesPanel->setDirectory(QFileInfo(currentFile).absolutePath());
+    if (m_findController) m_findInFilesPanel->setPattern(m_findController->lastPattern());
+
+    m_findInFilesPanel->show();
+    m_findInFilesPanel->raise();
+}
+
+
+void QtWidgetsApplication::on_FilterLines_triggered()
+{
+    if (!m_filteredLinePanel) {
+        m_filteredLinePanel = new FilteredLinePanel(m_editorHost, this);
+        addDockWidget(Qt::RightDockWidgetArea, m_filteredLinePanel);
+        connect(m_filteredLinePanel, &FilteredLinePanel::lineActivated, this, &QtWidgetsApplication::moveCursorToLine);
+        if (m_findController) {
+            connect(m_findController, &FindReplaceController::patternChanged,
+                m_filteredLinePanel, &FilteredLinePanel::setPattern);
+            m_filteredLinePanel->setPattern(m_findController->lastPattern());
+        }
+    }
+
+    m_filteredLinePanel->show();
+    m_filteredLinePanel->raise();
+}
+
+
+void QtWidgetsApplication::on_LineOperations_triggered()
+{
+    const QTextCursor selection = m_editorHost->textCursor();
+    LineOperationsDialog dialog(selection.hasSelection(),
+        m_findController ? m_findController->lastPattern() : QString(), this);
+    if (dialog.exec() != QDialog::Accepted) return;
+
+    // 处理范围按逻辑位置记录，选中时扩展到完整的行
+    int start = 0;
+    QString text;
+    if (dialog.selectionOnly() && selection.hasSelection()) {
+        const BlockIndex* index = m_editorHost->blockIndex();
+        const int firstLine = index->lineNumber(selection.selectionStart());
+        int lastLine = index->lineNumber(selection.selectionEnd());
+        if (lastLine > firstLine && index->columnNumber(selection.selectionEnd()) == 0) --lastLine;
+
+        start = m_editorHost->logicalPosition(index->lineStart(firstLine));
+        const int end = lastLine + 1 < index->lineCount()
+            ? m_editorHost->logicalPosition(index->lineStart(lastLine + 1)) - 1
+            : m_editorHost->logicalPosition(m_editorHost->document()->characterCount() - 1);
+        text = m_editorHost->textRange(start, end - start);
+    }
+    else {
+        text = m_editorHost->toPlainText();
+    }
+    const int length = int(text.size());
+
+    // 在后台处理快照，完成时文档已被修改则放弃结果
+    const QPointer<QTextDocument> document = m_editorHost->document();
+    const int revision = document->revision();
+
+    QFutureWatcher<LineOperations::Result>* watcher = new QFutureWatcher<LineOperations::Result>(this);
+    connect(watcher, &QFutureWatcher<LineOperations::Result>::finished, this,
+        [this, watcher, document, revision, start, length]() {
+        watcher->deleteLater();
+        ui.LineOperations->setEnabled(true);
+
+        if (document != m_editorHost->document() || document->revision() != revision) {
+            showTemporaryHint(tr("文档在处理期间被修改，行操作已取消"), 3000);
+            return;
+        }
+
+        // 整体替换为一个编辑块，一步即可撤销
+        const LineOperations::Result result = watcher->result();
+        QTextCursor cursor = m_editorHost->cursorForRange(start, length);
+        m_editorHost->undoManager()->prepareEdit(cursor);
+        cursor.beginEditBlock();
+        cursor.insertText(result.text);
+        cursor.endEditBlock();
+
+        statusBar()->showMessage(tr("行操作完成：%1 行变为 %2 行，用时 %3 ms")
+            .arg(result.linesBefore).arg(result.linesAfter).arg(result.elapsedMs), 5000);
+        });
+
+    ui.LineOperations->setEnabled(false);
+    statusBar()->showMessage(tr("正在处理行..."));
+    watcher->setFuture(QtConcurrent::run(&LineOperations::apply, text, dialog.options()));
+}
+
+
+void QtWidgetsApplication::on_CompareFiles_triggered()
+{
+    const QString currentFile = m_fileManager->currentFileName();
+    const QString fileName = QFileDialog::getOpenFileName(this, tr("选择要比较的文件"),
+        currentFile.isEmpty() ? QString() : QFileInfo(currentFile).absolutePath());
+    if (fileName.isEmpty()) return;
+
+    // 左侧直接用已加载的当前文档，右侧文件和读取当前文档一样解压、识别编码
+    const QString leftName = currentFile.isEmpty() ? tr("未命名") : QFileInfo(currentFile).fileName();
+    const QString rightName = QFileInfo(fileName).fileName();
+
+    QFutureWatcher<CompareOutcome>* watcher = new QFutureWatcher<CompareOutcome>(this);
+    connect(watcher, &QFutureWatcher<CompareOutcome>::finished, this, [this, watcher, fileName, leftName, rightName]() {
+        watcher->deleteLater();
+        ui.CompareFiles->setEnabled(true);
+        statusBar()->clearMessage();
+
+        const CompareOutcome outcome = watcher->result();
+        if (!outcome.ok) {
+            QMessageBox::warning(this, tr("比较文件"),
+                tr("无法读取 %1:\n%2").arg(QFileInfo(fileName).fileName(), outcome.errorString));
+            return;
+        }
+
+        DiffDialog* dialog = new DiffDialog(outcome.diff, leftName, rightName, this);
+        dialog->setAttribute(Qt::WA_DeleteOnClose);
+        dialog->show();
+        });
+
+    ui.CompareFiles->setEnabled(false);
+    statusBar()->showMessage(tr("正在比较..."));
+    watcher->setFuture(QtConcurrent::run([text = m_editorHost->toPlainText(), fileName]() {
+        CompareOutcome outcome;
+        const DocumentReader::Result loaded = DocumentReader::read(fileName);
+        if (!loaded.ok) {
+            outcome.errorString = loaded.errorString;
+            return outcome;
+        }
+        outcome.ok = true;
+        outcome.diff = LineDiff::compare(text, loaded.text);
+        return outcome;
+        }));
+}
+
+
+void QtWidgetsApplication::on_DocumentMemory_triggered()
+{
+    if (!m_memoryPanel) {
+        m_memoryPanel = new DocumentMemoryPanel(m_documentTabs, m_editorHost->undoManager(), this);
+        addDockWidget(Qt::RightDockWidgetArea, m_memoryPanel);
+    }
+
+    m_memoryPanel->show();
+    m_memoryPanel->raise();
+}
+
+
+void QtWidgetsApplication::on_MemoryDiagnostics_triggered()
+{
+    if (!m_diagnosticsPanel) {
+        m_diagnosticsPanel = new MemoryDiagnosticsPanel(m_documentTabs, this);
+        addDockWidget(Qt::RightDockWidgetArea, m_diagnosticsPanel);
+    }
+
+    m_diagnosticsPanel->show();
+    m_diagnosticsPanel->raise();
+}
+
+
+void QtWidgetsApplication::on_EnableTrace_toggled(bool checked)
+{
+    Trace::setEnabled(checked);
+    if (!checked) ui.ShowPerfOverlay->setChecked(false);
+
+    showTemporaryHint(checked ? tr("性能跟踪已开启") : tr("性能跟踪已关闭"), 2000);
+}
+
+
+void QtWidgetsApplication::on_ShowPerfOverlay_toggled(bool checked)
+{
+    // 浮层要有数据可显示，打开时一并开启跟踪
+    if (checked && !ui.EnableTrace->isChecked()) {
+        ui.EnableTrace->setChecked(true);
+    }
+
+    if (!m_perfOverlay) {
+        if (!checked) return;
+        m_perfOverlay = new PerfOverlay(ui.centralWidget);
+    }
+    m_perfOverlay->setVisible(checked);
+}
+
+
+void QtWidgetsApplication::on_ExportTrace_triggered()
+{
+    if (Trace::events().isEmpty()) {
+        QMessageBox::information(this, tr("导出跟踪"), tr("还没有跟踪记录，请先开启性能跟踪并执行要分析的操作。"));
+        return;
+    }
+
+    const QString fileName = QFileDialog::getSaveFileName(this, tr("导出跟踪"),
+        QStringLiteral("trace.json"), tr("Chrome 跟踪 (*.json)"));
+    if (fileName.isEmpty()) return;
+
+    QString errorString;
+    if (!Trace::exportChromeTrace(fileName, &errorString)) {
+        QMessageBox::warning(this, tr("导出失败"),
+            tr("无法写入 %1:\n%2").arg(QFileInfo(fileName).fileName(), errorString));
+        return;
+    }
+    showTemporaryHint(tr("跟踪已导出到 %1").arg(QFileInfo(fileName).fileName()), 3000);
+}
+
+
+void QtWidgetsApplication::openMatch(const QString& fileName, int line, int column, int length)
+{
+    const QString target = QFileInfo(fileName).canonicalFilePath();
+    const QString currentFile = m_fileManager->currentFileName();
+    if (currentFile.isEmpty() || QFileInfo(currentFile).canonicalFilePath() != target) {
+        if (!m_documentTabs->openFile(target)) return;
+    }
+
+    // 行列从 1 开始，列按逻辑位置计算（不含长行的分段）
+    const BlockIndex* index = m_editorHost->blockIndex();
+    if (line > index->lineCount()) return;
+
+    const int logical = m_editorHost->logicalPosition(index->lineStart(line - 1)) + column - 1;
+    m_editorHost->setTextCursor(m_editorHost->cursorForRange(logical, length));
+    m_editorHost->setFocus();
+}
+
+
+void QtWidgetsApplication::onFilesReplaced(const QStringList& fileNames)
+{
+    // 后台标签中未修改的文档直接释放，激活时读取新内容
+    for (const QString& fileName : fileNames) {
+        m_documentTabs->releaseFile(fileName);
+    }
+
+    const QString currentFile = m_fileManager->currentFileName();
+    if (currentFile.isEmpty()) return;
+
+    const QString current = QFileInfo(currentFile).canonicalFilePath();
+    bool affected = false;
+    for (const QString& fileName : fileNames) {
+        if (QFileInfo(fileName).canonicalFilePath() == current) {
+            affected = true;
+            break;
+        }
+    }
+    if (!affected) return;
+
+    // 当前文件没有未保存的修改时重新载入，否则保留编辑内容并提示
+    if (m_fileManager->isModified()) {
+        showTemporaryHint(tr("当前文件已在磁盘上被替换，编辑器中仍是修改前的内容"), 5000);
+    }
+    else {
+        m_fileManager->reload();
+    }
+}
+
+
+void QtWidgetsApplication::updateSyntax()
+{
+    m_highlighter->setDefinition(SyntaxDefinition::forFileName(m_fileManager->currentFileName()));
 }
 
 
 void QtWidgetsApplication::updateStats()
 {
-    if (!m_processor || !m_editor) return;
+    TRACE_SCOPE("QtWidgetsApplication::updateStats");
 
-    auto res = m_processor->process(m_editor->toPlainText());
-    m_statsLabel->setText(tr("总: %1  中文: %2  英文: %3  数字: %4  符号: %5")
-        .arg(res.total).arg(res.chinese).arg(res.letters).arg(res.digits).arg(res.symbols));
+    if (!m_editorHost) return;
+
+    // 统计随编辑按块增量维护，这里只取汇总值
+    m_stats = m_editorHost->blockIndex()->totalStats();
+    showStats();
+}
+
+void QtWidgetsApplication::onTextAppended(int position, const QString& text)
+{
+    updateStats();
+
+    if (m_findController) m_findController->appendMatches(position, text);
+}
+
+void QtWidgetsApplication::updateCursorPosition()
+{
+    if (!m_positionLabel) return;
+
+    const BlockIndex* index = m_editorHost->blockIndex();
+    const int position = m_editorHost->textCursor().position();
+    m_positionLabel->setText(tr("行 %1, 列 %2")
+        .arg(index->lineNumber(position) + 1).arg(index->columnNumber(position) + 1));
+}
+
+void QtWidgetsApplication::showStats()
+{
+    TRACE_SCOPE("QtWidgetsApplication::showStats");
+
+    QString text = tr("总: %1  中文: %2  英文: %3  数字: %4  符号: %5")
+        .arg(m_stats.total).arg(m_stats.chinese).arg(m_stats.letters).arg(m_stats.digits).arg(m_stats.symbols);
+
+    // 有选区时附加选区的统计
+    const QTextCursor cursor = m_editorHost->textCursor();
+    if (cursor.hasSelection()) {
+        const StringProcessor::Result selected = m_editorHost->blockIndex()->rangeStats(
+            cursor.selectionStart(), cursor.selectionEnd());
+        text += tr("    选中 总: %1  中文: %2  英文: %3  数字: %4  符号: %5")
+            .arg(selected.total).arg(selected.chinese).arg(selected.letters).arg(selected.digits).arg(selected.symbols);
+    }
+    m_statsLabel->setText(text);
 }
 
 void QtWidgetsApplication::showTemporaryHint(const QString& hint, int timeout)
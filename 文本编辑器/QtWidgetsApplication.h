@@ -2,16 +2,26 @@
 
 #include <QtWidgets/QMainWindow>
 #include "ui_QtWidgetsApplication.h"
+#include "StringProcessor.h"
+#include "Trace.h"
 #include <QString>
 
 class QTextEdit;
 class QLabel;
-class StringProcessor;
+class EditorHost;
 class FileManager;           
 class FindReplaceController;
 class FontTextMenu;
+class FindInFilesPanel;
+class FilteredLinePanel;
+class SyntaxHighlighter;
+class DocumentTabs;
+class DocumentMemoryPanel;
+class PerfOverlay;
+class MemoryDiagnosticsPanel;
 class QAction;
 class QShortcut;
+class QCloseEvent;
 
 class QtWidgetsApplication : public QMainWindow
 {
@@ -21,16 +31,45 @@ public:
     QtWidgetsApplication(QWidget* parent = nullptr);
     ~QtWidgetsApplication();
 
+    DocumentTabs* documentTabs() const { return m_documentTabs; }
+
+    // 在工作线程读取和解码文件，完成后在新标签中打开，窗口期间保持响应
+    void openFileInBackground(const QString& fileName);
+
+protected:
+    // 逐个询问有修改的标签，取消时不关闭窗口
+    void closeEvent(QCloseEvent* event) override;
+
 private slots:
     void on_NewFile_triggered();
     void on_OpenFile_triggered();
     void on_SaveFile_triggered();
+    void on_CloseTab_triggered();
+    void on_FollowTail_toggled(bool checked);
+    void on_KeepCompression_toggled(bool checked);
+    void on_PlainTextMode_toggled(bool checked);
 
     void on_Find_triggered();
     void on_Replace_triggered();
     void on_Delete_triggered();
+    void on_GoToLine_triggered();
+    void on_Analyze_triggered();
+    void on_FindInFiles_triggered();
+    void on_FilterLines_triggered();
+    void on_LineOperations_triggered();
+    void on_CompareFiles_triggered();
+    void on_DocumentMemory_triggered();
+    void on_MemoryDiagnostics_triggered();
+    void on_EnableTrace_toggled(bool checked);
+    void on_ShowPerfOverlay_toggled(bool checked);
+    void on_ExportTrace_triggered();
 
     void updateStats();
+    void onTextAppended(int position, const QString& text);
+    void updateCursorPosition();
+    void openMatch(const QString& fileName, int line, int column, int length);
+    void onFilesReplaced(const QStringList& fileNames);
+    void updateSyntax();
 
 private:
     // 初始化函数
@@ -41,21 +80,37 @@ private:
     void initShortcuts();
     void initFontMenu();
 
+    // 首次使用时创建
+    FindReplaceController* findController();
+
     // 辅助函数
     void showTemporaryHint(const QString& hint, int timeout);
+    void showStats();
+    void moveCursorToLine(int line);
 
 private:
     Ui::QtWidgetsApplicationClass ui;
     QTextEdit* m_editor;
+    EditorHost* m_editorHost;            // 当前编辑器（富文本或纯文本）
 
     // 控制器
     FileManager* m_fileManager;          
-    StringProcessor* m_processor;
+    DocumentTabs* m_documentTabs;        // 多文档标签，位于编辑器上方
+    StringProcessor::Result m_stats;     // 当前文档的统计结果
     FindReplaceController* m_findController;
     FontTextMenu* m_fontController;
+    SyntaxHighlighter* m_highlighter;    // 按文件扩展名着色
+    FindInFilesPanel* m_findInFilesPanel;   // 首次使用时创建
+    FilteredLinePanel* m_filteredLinePanel; // 首次使用时创建
+    DocumentMemoryPanel* m_memoryPanel;     // 首次使用时创建
+    MemoryDiagnosticsPanel* m_diagnosticsPanel; // 首次使用时创建
+    PerfOverlay* m_perfOverlay;             // 首次使用时创建
+    Trace::PaintProbe* m_paintProbe;        // 跟踪编辑区的绘制耗时
 
     // 界面组件
     QLabel* m_statsLabel;
+    QLabel* m_positionLabel;             // 光标所在行列
+    QLabel* m_encodingLabel;
 
     // 动作（从UI获取）
     QAction* m_findAction;
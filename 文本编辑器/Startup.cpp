@@ -0,0 +1,207 @@
+﻿#include "Startup.h"
+#include "QtWidgetsApplication.h"
+#include "DocumentTabs.h"
+#include "BatchCli.h"
+#include "Trace.h"
+
+#include <QApplication>
+#include <QEvent>
+#include <QTimer>
+#include <QStatusBar>
+#include <QResource>
+#include <QFile>
+#include <QDir>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QStandardPaths>
+
+#include <cstdio>
+
+Startup::Startup(const QElapsedTimer& clock, bool report, QObject* parent)
+    : QObject(parent)
+    , m_clock(clock)
+    , m_report(report)
+    , m_lastTraceNs(Trace::now())
+    , m_phases()
+    , m_window(nullptr)
+    , m_fileName()
+{
+}
+
+void Startup::mark(const char* phase)
+{
+    m_phases.append({ phase, m_clock.nsecsElapsed() });
+
+    if (Trace::isEnabled()) {
+        const qint64 now = Trace::now();
+        Trace::record(phase, m_lastTraceNs, now - m_lastTraceNs, 0);
+        m_lastTraceNs = now;
+    }
+}
+
+void Startup::finish(QtWidgetsApplication* window, const QString& fileName)
+{
+    m_window = window;
+    m_fileName = fileName;
+    mark("startup.windowShown");
+    window->installEventFilter(this);
+}
+
+bool Startup::eventFilter(QObject* watched, QEvent* event)
+{
+    if (watched == m_window && event->type() == QEvent::Paint) {
+        m_window->removeEventFilter(this);
+        // 等这一帧画完再继续
+        QTimer::singleShot(0, this, &Startup::onFirstPaint);
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void Startup::onFirstPaint()
+{
+    mark("startup.firstPaint");
+
+    qApp->setStyleSheet(styleSheet());
+    mark("startup.styleSheet");
+
+    if (m_fileName.isEmpty()) {
+        done();
+        return;
+    }
+
+    connect(m_window->documentTabs(), &DocumentTabs::backgroundOpenFinished, this,
+        [this](const QString& fileName) {
+            if (fileName != m_fileName) return;
+            mark("startup.fileOpened");
+            done();
+        }, Qt::SingleShotConnection);
+    m_window->openFileInBackground(m_fileName);
+}
+
+void Startup::done()
+{
+    if (!m_report) return;
+
+    const QString text = report();
+    BatchCli::attachParentConsole();
+    std::fprintf(stderr, "%s\n", text.toLocal8Bit().constData());
+    std::fflush(stderr);
+
+    for (const Phase& phase : m_phases) {
+        if (qstrcmp(phase.name, "startup.firstPaint") == 0) {
+            m_window->statusBar()->showMessage(tr("启动到首次绘制 %1 ms，详见标准错误输出")
+                .arg(phase.elapsedNs / 1e6, 0, 'f', 1), 5000);
+        }
+    }
+}
+
+QString Startup::report() const
+{
+    QStringList lines;
+    lines << QStringLiteral("startup (ms since main()):");
+    qint64 previous = 0;
+    for (const Phase& phase : m_phases) {
+        lines << QStringLiteral("  %1 %2 (+%3)")
+            .arg(QString::fromLatin1(phase.name), -22)
+            .arg(phase.elapsedNs / 1e6, 8, 'f', 1)
+            .arg((phase.elapsedNs - previous) / 1e6, 0, 'f', 1);
+        previous = phase.elapsedNs;
+    }
+    return lines.join(QLatin1Char('\n'));
+}
+
+QPalette Startup::darkPalette()
+{
+    const QColor background(0x19, 0x23, 0x2D);
+    const QColor text(0xE0, 0xE1, 0xE3);
+    const QColor panel(0x37, 0x41, 0x4F);
+    const QColor highlight(0x34, 0x67, 0x92);
+
+    QPalette palette;
+    palette.setColor(QPalette::Window, background);
+    palette.setColor(QPalette::Base, background);
+    palette.setColor(QPalette::AlternateBase, panel);
+    palette.setColor(QPalette::Button, panel);
+    palette.setColor(QPalette::WindowText, text);
+    palette.setColor(QPalette::Text, text);
+    palette.setColor(QPalette::ButtonText, text);
+    palette.setColor(QPalette::ToolTipBase, panel);
+    palette.setColor(QPalette::ToolTipText, text);
+    palette.setColor(QPalette::Highlight, highlight);
+    palette.setColor(QPalette::HighlightedText, text);
+    return palette;
+}
+
+QString Startup::styleSheet()
+{
+    const QResource resource(QString::fromLatin1(STYLE_SHEET));
+    if (!resource.isValid()) return QString();
+
+    // 资源的大小和修改时间作为缓存键，换了样式表自然失效
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    const QString cacheFile = cacheDir + QStringLiteral("/darkstyle-%1-%2.qss")
+        .arg(resource.uncompressedSize())
+        .arg(resource.lastModified().toSecsSinceEpoch());
+
+    QFile cached(cacheFile);
+    if (cached.open(QIODevice::ReadOnly)) {
+        return QString::fromUtf8(cached.readAll());
+    }
+
+    QFile source(QString::fromLatin1(STYLE_SHEET));
+    if (!source.open(QIODevice::ReadOnly)) return QString();
+    const QString compact = compactStyleSheet(QString::fromUtf8(source.readAll()));
+
+    // 缓存写不进去只是下次再处理一遍
+    QDir().mkpath(cacheDir);
+    QSaveFile out(cacheFile);
+    if (out.open(QIODevice::WriteOnly)) {
+        out.write(compact.toUtf8());
+        out.commit();
+    }
+    return compact;
+}
+
+QString Startup::compactStyleSheet(const QString& source)
+{
+    // 去掉 /* */ 注释，空白压成一个空格，并删去 { } ; , 两侧的空白。
+    // 引号内原样保留；冒号两侧不动，"QWidget :hover" 与 "QWidget:hover" 含义不同
+    const auto isPunctuation = [](QChar c) {
+        return c == QLatin1Char('{') || c == QLatin1Char('}') || c == QLatin1Char(';') || c == QLatin1Char(',');
+    };
+
+    QString result;
+    result.reserve(source.size());
+    bool pendingSpace = false;
+    for (qsizetype i = 0; i < source.size(); ++i) {
+        const QChar c = source[i];
+
+        if (c == QLatin1Char('/') && i + 1 < source.size() && source[i + 1] == QLatin1Char('*')) {
+            const qsizetype end = source.indexOf(QLatin1String("*/"), i + 2);
+            i = end < 0 ? source.size() : end + 1;
+            pendingSpace = true;
+            continue;
+        }
+
+        if (c.isSpace()) {
+            pendingSpace = true;
+            continue;
+        }
+
+        if (pendingSpace && !result.isEmpty() && !isPunctuation(c) && !isPunctuation(result.back())) {
+            result += QLatin1Char(' ');
+        }
+        pendingSpace = false;
+
+        if (c == QLatin1Char('"') || c == QLatin1Char('\'')) {
+            const qsizetype end = source.indexOf(c, i + 1);
+            const qsizetype stop = end < 0 ? source.size() : end + 1;
+            result += QStringView(source).mid(i, stop - i);
+            i = stop - 1;
+            continue;
+        }
+
+        result += c;
+    }
+    return result;
+}
@@ -0,0 +1,61 @@
+﻿#pragma once
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QPalette>
+#include <QString>
+#include <QVector>
+
+class QtWidgetsApplication;
+
+// 冷启动流程：窗口先以 Fusion 样式和深色调色板显示，首次绘制之后再应用样式表
+// （预处理后缓存在磁盘上）并在后台打开命令行给出的文件。
+// 各阶段相对 main 入口的时间在跟踪开启时记为 startup.* 区间，--startup-trace 时输出到标准错误
+class Startup : public QObject
+{
+    Q_OBJECT
+
+public:
+    // clock 在 main 的入口处开始计时
+    Startup(const QElapsedTimer& clock, bool report, QObject* parent = nullptr);
+    ~Startup() override = default;
+
+    // 记录一个阶段的结束，phase 须是字符串字面量
+    void mark(const char* phase);
+
+    // 窗口 show 之后调用，fileName 为空时不打开文件
+    void finish(QtWidgetsApplication* window, const QString& fileName);
+
+    // 与样式表相近的调色板，让样式表生效前的第一帧不闪白
+    static QPalette darkPalette();
+
+    // 去掉注释和多余空白后的样式表，资源不变时直接读缓存
+    static QString styleSheet();
+
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
+private:
+    void onFirstPaint();
+
+    void done();
+
+    QString report() const;
+
+    static QString compactStyleSheet(const QString& source);
+
+private:
+    struct Phase {
+        const char* name;
+        qint64 elapsedNs;       // 相对 main 入口
+    };
+
+    QElapsedTimer m_clock;
+    bool m_report;
+    qint64 m_lastTraceNs;       // 上一阶段结束时的 Trace::now()
+    QVector<Phase> m_phases;
+    QtWidgetsApplication* m_window;
+    QString m_fileName;
+
+    static constexpr const char* STYLE_SHEET = ":qdarkstyle/dark/darkstyle.qss";
+};
@@ -28,6 +28,28 @@ StringProcessor::Result StringProcessor::process(const QString& text) const
     return r;
 }
 
+quint64 StringProcessor::foldedHash(QStringView text, quint64 seed)
+{
+    quint64 hash = seed;
+    const qsizetype size = text.size();
+    for (qsizetype i = 0; i < size; ++i) {
+        char32_t cp = text[i].unicode();
+        if (cp < 0x80) {
+            if (cp >= 'A' && cp <= 'Z') cp += 32;
+        }
+        else {
+            if (QChar::isHighSurrogate(cp) && i + 1 < size && text[i + 1].isLowSurrogate()) {
+                cp = QChar::surrogateToUcs4(text[i].unicode(), text[i + 1].unicode());
+                ++i;
+            }
+            cp = QChar::toCaseFolded(cp);
+        }
+        hash ^= cp;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
 bool StringProcessor::isChineseChar(QChar ch) const
 {
     uint uc = ch.unicode();
@@ -1,4 +1,4 @@
-#pragma once
+﻿#pragma once
 
 #include <QString>
 
@@ -11,10 +11,36 @@ public:
         int letters = 0;
         int digits = 0;
         int symbols = 0;
+
+        Result& operator+=(const Result& other)
+        {
+            total += other.total;
+            chinese += other.chinese;
+            letters += other.letters;
+            digits += other.digits;
+            symbols += other.symbols;
+            return *this;
+        }
+
+        Result& operator-=(const Result& other)
+        {
+            total -= other.total;
+            chinese -= other.chinese;
+            letters -= other.letters;
+            digits -= other.digits;
+            symbols -= other.symbols;
+            return *this;
+        }
     };
 
     Result process(const QString& text) const;
 
+    // 忽略大小写的 FNV-1a 哈希：按码点折叠（ASCII 直接转小写，代理对先合成码点），
+    // 与 Qt::CaseInsensitive 的比较一致。seed 传入前一段的哈希可把多段文本串起来
+    static quint64 foldedHash(QStringView text, quint64 seed = FNV_OFFSET_BASIS);
+
+    static constexpr quint64 FNV_OFFSET_BASIS = 14695981039346656037ULL;
+
 private:
     bool isChineseChar(QChar ch) const;
 };
\ No newline at end of file
@@ -0,0 +1,352 @@
+﻿#include "SyntaxDefinition.h"
+
+#include <QFileInfo>
+
+namespace {
+
+inline bool isWordChar(QChar ch)
+{
+    return ch.isLetterOrNumber() || ch == QLatin1Char('_');
+}
+
+inline bool isAsciiDigit(QChar ch)
+{
+    return ch >= QLatin1Char('0') && ch <= QLatin1Char('9');
+}
+
+}
+
+int SyntaxDefinition::tokenize(QStringView text, int state, bool lineStart, bool continues, QVector<Token>* tokens) const
+{
+    const int n = int(text.size());
+    int pos = 0;
+
+    // 上一行留下的区间先找结尾
+    if (state > 0 && state <= m_rules.size()) {
+        const Rule& rule = m_rules[state - 1];
+        const int end = findSpanEnd(rule, text, 0);
+        if (end < 0) {
+            if (tokens && n > 0) tokens->append({ 0, n, rule.type });
+            return (rule.multiLine || continues) ? state : 0;
+        }
+        if (tokens && end > 0) tokens->append({ 0, end, rule.type });
+        pos = end;
+        lineStart = false;
+    }
+
+    bool atLineStart = lineStart;
+    while (pos < n) {
+        const QChar ch = text[pos];
+        if (ch.isSpace()) {
+            ++pos;
+            continue;
+        }
+
+        const QVector<int>& candidates = ch.unicode() < 128 ? m_dispatch[ch.unicode()] : m_otherRules;
+        int length = 0;
+        for (int index : candidates) {
+            bool unterminated = false;
+            TokenType type = m_rules[index].type;
+            length = match(m_rules[index], text, pos, atLineStart, &unterminated, &type);
+            if (length <= 0) continue;
+
+            if (tokens) tokens->append({ pos, length, type });
+            pos += length;
+            if (unterminated) {
+                // 区间到行尾仍未结束：跨行区间和续行段都把状态带到下一段
+                return (m_rules[index].multiLine || continues) ? index + 1 : 0;
+            }
+            break;
+        }
+        atLineStart = false;
+        if (length > 0) continue;
+
+        // 没有规则匹配时整词跳过，避免从词中间匹配出数字或关键字
+        if (isWordChar(ch)) {
+            while (pos < n && isWordChar(text[pos])) ++pos;
+        }
+        else {
+            ++pos;
+        }
+    }
+    return 0;
+}
+
+int SyntaxDefinition::match(const Rule& rule, QStringView text, int pos, bool atLineStart,
+    bool* unterminated, TokenType* type) const
+{
+    if (rule.lineStartOnly && !atLineStart) return 0;
+
+    const int n = int(text.size());
+    switch (rule.kind) {
+    case RuleKind::Span: {
+        if (!text.mid(pos).startsWith(rule.begin)) return 0;
+
+        const int end = findSpanEnd(rule, text, pos + int(rule.begin.size()));
+        if (end < 0) {
+            // 到行尾仍未结束，是否延续到下一段由调用方决定
+            *unterminated = true;
+            return n - pos;
+        }
+
+        if (!rule.keySuffix.isNull()) {
+            int next = end;
+            while (next < n && text[next].isSpace()) ++next;
+            if (next < n && text[next] == rule.keySuffix) *type = rule.keyType;
+        }
+        return end - pos;
+    }
+    case RuleKind::Words: {
+        int end = pos;
+        while (end < n && isWordChar(text[end])) ++end;
+        if (end == pos) return 0;
+
+        const QStringView word = text.mid(pos, end - pos);
+        const bool found = rule.caseInsensitive
+            ? rule.words.contains(word.toString().toLower())
+            : rule.words.contains(word.toString());
+        return found ? end - pos : 0;
+    }
+    case RuleKind::Number: {
+        // begin 中的字符（如负号）可以出现在数字之前
+        int end = pos;
+        if (rule.begin.contains(text[end])) ++end;
+        if (end >= n || !isAsciiDigit(text[end])) return 0;
+
+        while (end < n && (isAsciiDigit(text[end]) || rule.delimiters.contains(text[end]))) ++end;
+
+        // 后面紧跟字母时是标识符的一部分
+        if (end < n && isWordChar(text[end])) return 0;
+        return end - pos;
+    }
+    case RuleKind::Until: {
+        int end = pos;
+        while (end < n && !rule.delimiters.contains(text[end])) ++end;
+        if (end >= n) return 0;
+
+        while (end > pos && text[end - 1].isSpace()) --end;
+        return end - pos;
+    }
+    }
+    return 0;
+}
+
+int SyntaxDefinition::findSpanEnd(const Rule& rule, QStringView text, int pos) const
+{
+    if (rule.end.isEmpty()) return -1;
+
+    const int n = int(text.size());
+    const QChar first = rule.end[0];
+    for (int i = pos; i < n; ++i) {
+        if (!rule.escape.isNull() && text[i] == rule.escape) {
+            ++i;
+            continue;
+        }
+        if (text[i] == first && text.mid(i).startsWith(rule.end)) {
+            return i + int(rule.end.size());
+        }
+    }
+    return -1;
+}
+
+void SyntaxDefinition::addRule(const Rule& rule)
+{
+    m_rules.append(rule);
+    if (rule.kind == RuleKind::Words && rule.caseInsensitive) {
+        QSet<QString> folded;
+        for (const QString& word : rule.words) folded.insert(word.toLower());
+        m_rules.last().words = folded;
+    }
+    if (rule.multiLine) m_multiLine = true;
+}
+
+void SyntaxDefinition::compile()
+{
+    for (QVector<int>& candidates : m_dispatch) candidates.clear();
+    m_otherRules.clear();
+
+    // 规则按定义顺序排列优先级
+    for (int index = 0; index < m_rules.size(); ++index) {
+        const Rule& rule = m_rules[index];
+
+        auto addFirst = [&](QChar ch) {
+            QVector<int>& candidates = ch.unicode() < 128 ? m_dispatch[ch.unicode()] : m_otherRules;
+            if (candidates.isEmpty() || candidates.last() != index) candidates.append(index);
+        };
+
+        switch (rule.kind) {
+        case RuleKind::Span:
+            addFirst(rule.begin[0]);
+            break;
+        case RuleKind::Words:
+            for (const QString& word : rule.words) {
+                addFirst(word[0]);
+                if (rule.caseInsensitive) addFirst(word[0].toUpper());
+            }
+            break;
+        case RuleKind::Number:
+            for (char digit = '0'; digit <= '9'; ++digit) addFirst(QLatin1Char(digit));
+            for (QChar prefix : rule.begin) addFirst(prefix);
+            break;
+        case RuleKind::Until:
+            for (ushort ch = 33; ch < 128; ++ch) {
+                if (!rule.delimiters.contains(QChar(ch))) addFirst(QChar(ch));
+            }
+            m_otherRules.append(index);
+            break;
+        }
+    }
+}
+
+SyntaxDefinition SyntaxDefinition::json()
+{
+    SyntaxDefinition definition;
+    definition.m_name = QStringLiteral("JSON");
+
+    Rule string;
+    string.type = TokenType::String;
+    string.begin = string.end = QStringLiteral("\"");
+    string.escape = QLatin1Char('\\');
+    string.keySuffix = QLatin1Char(':');
+    definition.addRule(string);
+
+    // 允许 JSONC 的注释
+    Rule lineComment;
+    lineComment.type = TokenType::Comment;
+    lineComment.begin = QStringLiteral("//");
+    definition.addRule(lineComment);
+
+    Rule blockComment;
+    blockComment.type = TokenType::Comment;
+    blockComment.begin = QStringLiteral("/*");
+    blockComment.end = QStringLiteral("*/");
+    blockComment.multiLine = true;
+    definition.addRule(blockComment);
+
+    Rule keywords;
+    keywords.kind = RuleKind::Words;
+    keywords.words = { QStringLiteral("true"), QStringLiteral("false"), QStringLiteral("null") };
+    definition.addRule(keywords);
+
+    Rule number;
+    number.kind = RuleKind::Number;
+    number.type = TokenType::Number;
+    number.begin = QStringLiteral("-");
+    number.delimiters = QStringLiteral(".eE+-");
+    definition.addRule(number);
+
+    definition.compile();
+    return definition;
+}
+
+SyntaxDefinition SyntaxDefinition::ini()
+{
+    SyntaxDefinition definition;
+    definition.m_name = QStringLiteral("INI");
+
+    for (const char* prefix : { ";", "#" }) {
+        Rule comment;
+        comment.type = TokenType::Comment;
+        comment.begin = QLatin1String(prefix);
+        comment.lineStartOnly = true;
+        definition.addRule(comment);
+    }
+
+    Rule section;
+    section.type = TokenType::Section;
+    section.begin = QStringLiteral("[");
+    section.end = QStringLiteral("]");
+    section.lineStartOnly = true;
+    definition.addRule(section);
+
+    Rule key;
+    key.kind = RuleKind::Until;
+    key.type = TokenType::Key;
+    key.delimiters = QStringLiteral("=:");
+    key.lineStartOnly = true;
+    definition.addRule(key);
+
+    Rule string;
+    string.type = TokenType::String;
+    string.begin = string.end = QStringLiteral("\"");
+    string.escape = QLatin1Char('\\');
+    definition.addRule(string);
+
+    Rule keywords;
+    keywords.kind = RuleKind::Words;
+    keywords.caseInsensitive = true;
+    keywords.words = { QStringLiteral("true"), QStringLiteral("false"), QStringLiteral("yes"),
+        QStringLiteral("no"), QStringLiteral("on"), QStringLiteral("off") };
+    definition.addRule(keywords);
+
+    Rule number;
+    number.kind = RuleKind::Number;
+    number.type = TokenType::Number;
+    number.begin = QStringLiteral("-");
+    number.delimiters = QStringLiteral(".");
+    definition.addRule(number);
+
+    definition.compile();
+    return definition;
+}
+
+SyntaxDefinition SyntaxDefinition::log()
+{
+    SyntaxDefinition definition;
+    definition.m_name = QStringLiteral("Log");
+
+    const struct {
+        TokenType type;
+        QSet<QString> words;
+    } levels[] = {
+        { TokenType::Error, { QStringLiteral("error"), QStringLiteral("fatal"), QStringLiteral("critical"),
+            QStringLiteral("severe"), QStringLiteral("exception") } },
+        { TokenType::Warning, { QStringLiteral("warn"), QStringLiteral("warning") } },
+        { TokenType::Info, { QStringLiteral("info"), QStringLiteral("notice") } },
+        { TokenType::Debug, { QStringLiteral("debug"), QStringLiteral("trace"), QStringLiteral("verbose") } },
+    };
+    for (const auto& level : levels) {
+        Rule rule;
+        rule.kind = RuleKind::Words;
+        rule.type = level.type;
+        rule.caseInsensitive = true;
+        rule.words = level.words;
+        definition.addRule(rule);
+    }
+
+    Rule string;
+    string.type = TokenType::String;
+    string.begin = string.end = QStringLiteral("\"");
+    string.escape = QLatin1Char('\\');
+    definition.addRule(string);
+
+    // 时间戳、IP 地址和普通数字
+    Rule number;
+    number.kind = RuleKind::Number;
+    number.type = TokenType::Number;
+    number.delimiters = QStringLiteral("-:.,/T");
+    definition.addRule(number);
+
+    definition.compile();
+    return definition;
+}
+
+const SyntaxDefinition* SyntaxDefinition::forFileName(const QString& fileName)
+{
+    static const SyntaxDefinition JSON = json();
+    static const SyntaxDefinition INI = ini();
+    static const SyntaxDefinition LOG = log();
+
+    // 压缩文件按去掉压缩扩展名后的名称判断
+    QString name = QFileInfo(fileName).fileName().toLower();
+    for (const char* compressed : { ".gz", ".zst" }) {
+        if (name.endsWith(QLatin1String(compressed))) name.chop(int(qstrlen(compressed)));
+    }
+
+    const QString suffix = name.section(QLatin1Char('.'), -1);
+    if (suffix == QLatin1String("json") || suffix == QLatin1String("jsonc")) return &JSON;
+    if (suffix == QLatin1String("ini") || suffix == QLatin1String("cfg") || suffix == QLatin1String("conf")
+        || suffix == QLatin1String("inf") || suffix == QLatin1String("properties")) return &INI;
+    if (suffix == QLatin1String("log")) return &LOG;
+    return nullptr;
+}
@@ -0,0 +1,94 @@
+﻿#pragma once
+
+#include <QString>
+#include <QStringView>
+#include <QVector>
+#include <QSet>
+
+#include <array>
+
+// 语法规则表：规则在构造时按首字符编译成分派表，分词时每个位置只尝试
+// 以该字符开头的规则，不使用正则表达式
+class SyntaxDefinition
+{
+public:
+    enum class TokenType {
+        Keyword,
+        String,
+        Key,            // JSON 的键、INI 的键名
+        Number,
+        Comment,
+        Section,        // INI 的节名
+        Error,
+        Warning,
+        Info,
+        Debug,
+        Count,
+    };
+
+    struct Token {
+        int start;
+        int length;
+        TokenType type;
+    };
+
+    SyntaxDefinition() = default;
+    ~SyntaxDefinition() = default;
+
+    QString name() const { return m_name; }
+
+    // 是否有跨行的区间（如块注释），没有时每行的初始状态都为 0
+    bool hasMultiLineSpans() const { return m_multiLine; }
+
+    // 对一行分词，state 为上一行结束时的状态（0 表示不在区间内）。
+    // lineStart 为 false 表示本段是超长行拆分出的续行段；continues 表示下一段仍属于同一行。
+    // 返回本行结束时的状态
+    int tokenize(QStringView text, int state, bool lineStart, bool continues, QVector<Token>* tokens) const;
+
+    // 按扩展名选择语法，没有对应语法时返回 nullptr；规则只编译一次
+    static const SyntaxDefinition* forFileName(const QString& fileName);
+
+private:
+    enum class RuleKind {
+        Span,           // begin ... end 的区间，end 为空时到行尾
+        Words,          // 关键字集合
+        Number,
+        Until,          // 行首到分隔符之前（INI 的键名）
+    };
+
+    struct Rule {
+        RuleKind kind = RuleKind::Span;
+        TokenType type = TokenType::Keyword;
+        QString begin;
+        QString end;
+        QChar escape;
+        bool multiLine = false;
+        bool lineStartOnly = false;         // 只匹配行首（允许前导空白）
+        bool caseInsensitive = false;
+        QString delimiters;                 // Until 的分隔符；Number 允许的附加字符
+        QChar keySuffix;                    // 区间之后紧跟此字符时改用 keyType
+        TokenType keyType = TokenType::Key;
+        QSet<QString> words;
+    };
+
+    void addRule(const Rule& rule);
+
+    void compile();
+
+    // 返回匹配长度，0 表示不匹配；unterminated 返回区间是否延续到行尾之后
+    int match(const Rule& rule, QStringView text, int pos, bool atLineStart, bool* unterminated, TokenType* type) const;
+
+    // 从 pos 开始查找区间结尾，返回结尾之后的位置，找不到时返回 -1
+    int findSpanEnd(const Rule& rule, QStringView text, int pos) const;
+
+    static SyntaxDefinition json();
+    static SyntaxDefinition ini();
+    static SyntaxDefinition log();
+
+private:
+    QString m_name;
+    QVector<Rule> m_rules;
+    std::array<QVector<int>, 128> m_dispatch;   // ASCII 首字符 -> 候选规则
+    QVector<int> m_otherRules;                   // 首字符不限的规则（如非 ASCII 关键字）
+    bool m_multiLine = false;
+};
@@ -0,0 +1,228 @@
+﻿#include "SyntaxHighlighter.h"
+#include "EditorHost.h"
+#include "BlockIndex.h"
+#include "Trace.h"
+
+#include <QTextDocument>
+#include <QTextLayout>
+#include <QScrollBar>
+#include <QTimer>
+#include <QElapsedTimer>
+
+SyntaxHighlighter::SyntaxHighlighter(EditorHost* editor, QObject* parent)
+    : QObject(parent)
+    , m_editor(editor)
+    , m_definition(nullptr)
+    , m_updateTimer(new QTimer(this))
+{
+    using TokenType = SyntaxDefinition::TokenType;
+    const auto setFormat = [this](TokenType type, const QColor& color, bool bold = false, bool italic = false) {
+        QTextCharFormat& format = m_formats[int(type)];
+        format.setForeground(color);
+        if (bold) format.setFontWeight(QFont::Bold);
+        if (italic) format.setFontItalic(true);
+    };
+    setFormat(TokenType::Keyword, QColor(0x00, 0x33, 0xB3), true);
+    setFormat(TokenType::String, QColor(0x06, 0x7D, 0x17));
+    setFormat(TokenType::Key, QColor(0x87, 0x10, 0x94));
+    setFormat(TokenType::Number, QColor(0x17, 0x50, 0xEB));
+    setFormat(TokenType::Comment, QColor(0x8C, 0x8C, 0x8C), false, true);
+    setFormat(TokenType::Section, QColor(0x00, 0x33, 0xB3), true);
+    setFormat(TokenType::Error, QColor(0xC6, 0x28, 0x28), true);
+    setFormat(TokenType::Warning, QColor(0xE6, 0x51, 0x00), true);
+    setFormat(TokenType::Info, QColor(0x2E, 0x7D, 0x32));
+    setFormat(TokenType::Debug, QColor(0x80, 0x80, 0x80));
+
+    m_updateTimer->setSingleShot(true);
+    m_updateTimer->setInterval(0);
+    connect(m_updateTimer, &QTimer::timeout, this, &SyntaxHighlighter::highlightViewport);
+
+    connect(m_editor, &EditorHost::documentReplaced, this, &SyntaxHighlighter::onDocumentReplaced);
+    connect(m_editor->blockIndex(), &BlockIndex::indexReset, this, &SyntaxHighlighter::invalidateAll);
+    onDocumentReplaced(m_editor->document());
+}
+
+void SyntaxHighlighter::setDefinition(const SyntaxDefinition* definition)
+{
+    if (definition == m_definition) return;
+
+    clearFormats();
+    m_definition = definition;
+    invalidateAll();
+}
+
+void SyntaxHighlighter::onDocumentReplaced(QTextDocument* document)
+{
+    if (m_document) disconnect(m_document, nullptr, this, nullptr);
+    if (m_scrollBar) disconnect(m_scrollBar, nullptr, this, nullptr);
+
+    m_document = document;
+    m_scrollBar = m_editor->verticalScrollBar();
+
+    // 滚动和窗口大小变化都会改变可见的块
+    connect(m_document, &QTextDocument::contentsChange, this, &SyntaxHighlighter::onContentsChange);
+    connect(m_scrollBar, &QScrollBar::valueChanged, this, &SyntaxHighlighter::scheduleUpdate);
+    connect(m_scrollBar, &QScrollBar::rangeChanged, this, &SyntaxHighlighter::scheduleUpdate);
+    invalidateAll();
+}
+
+void SyntaxHighlighter::onContentsChange(int position, int charsRemoved, int charsAdded)
+{
+    Q_UNUSED(charsRemoved);
+    if (!m_definition) return;
+
+    // 被修改的块格式和状态都失效，之后的块等状态变化时再逐个失效
+    QTextBlock block = m_document->findBlock(position);
+    const QTextBlock end = m_document->findBlock(position + charsAdded).next();
+    const int first = block.blockNumber();
+    for (; block.isValid() && block != end; block = block.next()) {
+        setBlockState(block, -1, false);
+    }
+    const int last = end.isValid() ? end.blockNumber() - 1 : m_document->blockCount() - 1;
+
+    // 输入时被修改的块就在视口内，立即着色，避免先显示一帧错位的旧格式
+    const QWidget* viewport = m_editor->viewport();
+    const int firstVisible = m_editor->cursorForPosition(QPoint(0, 0)).blockNumber();
+    const int lastVisible = m_editor->cursorForPosition(QPoint(viewport->width() - 1, viewport->height() - 1)).blockNumber();
+    if (first <= lastVisible + LOOKAHEAD_BLOCKS && last >= firstVisible) {
+        highlightRange(qMax(first, firstVisible), qMin(last, lastVisible + LOOKAHEAD_BLOCKS));
+    }
+    scheduleUpdate();
+}
+
+void SyntaxHighlighter::invalidateAll()
+{
+    // 模式切换时索引先于文档通知重建，此时仍是旧文档，等 documentReplaced 再处理
+    if (!m_document || m_document != m_editor->document()) return;
+
+    for (QTextBlock block = m_document->firstBlock(); block.isValid(); block = block.next()) {
+        const int state = block.userState();
+        if (state != -1 && (state & (STATE_MASK | FORMATTED_FLAG))) {
+            setBlockState(block, -1, false);
+        }
+    }
+    scheduleUpdate();
+}
+
+void SyntaxHighlighter::scheduleUpdate()
+{
+    if (m_definition) m_updateTimer->start();
+}
+
+void SyntaxHighlighter::highlightViewport()
+{
+    TRACE_SCOPE("SyntaxHighlighter::highlightViewport");
+
+    if (!m_definition || !m_document) return;
+
+    const QWidget* viewport = m_editor->viewport();
+    const int first = m_editor->cursorForPosition(QPoint(0, 0)).blockNumber();
+    const int last = m_editor->cursorForPosition(QPoint(viewport->width() - 1, viewport->height() - 1)).blockNumber();
+
+    // 时间预算用完时把剩余的工作留到下一轮事件循环，不阻塞输入
+    if (!highlightRange(first, last + LOOKAHEAD_BLOCKS)) {
+        m_updateTimer->start();
+    }
+}
+
+bool SyntaxHighlighter::highlightRange(int first, int last)
+{
+    if (!m_definition || !m_document) return true;
+
+    QTextBlock start = m_document->findBlockByNumber(first);
+    if (!start.isValid()) return true;
+
+    // 向前找到结束状态已知的块；没有跨行区间的语法每行都从状态 0 开始，只需回到行首段
+    const bool multiLine = m_definition->hasMultiLineSpans();
+    while (start.previous().isValid() && endState(start.previous()) < 0
+        && (multiLine || EditorHost::isContinuation(start))) {
+        start = start.previous();
+    }
+
+    int state = 0;
+    if (start.previous().isValid() && (multiLine || EditorHost::isContinuation(start))) {
+        state = qMax(endState(start.previous()), 0);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    for (QTextBlock block = start; block.isValid() && block.blockNumber() <= last; block = block.next()) {
+        const bool visible = block.blockNumber() >= first;
+        const int oldState = endState(block);
+
+        // 状态和格式都有效的块直接跳过，编辑后的重新着色到这里收敛
+        if (oldState >= 0 && (isFormatted(block) || !visible)) {
+            state = oldState;
+            continue;
+        }
+
+        const int newState = highlightBlock(block, state, visible);
+        if (newState != oldState) {
+            QTextBlock next = block.next();
+            if (next.isValid()) setBlockState(next, -1, false);
+        }
+        state = newState;
+
+        // 视口之前的块只补算状态，受时间预算限制
+        if (!visible && timer.elapsed() > TIME_BUDGET_MS) return false;
+    }
+    return true;
+}
+
+int SyntaxHighlighter::highlightBlock(QTextBlock& block, int state, bool applyFormats)
+{
+    const QTextBlock next = block.next();
+    const bool continues = next.isValid() && EditorHost::isContinuation(next);
+    const QString text = block.text();
+
+    m_tokens.clear();
+    const int result = m_definition->tokenize(text, state, !EditorHost::isContinuation(block), continues,
+        applyFormats ? &m_tokens : nullptr);
+
+    if (applyFormats) {
+        QList<QTextLayout::FormatRange> ranges;
+        ranges.reserve(m_tokens.size());
+        for (const SyntaxDefinition::Token& token : m_tokens) {
+            ranges.append({ token.start, token.length, m_formats[int(token.type)] });
+        }
+
+        // 格式只设在块的排版上，不进入文档内容和撤销栈
+        block.layout()->setFormats(ranges);
+        m_document->markContentsDirty(block.position(), block.length());
+    }
+
+    setBlockState(block, result, applyFormats);
+    return result;
+}
+
+void SyntaxHighlighter::clearFormats()
+{
+    if (!m_document) return;
+
+    for (QTextBlock block = m_document->firstBlock(); block.isValid(); block = block.next()) {
+        if (!isFormatted(block)) continue;
+        block.layout()->clearFormats();
+        m_document->markContentsDirty(block.position(), block.length());
+        setBlockState(block, -1, false);
+    }
+}
+
+int SyntaxHighlighter::endState(const QTextBlock& block)
+{
+    const int state = block.userState();
+    return state == -1 ? -1 : (state & STATE_MASK) - 1;
+}
+
+bool SyntaxHighlighter::isFormatted(const QTextBlock& block)
+{
+    const int state = block.userState();
+    return state != -1 && (state & FORMATTED_FLAG);
+}
+
+void SyntaxHighlighter::setBlockState(QTextBlock& block, int state, bool formatted)
+{
+    // 保留其他位（如续行段标记）
+    const int old = block.userState();
+    const int flags = old == -1 ? 0 : old & ~(STATE_MASK | FORMATTED_FLAG);
+    block.setUserState(flags | (state + 1) | (formatted ? FORMATTED_FLAG : 0));
+}
@@ -0,0 +1,71 @@
+﻿#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QTextBlock>
+#include <QTextCharFormat>
+
+#include <array>
+
+#include "SyntaxDefinition.h"
+
+class EditorHost;
+class QTextDocument;
+class QScrollBar;
+class QTimer;
+
+// 按视口延迟着色：只给可见块和其后少量块设置格式，块的结束状态缓存在 userState 中。
+// 编辑后从被修改的块开始重新着色，直到某块的结束状态与缓存一致为止；
+// 视口之外的块只标记为失效，滚动到时再处理
+class SyntaxHighlighter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SyntaxHighlighter(EditorHost* editor, QObject* parent = nullptr);
+    ~SyntaxHighlighter() override = default;
+
+    // nullptr 表示不着色
+    void setDefinition(const SyntaxDefinition* definition);
+
+    const SyntaxDefinition* definition() const { return m_definition; }
+
+private slots:
+    void onDocumentReplaced(QTextDocument* document);
+
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+
+    void invalidateAll();
+
+    void scheduleUpdate();
+
+    void highlightViewport();
+
+private:
+    // 处理块号 [first, last]，返回 false 表示用完时间预算尚未处理完
+    bool highlightRange(int first, int last);
+
+    int highlightBlock(QTextBlock& block, int state, bool applyFormats);
+
+    void clearFormats();
+
+    static int endState(const QTextBlock& block);
+
+    static bool isFormatted(const QTextBlock& block);
+
+    static void setBlockState(QTextBlock& block, int state, bool formatted);
+
+private:
+    EditorHost* m_editor;
+    QPointer<QTextDocument> m_document;
+    QPointer<QScrollBar> m_scrollBar;
+    const SyntaxDefinition* m_definition;
+    QTimer* m_updateTimer;                  // 合并滚动和编辑触发的视口着色
+    std::array<QTextCharFormat, int(SyntaxDefinition::TokenType::Count)> m_formats;
+    QVector<SyntaxDefinition::Token> m_tokens;  // 复用的分词缓冲
+
+    static constexpr int LOOKAHEAD_BLOCKS = 64;     // 视口之后预先着色的块数
+    static constexpr int TIME_BUDGET_MS = 8;        // 每次补算视口之前状态的时间上限
+    static constexpr int STATE_MASK = 0xFFFF;       // userState 中结束状态所占的位，0 表示未知
+    static constexpr int FORMATTED_FLAG = 1 << 16;  // 块已按当前状态设置格式
+};
@@ -0,0 +1,133 @@
+﻿#include "TailFollower.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QDateTime>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+TailFollower::TailFollower(QObject* parent)
+    : QObject(parent)
+    , m_watcher(new QFileSystemWatcher(this))
+    , m_pollTimer(new QTimer(this))
+    , m_encoding(EncodingDetector::Encoding::Utf8)
+    , m_offset(0)
+    , m_pendingCR(false)
+{
+    m_pollTimer->setInterval(POLL_INTERVAL_MS);
+
+    connect(m_watcher, &QFileSystemWatcher::fileChanged, this, &TailFollower::checkFile);
+    connect(m_pollTimer, &QTimer::timeout, this, &TailFollower::checkFile);
+}
+
+void TailFollower::start(const QString& fileName, qint64 offset, EncodingDetector::Encoding encoding)
+{
+    stop();
+
+    const QByteArray identity = fileIdentity(fileName);
+    const bool resume = fileName == m_stoppedFileName && offset == m_offset
+        && encoding == m_encoding && identity == m_identity;
+
+    m_fileName = fileName;
+    m_stoppedFileName.clear();
+    m_identity = identity;
+    if (!resume) {
+        m_offset = offset;
+        m_encoding = encoding;
+        m_decoder = EncodingDetector::createDecoder(encoding);
+        m_pendingCR = false;
+    }
+
+    m_watcher->addPath(fileName);
+    m_pollTimer->start();
+
+    // 开始跟踪前可能已经有新内容
+    checkFile();
+}
+
+void TailFollower::stop()
+{
+    if (!m_watcher->files().isEmpty()) {
+        m_watcher->removePaths(m_watcher->files());
+    }
+    m_pollTimer->stop();
+    if (!m_fileName.isEmpty()) m_stoppedFileName = m_fileName;
+    m_fileName.clear();
+}
+
+QByteArray TailFollower::fileIdentity(const QString& fileName)
+{
+#ifdef Q_OS_UNIX
+    struct stat st;
+    if (::stat(QFile::encodeName(fileName).constData(), &st) == 0) {
+        return QByteArray::number(quint64(st.st_dev)) + ':' + QByteArray::number(quint64(st.st_ino));
+    }
+    return QByteArray();
+#else
+    // Windows 上轮转通常是重命名后新建文件，用创建时间区分
+    const QFileInfo info(fileName);
+    if (!info.exists()) return QByteArray();
+    return QByteArray::number(info.birthTime().toMSecsSinceEpoch());
+#endif
+}
+
+void TailFollower::checkFile()
+{
+    if (m_fileName.isEmpty()) return;
+
+    // 轮转或删除后监视器会丢掉路径，文件重新出现时再加回来
+    if (!m_watcher->files().contains(m_fileName) && QFileInfo::exists(m_fileName)) {
+        m_watcher->addPath(m_fileName);
+    }
+
+    const QByteArray identity = fileIdentity(m_fileName);
+    if (identity.isEmpty()) {
+        return; // 文件暂时不存在，等待重新创建
+    }
+
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    const qint64 size = file.size();
+
+    // 文件被替换（轮转）或截断，之前的偏移量作废
+    if (identity != m_identity || size < m_offset) {
+        m_identity = identity;
+        m_decoder = EncodingDetector::createDecoder(m_encoding);
+        m_pendingCR = false;
+        emit fileReset();
+        return;
+    }
+
+    if (size == m_offset) return;
+
+    // 只读取新追加的字节区间，分批解码
+    if (!file.seek(m_offset)) return;
+
+    QString appended;
+    while (m_offset < size) {
+        const QByteArray chunk = file.read(qMin(MAX_READ, size - m_offset));
+        if (chunk.isEmpty()) break;
+        m_offset += chunk.size();
+        appended += m_decoder(chunk);
+    }
+
+    // 统一换行，末尾单独的 \r 留到下一次判断
+    if (m_pendingCR) {
+        appended.prepend(QLatin1Char('\r'));
+        m_pendingCR = false;
+    }
+    if (appended.endsWith(QLatin1Char('\r'))) {
+        appended.chop(1);
+        m_pendingCR = true;
+    }
+    appended.replace(QStringLiteral("\r\n"), QStringLiteral("\n"));
+
+    if (!appended.isEmpty()) {
+        emit textAppended(appended);
+    }
+}
@@ -0,0 +1,58 @@
+﻿#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QStringDecoder>
+
+#include "EncodingDetector.h"
+
+class QFileSystemWatcher;
+class QTimer;
+
+class TailFollower : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TailFollower(QObject* parent = nullptr);
+    ~TailFollower() override = default;
+
+    // 从 offset 字节处开始跟踪文件末尾。在同一文件上次停下的位置重新开始时
+    // 沿用解码状态，停下时未凑齐的多字节字符和末尾的 \r 不会丢失
+    void start(const QString& fileName, qint64 offset, EncodingDetector::Encoding encoding);
+
+    void stop();
+
+    bool isFollowing() const { return !m_fileName.isEmpty(); }
+
+    // 已读取的字节数，停止后保留到下次 start
+    qint64 offset() const { return m_offset; }
+
+signals:
+    // 新追加并解码后的文本（换行已统一为 \n）
+    void textAppended(const QString& text);
+
+    // 文件被截断或轮转，已追加的内容不再可信，需要重新加载
+    void fileReset();
+
+private slots:
+    void checkFile();
+
+private:
+    static QByteArray fileIdentity(const QString& fileName);
+
+private:
+    QFileSystemWatcher* m_watcher;
+    QTimer* m_pollTimer;      // 监视器丢失路径（轮转、删除）时的兜底轮询
+    QString m_fileName;
+    QString m_stoppedFileName;  // 上次停止跟踪的文件，用于判断能否接着读
+    EncodingDetector::Encoding m_encoding;
+    QByteArray m_identity;    // 文件身份（inode 或创建时间）
+    qint64 m_offset;          // 已读取的字节数
+    QStringDecoder m_decoder; // 跨次读取保持状态，衔接被截断的多字节字符
+    bool m_pendingCR;         // 上次读取以 \r 结尾，等待判断是否为 \r\n
+
+    static constexpr int POLL_INTERVAL_MS = 1000;
+    static constexpr qint64 MAX_READ = 4 << 20;  // 单次最多读取的字节数
+};
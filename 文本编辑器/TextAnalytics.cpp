@@ -0,0 +1,276 @@
+﻿#include "TextAnalytics.h"
+#include "StringProcessor.h"
+
+#include <QThread>
+#include <QElapsedTimer>
+#include <QCoreApplication>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <memory>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+
+namespace {
+
+constexpr size_t ARENA_BLOCK = 1 << 20;  // 内存池初始块大小
+
+inline bool isCjk(QChar ch)
+{
+    const ushort uc = ch.unicode();
+    return (uc >= 0x4E00 && uc <= 0x9FFF) || (uc >= 0x3400 && uc <= 0x4DBF);
+}
+
+inline bool isWordChar(QChar ch)
+{
+    return ch.isLetterOrNumber() || ch == QLatin1Char('_');
+}
+
+// 词表的键直接引用原文，不复制字符串，比较时忽略大小写
+struct FoldedHash {
+    size_t operator()(QStringView text) const noexcept
+    {
+        return size_t(StringProcessor::foldedHash(text));
+    }
+};
+
+struct FoldedEqual {
+    bool operator()(QStringView a, QStringView b) const noexcept
+    {
+        return a.size() == b.size() && a.compare(b, Qt::CaseInsensitive) == 0;
+    }
+};
+
+struct WordPair {
+    QStringView first;
+    QStringView second;
+};
+
+struct PairHash {
+    size_t operator()(const WordPair& pair) const noexcept
+    {
+        return size_t(StringProcessor::foldedHash(pair.second, StringProcessor::foldedHash(pair.first) ^ 0x20));
+    }
+};
+
+struct PairEqual {
+    bool operator()(const WordPair& a, const WordPair& b) const noexcept
+    {
+        return FoldedEqual()(a.first, b.first) && FoldedEqual()(a.second, b.second);
+    }
+};
+
+using WordTable = std::pmr::unordered_map<QStringView, qint64, FoldedHash, FoldedEqual>;
+using PairTable = std::pmr::unordered_map<WordPair, qint64, PairHash, PairEqual>;
+
+// 一个分片的局部结果，哈希表节点都从分片自己的内存池分配，线程之间互不竞争
+struct Shard {
+    Shard(QStringView text, bool last)
+        : text(text)
+        , last(last)
+        , arena(ARENA_BLOCK)
+        , words(&arena)
+        , bigrams(&arena)
+        , cjkBigrams(&arena)
+    {
+    }
+
+    QStringView text;
+    bool last;
+    std::pmr::monotonic_buffer_resource arena;
+    WordTable words;
+    PairTable bigrams;
+    WordTable cjkBigrams;
+    qint64 wordCount = 0;
+    qint64 lines = 0;
+    qint64 blankLines = 0;
+};
+
+void analyzeShard(Shard& shard)
+{
+    const QStringView text = shard.text;
+    const qsizetype n = text.size();
+
+    QStringView previousWord;   // 同一行内上一个词，用于词组
+    bool lineHasContent = false;
+
+    qsizetype i = 0;
+    while (i < n) {
+        const QChar ch = text[i];
+
+        if (ch == QLatin1Char('\n')) {
+            ++shard.lines;
+            if (!lineHasContent) ++shard.blankLines;
+            lineHasContent = false;
+            previousWord = QStringView();
+            ++i;
+            continue;
+        }
+
+        if (isCjk(ch)) {
+            // 中文按字计数，相邻两字组成二字词
+            ++shard.wordCount;
+            if (i + 1 < n && isCjk(text[i + 1])) {
+                ++shard.cjkBigrams[text.mid(i, 2)];
+            }
+            lineHasContent = true;
+            previousWord = QStringView();
+            ++i;
+            continue;
+        }
+
+        if (isWordChar(ch)) {
+            const qsizetype start = i;
+            while (i < n && isWordChar(text[i]) && !isCjk(text[i])) ++i;
+
+            const QStringView word = text.mid(start, i - start);
+            ++shard.wordCount;
+            ++shard.words[word];
+            if (!previousWord.isEmpty()) {
+                ++shard.bigrams[WordPair{ previousWord, word }];
+            }
+            previousWord = word;
+            lineHasContent = true;
+            continue;
+        }
+
+        // 空白不打断词组，标点会；只有空白的行仍算空行
+        if (!ch.isSpace()) {
+            previousWord = QStringView();
+            lineHasContent = true;
+        }
+        ++i;
+    }
+
+    // 最后一行没有换行符结尾（文本以换行结尾时是一个空行）
+    if (shard.last) {
+        ++shard.lines;
+        if (!lineHasContent) ++shard.blankLines;
+    }
+}
+
+template<typename Table>
+void mergeInto(Table& target, const Table& source)
+{
+    for (const auto& item : source) {
+        target[item.first] += item.second;
+    }
+}
+
+template<typename Table, typename ToText>
+QVector<TextAnalytics::Entry> topEntries(const Table& table, int topN, ToText toText)
+{
+    std::vector<std::pair<typename Table::key_type, qint64>> items(table.begin(), table.end());
+    const size_t count = std::min<size_t>(size_t(qMax(topN, 0)), items.size());
+
+    std::partial_sort(items.begin(), items.begin() + count, items.end(),
+        [](const auto& a, const auto& b) { return a.second > b.second; });
+
+    QVector<TextAnalytics::Entry> entries;
+    entries.reserve(int(count));
+    for (size_t i = 0; i < count; ++i) {
+        entries.append({ toText(items[i].first), items[i].second });
+    }
+    return entries;
+}
+
+QString csvField(const QString& field)
+{
+    if (!field.contains(QLatin1Char(',')) && !field.contains(QLatin1Char('"'))
+        && !field.contains(QLatin1Char('\n'))) {
+        return field;
+    }
+    QString quoted = field;
+    quoted.replace(QLatin1String("\""), QLatin1String("\"\""));
+    return QLatin1Char('"') + quoted + QLatin1Char('"');
+}
+
+}
+
+TextAnalytics::Result TextAnalytics::analyze(const QString& text, int topN, int shardCount)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    Result result;
+    if (text.isEmpty()) return result;
+
+    // 按行边界切分，词和词组都不会跨分片
+    if (shardCount <= 0) shardCount = QThread::idealThreadCount();
+    const qsizetype shardChars = qMax(MIN_SHARD_CHARS, text.size() / qMax(shardCount, 1) + 1);
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    const QStringView view(text);
+    qsizetype start = 0;
+    while (start < view.size()) {
+        qsizetype end = view.size();
+        if (start + shardChars < view.size()) {
+            const qsizetype newline = view.indexOf(QLatin1Char('\n'), start + shardChars);
+            if (newline >= 0) end = newline + 1;
+        }
+        shards.push_back(std::make_unique<Shard>(view.mid(start, end - start), end == view.size()));
+        start = end;
+    }
+
+    QtConcurrent::blockingMap(shards, [](std::unique_ptr<Shard>& shard) {
+        analyzeShard(*shard);
+    });
+
+    // 合并到第一个分片
+    Shard& merged = *shards.front();
+    for (size_t i = 1; i < shards.size(); ++i) {
+        const Shard& shard = *shards[i];
+        mergeInto(merged.words, shard.words);
+        mergeInto(merged.bigrams, shard.bigrams);
+        mergeInto(merged.cjkBigrams, shard.cjkBigrams);
+        merged.wordCount += shard.wordCount;
+        merged.lines += shard.lines;
+        merged.blankLines += shard.blankLines;
+    }
+
+    result.words = merged.wordCount;
+    result.lines = merged.lines;
+    result.blankLines = merged.blankLines;
+    result.uniqueWords = qint64(merged.words.size());
+
+    const auto wordText = [](QStringView word) { return word.toString().toLower(); };
+    result.topWords = topEntries(merged.words, topN, wordText);
+    result.topBigrams = topEntries(merged.bigrams, topN, [&](const WordPair& pair) {
+        return wordText(pair.first) + QLatin1Char(' ') + wordText(pair.second);
+    });
+    result.topCjkBigrams = topEntries(merged.cjkBigrams, topN, [](QStringView pair) {
+        return pair.toString();
+    });
+
+    result.elapsedMs = timer.elapsed();
+    return result;
+}
+
+QString TextAnalytics::toCsv(const Result& result)
+{
+    QString csv;
+    const auto row = [&csv](const QString& category, const QString& text, qint64 count) {
+        csv += csvField(category) + QLatin1Char(',') + csvField(text) + QLatin1Char(',')
+            + QString::number(count) + QLatin1Char('\n');
+    };
+
+    csv += QCoreApplication::translate("TextAnalytics", "类别,内容,次数") + QLatin1Char('\n');
+
+    const QString summary = QCoreApplication::translate("TextAnalytics", "汇总");
+    row(summary, QCoreApplication::translate("TextAnalytics", "字数"), result.words);
+    row(summary, QCoreApplication::translate("TextAnalytics", "行数"), result.lines);
+    row(summary, QCoreApplication::translate("TextAnalytics", "空行数"), result.blankLines);
+    row(summary, QCoreApplication::translate("TextAnalytics", "不同词数"), result.uniqueWords);
+
+    const QString words = QCoreApplication::translate("TextAnalytics", "词");
+    for (const Entry& entry : result.topWords) row(words, entry.text, entry.count);
+
+    const QString bigrams = QCoreApplication::translate("TextAnalytics", "词组");
+    for (const Entry& entry : result.topBigrams) row(bigrams, entry.text, entry.count);
+
+    const QString cjkBigrams = QCoreApplication::translate("TextAnalytics", "中文二字词");
+    for (const Entry& entry : result.topCjkBigrams) row(cjkBigrams, entry.text, entry.count);
+
+    return csv;
+}
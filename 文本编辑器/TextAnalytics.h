@@ -0,0 +1,38 @@
+﻿#pragma once
+
+#include <QString>
+#include <QVector>
+
+// 词、行和 n 元组频率统计：按行切分成多个分片并行处理，
+// 每个分片在自己的内存池里建哈希表，最后合并取前 N 项
+class TextAnalytics
+{
+public:
+    struct Entry {
+        QString text;
+        qint64 count = 0;
+    };
+
+    struct Result {
+        qint64 words = 0;           // 英文词数加中文字数
+        qint64 lines = 0;
+        qint64 blankLines = 0;
+        qint64 uniqueWords = 0;
+        QVector<Entry> topWords;
+        QVector<Entry> topBigrams;      // 同一行内相邻两个词
+        QVector<Entry> topCjkBigrams;   // 相邻两个中文字
+        qint64 elapsedMs = 0;
+    };
+
+    TextAnalytics() = default;
+    ~TextAnalytics() = default;
+
+    // shardCount 为 0 时按线程数分片（可在工作线程调用）
+    static Result analyze(const QString& text, int topN = 50, int shardCount = 0);
+
+    // 导出为 CSV 文本
+    static QString toCsv(const Result& result);
+
+private:
+    static constexpr qsizetype MIN_SHARD_CHARS = 256 * 1024;  // 分片太小时并行得不偿失
+};
@@ -0,0 +1,69 @@
+﻿#include "TextReplacer.h"
+#include "KMPMatcher.h"
+#include "MatchList.h"
+
+namespace {
+
+template <typename Matches>
+QVector<int> greedyNonOverlapping(const Matches& matches, int patternLength)
+{
+    QVector<int> result;
+    result.reserve(matches.size());
+
+    int nextFree = 0;
+    for (int pos : matches) {
+        if (pos < nextFree) continue;
+        result.append(pos);
+        nextFree = pos + patternLength;
+    }
+    return result;
+}
+
+}
+
+QVector<int> TextReplacer::nonOverlapping(const QVector<int>& matches, int patternLength)
+{
+    return greedyNonOverlapping(matches, patternLength);
+}
+
+QVector<int> TextReplacer::nonOverlapping(const MatchList& matches, int patternLength)
+{
+    return greedyNonOverlapping(matches, patternLength);
+}
+
+qsizetype TextReplacer::countNonOverlapping(QStringView text, QStringView pattern)
+{
+    qsizetype count = 0;
+    qsizetype nextFree = 0;
+    KMPMatcher::forEachMatch(text, pattern, [&](int pos) {
+        if (pos < nextFree) return true;
+        ++count;
+        nextFree = pos + pattern.size();
+        return true;
+        });
+    return count;
+}
+
+QString TextReplacer::replaceAll(const QString& text, const QString& pattern,
+    const QString& replacement, int* count)
+{
+    // 边查找边拼接，不保存匹配列表；替换串更长时结果按需增长
+    QString result;
+    int replaced = 0;
+    qsizetype last = 0;
+    KMPMatcher::forEachMatch(text, pattern, [&](int pos) {
+        if (pos < last) return true;
+        if (replaced == 0) result.reserve(text.size());
+        result += QStringView(text).mid(last, pos - last);
+        result += replacement;
+        last = pos + pattern.size();
+        ++replaced;
+        return true;
+        });
+
+    if (count) *count = replaced;
+    if (replaced == 0) return text;
+
+    result += QStringView(text).mid(last);
+    return result;
+}
@@ -0,0 +1,25 @@
+﻿#pragma once
+
+#include <QString>
+#include <QVector>
+
+class MatchList;
+
+// 批量替换：一次遍历构建结果，避免逐个替换后重新查找造成的平方复杂度
+class TextReplacer
+{
+public:
+    TextReplacer() = default;
+    ~TextReplacer() = default;
+
+    // KMP 返回的匹配可能重叠，从左到右贪心保留互不重叠的匹配
+    static QVector<int> nonOverlapping(const QVector<int>& matches, int patternLength);
+    static QVector<int> nonOverlapping(const MatchList& matches, int patternLength);
+
+    // 不重叠的匹配个数，与 replaceAll 的替换次数一致（"aaaa" 中 "aa" 计 2 个）
+    static qsizetype countNonOverlapping(QStringView text, QStringView pattern);
+
+    // 替换全部不重叠的匹配，count 返回替换次数
+    static QString replaceAll(const QString& text, const QString& pattern,
+        const QString& replacement, int* count = nullptr);
+};
@@ -0,0 +1,215 @@
+﻿#include "Trace.h"
+
+#include <QCoreApplication>
+#include <QThread>
+#include <QMutex>
+#include <QHash>
+#include <QSet>
+#include <QEvent>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <chrono>
+
+namespace {
+
+// 写入方先把 sequence 置 0，写完字段后再置为序号 + 1；
+// 读取方前后两次读到相同的序号才认为字段是完整的
+struct Slot {
+    std::atomic<quint64> sequence;
+    std::atomic<const char*> name;
+    std::atomic<qint64> start;
+    std::atomic<qint64> duration;
+    std::atomic<quint32> thread;
+    std::atomic<quint32> depth;
+};
+
+static_assert((Trace::CAPACITY & (Trace::CAPACITY - 1)) == 0, "CAPACITY 必须是 2 的幂");
+
+// 静态存储清零，未写入的页不占物理内存
+Slot g_slots[Trace::CAPACITY];
+std::atomic<quint64> g_head{ 0 };           // 下一个事件的序号
+std::atomic<quint64> g_clearedBefore{ 0 };  // 小于此序号的事件已被清除
+std::atomic<quint32> g_nextThread{ 0 };
+
+thread_local quint32 t_thread = 0;
+thread_local quint32 t_depth = 0;
+
+QMutex g_threadMutex;
+QHash<quint32, QString> g_threadNames;
+
+using Clock = std::chrono::steady_clock;
+
+const Clock::time_point& epoch()
+{
+    static const Clock::time_point start = Clock::now();
+    return start;
+}
+
+}
+
+void Trace::setEnabled(bool enabled)
+{
+    epoch();
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Trace::clear()
+{
+    g_clearedBefore.store(g_head.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+qint64 Trace::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch()).count();
+}
+
+void Trace::record(const char* name, qint64 startNs, qint64 durationNs, quint32 depth)
+{
+    const quint64 index = g_head.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = g_slots[index & (CAPACITY - 1)];
+
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start.store(startNs, std::memory_order_relaxed);
+    slot.duration.store(durationNs, std::memory_order_relaxed);
+    slot.thread.store(currentThread(), std::memory_order_relaxed);
+    slot.depth.store(depth, std::memory_order_relaxed);
+    slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+QVector<Trace::Event> Trace::events(int limit)
+{
+    const quint64 window = quint64(qBound(0, limit, int(CAPACITY)));
+    const quint64 head = g_head.load(std::memory_order_acquire);
+    const quint64 first = qMax(head > window ? head - window : 0,
+        g_clearedBefore.load(std::memory_order_acquire));
+
+    QVector<Event> result;
+    result.reserve(int(head - first));
+    for (quint64 index = first; index < head; ++index) {
+        const Slot& slot = g_slots[index & (CAPACITY - 1)];
+        const quint64 sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != index + 1) continue;   // 还在写入或已被覆盖
+
+        Event event;
+        event.name = slot.name.load(std::memory_order_relaxed);
+        event.startNs = slot.start.load(std::memory_order_relaxed);
+        event.durationNs = slot.duration.load(std::memory_order_relaxed);
+        event.thread = slot.thread.load(std::memory_order_relaxed);
+        event.depth = slot.depth.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence) continue;
+        result.append(event);
+    }
+    return result;
+}
+
+quint32 Trace::currentThread()
+{
+    if (t_thread == 0) {
+        t_thread = g_nextThread.fetch_add(1, std::memory_order_relaxed) + 1;
+
+        const QCoreApplication* app = QCoreApplication::instance();
+        QString name = QThread::currentThread()->objectName();
+        if (app && QThread::currentThread() == app->thread()) {
+            name = QStringLiteral("主线程");
+        }
+        else if (name.isEmpty()) {
+            name = QStringLiteral("线程 %1").arg(t_thread);
+        }
+
+        const QMutexLocker locker(&g_threadMutex);
+        g_threadNames.insert(t_thread, name);
+    }
+    return t_thread;
+}
+
+QString Trace::threadName(quint32 thread)
+{
+    const QMutexLocker locker(&g_threadMutex);
+    return g_threadNames.value(thread);
+}
+
+bool Trace::exportChromeTrace(const QString& fileName, QString* errorString)
+{
+    const QVector<Event> recorded = events();
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    // 时间单位为微秒，"X" 是带持续时间的完整事件
+    QJsonArray traceEvents;
+    QSet<quint32> threads;
+    for (const Event& event : recorded) {
+        QJsonObject object;
+        object.insert(QStringLiteral("name"), QString::fromUtf8(event.name));
+        object.insert(QStringLiteral("cat"), QStringLiteral("editor"));
+        object.insert(QStringLiteral("ph"), QStringLiteral("X"));
+        object.insert(QStringLiteral("ts"), double(event.startNs) / 1000.0);
+        object.insert(QStringLiteral("dur"), double(event.durationNs) / 1000.0);
+        object.insert(QStringLiteral("pid"), pid);
+        object.insert(QStringLiteral("tid"), qint64(event.thread));
+        traceEvents.append(object);
+        threads.insert(event.thread);
+    }
+
+    // 线程名称的元数据事件
+    for (quint32 thread : std::as_const(threads)) {
+        QJsonObject object;
+        object.insert(QStringLiteral("name"), QStringLiteral("thread_name"));
+        object.insert(QStringLiteral("ph"), QStringLiteral("M"));
+        object.insert(QStringLiteral("pid"), pid);
+        object.insert(QStringLiteral("tid"), qint64(thread));
+        object.insert(QStringLiteral("args"), QJsonObject{ { QStringLiteral("name"), threadName(thread) } });
+        traceEvents.append(object);
+    }
+
+    QJsonObject root;
+    root.insert(QStringLiteral("traceEvents"), traceEvents);
+    root.insert(QStringLiteral("displayTimeUnit"), QStringLiteral("ms"));
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+        || file.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) < 0) {
+        if (errorString) *errorString = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+Trace::PaintProbe::PaintProbe(QObject* parent)
+    : QObject(parent)
+    , m_inPaint(false)
+{
+}
+
+bool Trace::PaintProbe::eventFilter(QObject* watched, QEvent* event)
+{
+    if (event->type() != QEvent::Paint || m_inPaint || !isEnabled()) {
+        return QObject::eventFilter(watched, event);
+    }
+
+    // 过滤器只在事件送达之前被调用，这里自己把事件再派发一次，
+    // 才能量到绘制本身的耗时；仍在原绘制事件的上下文中，可以正常绘制
+    TRACE_SCOPE("editor.paint");
+    m_inPaint = true;
+    QCoreApplication::sendEvent(watched, event);
+    m_inPaint = false;
+    return true;
+}
+
+void TraceScope::begin()
+{
+    m_depth = t_depth++;
+    m_start = Trace::now();
+}
+
+void TraceScope::end()
+{
+    const qint64 duration = Trace::now() - m_start;
+    --t_depth;
+    Trace::record(m_name, m_start, duration, m_depth);
+}
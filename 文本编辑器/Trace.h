@@ -0,0 +1,103 @@
+﻿#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+
+// 热点路径的耗时跟踪：TRACE_SCOPE 记下所在作用域的起止时间，
+// 写入固定大小的环形缓冲区（无锁，多线程可同时写入，满了覆盖最旧的记录）。
+// 默认关闭，关闭时每个作用域只多一次原子读取
+class Trace
+{
+public:
+    struct Event {
+        const char* name;       // 字符串字面量，不复制
+        qint64 startNs;         // 相对跟踪起点的纳秒数
+        qint64 durationNs;
+        quint32 thread;         // 线程编号，从 1 开始
+        quint32 depth;          // 同一线程内的嵌套层数，顶层为 0
+    };
+
+    Trace() = default;
+    ~Trace() = default;
+
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    static void setEnabled(bool enabled);
+
+    // 丢弃已记录的事件
+    static void clear();
+
+    // 相对跟踪起点的纳秒数
+    static qint64 now();
+
+    static void record(const char* name, qint64 startNs, qint64 durationNs, quint32 depth);
+
+    // 缓冲区中最近 limit 个仍然完整的事件，按写入顺序（最旧的在前）
+    static QVector<Event> events(int limit = CAPACITY);
+
+    // 当前线程的编号，首次调用时分配
+    static quint32 currentThread();
+
+    static QString threadName(quint32 thread);
+
+    // 导出为 Chrome 跟踪格式（chrome://tracing、Perfetto 可打开）
+    static bool exportChromeTrace(const QString& fileName, QString* errorString = nullptr);
+
+    static constexpr int CAPACITY = 1 << 16;   // 环形缓冲区的事件数
+
+    // 包住编辑器视口的绘制事件，记为 editor.paint（含按需进行的布局）。
+    // 跟踪关闭时直接放行
+    class PaintProbe : public QObject
+    {
+    public:
+        explicit PaintProbe(QObject* parent = nullptr);
+        ~PaintProbe() override = default;
+
+    protected:
+        bool eventFilter(QObject* watched, QEvent* event) override;
+
+    private:
+        bool m_inPaint;     // 重新派发的那次绘制直接放行
+    };
+
+private:
+    static inline std::atomic<bool> s_enabled{ false };
+};
+
+// 作用域耗时，开始时跟踪未开启则什么也不记
+class TraceScope
+{
+public:
+    explicit TraceScope(const char* name)
+        : m_name(Trace::isEnabled() ? name : nullptr)
+        , m_start(0)
+        , m_depth(0)
+    {
+        if (m_name) begin();
+    }
+
+    ~TraceScope()
+    {
+        if (m_name) end();
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    void begin();
+
+    void end();
+
+private:
+    const char* m_name;
+    qint64 m_start;
+    quint32 m_depth;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_SCOPE(name) const TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name)
@@ -0,0 +1,407 @@
+﻿#include "UndoHistory.h"
+
+#include <QTextDocument>
+#include <QTemporaryFile>
+#include <QDataStream>
+
+#include <algorithm>
+
+namespace {
+
+// a 与 b 开头格式相同的字符数
+qsizetype commonFormatPrefix(const QVector<UndoHistory::FormatRun>& a, const QVector<UndoHistory::FormatRun>& b)
+{
+    qsizetype common = 0;
+    qsizetype i = 0, j = 0;
+    int usedA = 0, usedB = 0;
+    while (i < a.size() && j < b.size() && a[i].format == b[j].format) {
+        const int step = qMin(a[i].length - usedA, b[j].length - usedB);
+        common += step;
+        usedA += step;
+        usedB += step;
+        if (usedA == a[i].length) { ++i; usedA = 0; }
+        if (usedB == b[j].length) { ++j; usedB = 0; }
+    }
+    return common;
+}
+
+qsizetype commonFormatSuffix(QVector<UndoHistory::FormatRun> a, QVector<UndoHistory::FormatRun> b)
+{
+    std::reverse(a.begin(), a.end());
+    std::reverse(b.begin(), b.end());
+    return commonFormatPrefix(a, b);
+}
+
+void writeFormats(QDataStream& out, const QVector<UndoHistory::FormatRun>& runs)
+{
+    out << qint32(runs.size());
+    for (const UndoHistory::FormatRun& run : runs) {
+        out << qint32(run.length) << run.format;
+    }
+}
+
+void readFormats(QDataStream& in, QVector<UndoHistory::FormatRun>& runs)
+{
+    qint32 count = 0;
+    in >> count;
+    runs.clear();
+    for (qint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        qint32 length = 0;
+        QTextFormat format;
+        in >> length >> format;
+        runs.append({ int(length), format.toCharFormat() });
+    }
+}
+
+}
+
+UndoHistory::UndoHistory(QTextDocument* document, qint64 memoryLimit)
+    : QObject(document)
+    , m_document(document)
+    , m_spilledUndo(0)
+    , m_cleanDepth(document->isModified() ? -1 : 0)
+    , m_memoryLimit(memoryLimit)
+    , m_memoryBytes(0)
+    , m_charge(MemoryAccounting::Tag::UndoHistory)
+    , m_spillFile(nullptr)
+{
+    // 保存或加载后文档变为未修改，记下此时的位置，撤销回来时恢复未修改状态
+    connect(m_document, &QTextDocument::modificationChanged, this, [this](bool modified) {
+        if (!modified) m_cleanDepth = int(m_undo.size());
+        });
+}
+
+UndoHistory* UndoHistory::of(const QTextDocument* document)
+{
+    return document ? document->findChild<UndoHistory*>(QString(), Qt::FindDirectChildrenOnly) : nullptr;
+}
+
+void UndoHistory::push(Record record, bool spillNow)
+{
+    if (record.kind == Record::Kind::Edit) {
+        // 只保留真正变化的部分，文本和格式都没变的变化不记录；
+        // 富文本只改格式时文本相同，按格式不同的范围保留
+        const bool formatted = !record.removedFormats.isEmpty() || !record.insertedFormats.isEmpty();
+        const qsizetype shorter = qMin(record.removed.size(), record.inserted.size());
+        const qsizetype prefixLimit = formatted
+            ? qMin(shorter, commonFormatPrefix(record.removedFormats, record.insertedFormats)) : shorter;
+        qsizetype prefix = 0;
+        while (prefix < prefixLimit && record.removed[prefix] == record.inserted[prefix]) ++prefix;
+        const qsizetype suffixLimit = formatted
+            ? qMin(shorter - prefix, commonFormatSuffix(record.removedFormats, record.insertedFormats)) : shorter - prefix;
+        qsizetype suffix = 0;
+        while (suffix < suffixLimit
+            && record.removed[record.removed.size() - 1 - suffix] == record.inserted[record.inserted.size() - 1 - suffix]) {
+            ++suffix;
+        }
+        if (prefix == record.removed.size() && prefix == record.inserted.size()) return;
+
+        const qsizetype removedLength = record.removed.size() - prefix - suffix;
+        const qsizetype insertedLength = record.inserted.size() - prefix - suffix;
+        record.position += int(prefix);
+        record.removed = record.removed.mid(prefix, removedLength);
+        record.inserted = record.inserted.mid(prefix, insertedLength);
+        if (formatted) {
+            record.removedFormats = sliceFormats(record.removedFormats, prefix, removedLength);
+            record.insertedFormats = sliceFormats(record.insertedFormats, prefix, insertedLength);
+        }
+    }
+
+    for (const Record& redo : m_redo) {
+        m_memoryBytes -= recordBytes(redo);
+    }
+    m_redo.clear();
+    if (m_cleanDepth > m_undo.size()) m_cleanDepth = -1;
+
+    if (!merge(record)) {
+        // 写不进临时文件时先留在内存里，由 enforceLimit 处理
+        if (spillNow) spill(record);
+        m_memoryBytes += recordBytes(record);
+        m_undo.append(record);
+    }
+    m_lastPush.start();
+    enforceLimit();
+}
+
+bool UndoHistory::merge(const Record& record)
+{
+    // 保存点之前的记录不再合并，否则撤销时回不到保存时的内容
+    if (m_undo.isEmpty() || isClean() || !m_lastPush.isValid() || m_lastPush.elapsed() > MERGE_INTERVAL_MS) {
+        return false;
+    }
+
+    Record& last = m_undo.last();
+    if (last.kind != Record::Kind::Edit || record.kind != Record::Kind::Edit || last.spilled) {
+        return false;
+    }
+
+    const qint64 before = recordBytes(last);
+    bool merged = false;
+    if (last.removed.isEmpty() && record.removed.isEmpty() && record.inserted.size() == 1
+        && record.inserted[0] != QChar::ParagraphSeparator
+        && record.position == last.position + last.inserted.size()) {
+        // 连续输入，换行另起一步
+        last.inserted += record.inserted;
+        appendFormats(last.insertedFormats, record.insertedFormats);
+        merged = true;
+    }
+    else if (last.inserted.isEmpty() && record.inserted.isEmpty() && record.removed.size() == 1) {
+        if (record.position + 1 == last.position) {
+            // 连续退格
+            last.removed.prepend(record.removed);
+            QVector<FormatRun> formats = record.removedFormats;
+            appendFormats(formats, last.removedFormats);
+            last.removedFormats = formats;
+            last.position = record.position;
+            merged = true;
+        }
+        else if (record.position == last.position) {
+            // 连续向后删除
+            last.removed += record.removed;
+            appendFormats(last.removedFormats, record.removedFormats);
+            merged = true;
+        }
+    }
+
+    if (merged) {
+        // 内容变了，文件中的旧副本不能再复用
+        last.spillOffset = -1;
+        m_memoryBytes += recordBytes(last) - before;
+    }
+    return merged;
+}
+
+bool UndoHistory::takeUndo(Record* record)
+{
+    if (m_undo.isEmpty()) return false;
+
+    Record& last = m_undo.last();
+    if (last.spilled) {
+        const qint64 before = recordBytes(last);
+        if (!load(last)) return false;
+        m_memoryBytes += recordBytes(last) - before;
+    }
+
+    *record = last;
+    m_redo.append(m_undo.takeLast());
+    m_spilledUndo = qMin(m_spilledUndo, int(m_undo.size()));
+
+    // 撤销之后的输入另起一步
+    m_lastPush.invalidate();
+    enforceLimit();
+    return true;
+}
+
+bool UndoHistory::takeRedo(Record* record)
+{
+    if (m_redo.isEmpty()) return false;
+
+    Record& last = m_redo.last();
+    if (last.spilled) {
+        const qint64 before = recordBytes(last);
+        if (!load(last)) return false;
+        m_memoryBytes += recordBytes(last) - before;
+    }
+
+    *record = last;
+    m_undo.append(m_redo.takeLast());
+
+    m_lastPush.invalidate();
+    enforceLimit();
+    return true;
+}
+
+void UndoHistory::clear()
+{
+    m_undo.clear();
+    m_redo.clear();
+    m_spilledUndo = 0;
+    m_cleanDepth = m_document->isModified() ? -1 : 0;
+    m_memoryBytes = 0;
+    m_charge.set(0);
+    m_lastPush.invalidate();
+
+    delete m_spillFile;
+    m_spillFile = nullptr;
+}
+
+void UndoHistory::setMemoryLimit(qint64 bytes)
+{
+    m_memoryLimit = bytes;
+    enforceLimit();
+}
+
+qint64 UndoHistory::spilledBytes() const
+{
+    return m_spillFile ? m_spillFile->size() : 0;
+}
+
+void UndoHistory::enforceLimit()
+{
+    // 先写出撤销栈最旧的记录，再写出离当前最远的重做记录
+    while (m_memoryBytes > m_memoryLimit) {
+        while (m_spilledUndo < m_undo.size() && m_undo[m_spilledUndo].spilled) ++m_spilledUndo;
+
+        Record* victim = nullptr;
+        if (m_spilledUndo < m_undo.size()) {
+            victim = &m_undo[m_spilledUndo];
+        }
+        else {
+            for (Record& record : m_redo) {
+                if (!record.spilled) {
+                    victim = &record;
+                    break;
+                }
+            }
+        }
+        if (!victim) break;
+
+        const qint64 before = recordBytes(*victim);
+        if (spill(*victim)) {
+            m_memoryBytes += recordBytes(*victim) - before;
+            continue;
+        }
+
+        // 临时文件写不进去时丢弃最旧的撤销记录，内存仍不超过上限
+        if (victim < m_undo.data() || victim >= m_undo.data() + m_undo.size()) break;
+        const int count = int(victim - m_undo.data()) + 1;
+        for (int i = 0; i < count; ++i) {
+            m_memoryBytes -= recordBytes(m_undo[i]);
+        }
+        m_undo.remove(0, count);
+        m_spilledUndo = 0;
+        m_cleanDepth = m_cleanDepth >= count ? m_cleanDepth - count : -1;
+    }
+    m_charge.set(m_memoryBytes);
+}
+
+bool UndoHistory::spill(Record& record)
+{
+    // 读回过的记录没有改动，文件里的副本还在，不必再写一遍
+    if (record.spillOffset < 0) {
+        if (!m_spillFile) {
+            m_spillFile = new QTemporaryFile(this);
+            if (!m_spillFile->open()) {
+                delete m_spillFile;
+                m_spillFile = nullptr;
+                return false;
+            }
+        }
+        else {
+            compactSpillFile();
+        }
+
+        // 新内容追加在末尾，历史清空时整个文件删除
+        const qint64 offset = m_spillFile->size();
+        if (!m_spillFile->seek(offset)) return false;
+
+        QDataStream out(m_spillFile);
+        out.setVersion(QDataStream::Qt_6_0);
+        out << record.removed << record.inserted << record.positions;
+        writeFormats(out, record.removedFormats);
+        writeFormats(out, record.insertedFormats);
+        if (out.status() != QDataStream::Ok) return false;
+
+        record.spillOffset = offset;
+        record.spillLength = m_spillFile->pos() - offset;
+    }
+
+    record.spilled = true;
+    record.removed = QString();
+    record.inserted = QString();
+    record.removedFormats = QVector<FormatRun>();
+    record.insertedFormats = QVector<FormatRun>();
+    record.positions = QVector<int>();
+    return true;
+}
+
+bool UndoHistory::load(Record& record)
+{
+    if (!m_spillFile || !m_spillFile->seek(record.spillOffset)) return false;
+
+    QDataStream in(m_spillFile);
+    in.setVersion(QDataStream::Qt_6_0);
+    in >> record.removed >> record.inserted >> record.positions;
+    readFormats(in, record.removedFormats);
+    readFormats(in, record.insertedFormats);
+    if (in.status() != QDataStream::Ok) return false;
+
+    // 副本留在文件里，再次写出时复用
+    record.spilled = false;
+    return true;
+}
+
+void UndoHistory::compactSpillFile()
+{
+    // 被新修改清掉的重做记录、超限丢弃的撤销记录在文件里的副本不再有人引用，
+    // 它们远多于仍在使用的副本时，把用到的副本搬进新文件
+    const qint64 size = m_spillFile->size();
+    if (size < COMPACT_MIN_BYTES) return;
+
+    QVector<Record*> live;
+    qint64 liveBytes = 0;
+    for (QVector<Record>* records : { &m_undo, &m_redo }) {
+        for (Record& record : *records) {
+            if (record.spillOffset < 0) continue;
+            live.append(&record);
+            liveBytes += record.spillLength;
+        }
+    }
+    if (size <= liveBytes * 2) return;
+
+    // 整理失败就继续在原文件后面追加
+    QTemporaryFile* compacted = new QTemporaryFile(this);
+    if (!compacted->open()) {
+        delete compacted;
+        return;
+    }
+    QVector<qint64> offsets;
+    offsets.reserve(live.size());
+    for (const Record* record : live) {
+        const QByteArray data = m_spillFile->seek(record->spillOffset)
+            ? m_spillFile->read(record->spillLength) : QByteArray();
+        offsets.append(compacted->pos());
+        if (data.size() != record->spillLength || compacted->write(data) != data.size()) {
+            delete compacted;
+            return;
+        }
+    }
+
+    for (int i = 0; i < live.size(); ++i) {
+        live[i]->spillOffset = offsets[i];
+    }
+    delete m_spillFile;
+    m_spillFile = compacted;
+}
+
+qint64 UndoHistory::recordBytes(const Record& record)
+{
+    if (record.spilled) return RECORD_OVERHEAD;
+    return RECORD_OVERHEAD + (record.removed.size() + record.inserted.size()) * qint64(sizeof(QChar))
+        + (record.removedFormats.size() + record.insertedFormats.size()) * qint64(sizeof(FormatRun))
+        + record.positions.size() * qint64(sizeof(int));
+}
+
+QVector<UndoHistory::FormatRun> UndoHistory::sliceFormats(const QVector<FormatRun>& runs, qsizetype offset, qsizetype length)
+{
+    QVector<FormatRun> result;
+    const qsizetype end = offset + length;
+    qsizetype start = 0;
+    for (const FormatRun& run : runs) {
+        const qsizetype runEnd = start + run.length;
+        const qsizetype from = qMax(start, offset);
+        const qsizetype to = qMin(runEnd, end);
+        if (from < to) result.append({ int(to - from), run.format });
+        if (runEnd >= end) break;
+        start = runEnd;
+    }
+    return result;
+}
+
+void UndoHistory::appendFormats(QVector<FormatRun>& runs, const QVector<FormatRun>& more)
+{
+    for (const FormatRun& run : more) {
+        if (!runs.isEmpty() && runs.last().format == run.format) runs.last().length += run.length;
+        else runs.append(run);
+    }
+}
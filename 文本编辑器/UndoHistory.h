@@ -0,0 +1,113 @@
+﻿#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QTextCharFormat>
+#include "MemoryAccounting.h"
+
+class QTextDocument;
+class QTemporaryFile;
+
+// 一个文档的撤销历史。每一步保存为差异记录，连续输入和删除合并成一步；
+// 内存超过上限时把最旧的记录写入临时文件，撤销到它时再读回。
+// 读回的记录在文件中的副本保留着，再次写出时直接复用；
+// 不再被引用的内容远多于仍在使用的内容时整理一次文件。
+// 作为文档的子对象创建，随文档一起释放
+class UndoHistory : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 一段连续文本共用的字符格式，富文本文档才记录
+    struct FormatRun {
+        int length = 0;
+        QTextCharFormat format;
+    };
+
+    struct Record {
+        enum class Kind {
+            Edit,           // 在 position 处把 removed 换成 inserted
+            ReplaceAll,     // 在 positions 各处把 removed 换成 inserted
+        };
+
+        Kind kind = Kind::Edit;
+        int position = 0;           // 文档位置
+        QString removed;
+        QString inserted;
+        QVector<FormatRun> removedFormats;   // 与 removed 等长，纯文本文档为空
+        QVector<FormatRun> insertedFormats;
+        QVector<int> positions;     // 替换后各处的逻辑位置，升序
+        bool spilled = false;       // 内容只在临时文件中，不在内存里
+        qint64 spillOffset = -1;    // 内容在临时文件中的副本，-1 表示没有
+        qint64 spillLength = 0;
+    };
+
+    UndoHistory(QTextDocument* document, qint64 memoryLimit);
+    ~UndoHistory() override = default;
+
+    // 文档的撤销历史，还没有创建时返回空
+    static UndoHistory* of(const QTextDocument* document);
+
+    bool canUndo() const { return !m_undo.isEmpty(); }
+
+    bool canRedo() const { return !m_redo.isEmpty(); }
+
+    // 记录一次新的修改，并清空可重做的记录；
+    // spillNow 为 true 时直接写入临时文件，超大的一步不必先占用内存
+    void push(Record record, bool spillNow = false);
+
+    // 把最近一步移到另一侧并返回它，写入磁盘的内容读回内存；读取失败时返回 false
+    bool takeUndo(Record* record);
+
+    bool takeRedo(Record* record);
+
+    void clear();
+
+    // 历史回到了文档上次保存（或加载）时的位置
+    bool isClean() const { return m_undo.size() == m_cleanDepth; }
+
+    qint64 memoryLimit() const { return m_memoryLimit; }
+
+    void setMemoryLimit(qint64 bytes);
+
+    // 内存中记录的估计占用
+    qint64 memoryBytes() const { return m_memoryBytes; }
+
+    // 临时文件的大小
+    qint64 spilledBytes() const;
+
+    int undoCount() const { return int(m_undo.size()); }
+
+    // runs 中从 offset 起 length 个字符的格式
+    static QVector<FormatRun> sliceFormats(const QVector<FormatRun>& runs, qsizetype offset, qsizetype length);
+
+    // 把 more 接到 runs 后面，相邻的相同格式合并
+    static void appendFormats(QVector<FormatRun>& runs, const QVector<FormatRun>& more);
+
+private:
+    bool merge(const Record& record);
+    void enforceLimit();
+    bool spill(Record& record);
+    bool load(Record& record);
+    void compactSpillFile();
+
+    static qint64 recordBytes(const Record& record);
+
+private:
+    QTextDocument* m_document;
+    QVector<Record> m_undo;         // 末尾是最近一步
+    QVector<Record> m_redo;         // 末尾是下一步要重做的
+    int m_spilledUndo;              // m_undo 开头已写入临时文件的记录数
+    int m_cleanDepth;               // 保存时 m_undo 的长度，-1 表示无法回到保存状态
+    qint64 m_memoryLimit;
+    qint64 m_memoryBytes;
+    MemoryAccounting::Charge m_charge;  // m_memoryBytes 同步到全局记账
+    QTemporaryFile* m_spillFile;    // 首次溢出时创建
+    QElapsedTimer m_lastPush;       // 间隔太久的输入不再合并
+
+    static constexpr int MERGE_INTERVAL_MS = 1000;
+    static constexpr qint64 RECORD_OVERHEAD = 64;   // 记录本身和字符串头的近似开销
+    static constexpr qint64 COMPACT_MIN_BYTES = 16LL * 1024 * 1024;  // 临时文件小于此大小时不整理
+};
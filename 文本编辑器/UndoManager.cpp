@@ -0,0 +1,411 @@
+﻿#include "UndoManager.h"
+#include "EditorHost.h"
+
+#include <QTextDocument>
+#include <QTextCursor>
+#include <QTextBlock>
+#include <QTimer>
+#include <QKeyEvent>
+#include <QWidget>
+#include <QContextMenuEvent>
+#include <QTextEdit>
+#include <QPlainTextEdit>
+#include <QScrollBar>
+#include <QMenu>
+#include <QAction>
+
+namespace {
+
+// 会修改文本的按键：可打印字符、退格、删除、换行、剪切和粘贴
+bool editsText(const QKeyEvent* event)
+{
+    if (event->matches(QKeySequence::Cut) || event->matches(QKeySequence::Paste)) return true;
+    switch (event->key()) {
+    case Qt::Key_Backspace:
+    case Qt::Key_Delete:
+    case Qt::Key_Return:
+    case Qt::Key_Enter:
+    case Qt::Key_Tab:
+        return true;
+    default:
+        break;
+    }
+    const QString text = event->text();
+    return !text.isEmpty() && text.front().isPrint();
+}
+
+}
+
+UndoManager::UndoManager(EditorHost* editor)
+    : QObject(editor)
+    , m_editor(editor)
+    , m_document(nullptr)
+    , m_snapshotTimer(new QTimer(this))
+    , m_snapshotStart(-1)
+    , m_snapshotCharge(MemoryAccounting::Tag::TextCopies)
+    , m_snapshotDirty(true)
+    , m_suspendCount(0)
+    , m_memoryLimit(DEFAULT_MEMORY_LIMIT)
+    , m_recordFormats(false)
+{
+    m_snapshotTimer->setSingleShot(true);
+    m_snapshotTimer->setInterval(SNAPSHOT_DELAY_MS);
+    connect(m_snapshotTimer, &QTimer::timeout, this, &UndoManager::refreshSnapshot);
+
+    connect(m_editor, &EditorHost::documentReplaced, this, &UndoManager::onDocumentReplaced);
+    connect(m_editor, &EditorHost::cursorPositionChanged, this, &UndoManager::invalidateSnapshot);
+    connect(m_editor, &EditorHost::selectionChanged, this, &UndoManager::invalidateSnapshot);
+
+    onDocumentReplaced(m_editor->document());
+}
+
+UndoHistory* UndoManager::history() const
+{
+    return UndoHistory::of(m_document);
+}
+
+bool UndoManager::canUndo() const
+{
+    const UndoHistory* undoHistory = history();
+    return undoHistory && undoHistory->canUndo();
+}
+
+bool UndoManager::canRedo() const
+{
+    const UndoHistory* undoHistory = history();
+    return undoHistory && undoHistory->canRedo();
+}
+
+bool UndoManager::undo()
+{
+    UndoHistory* undoHistory = history();
+    if (!undoHistory || !undoHistory->canUndo()) return false;
+
+    UndoHistory::Record record;
+    if (!undoHistory->takeUndo(&record)) {
+        // 临时文件读不回来，更早的历史都无法使用
+        undoHistory->clear();
+        emit historyTruncated();
+        return false;
+    }
+    apply(record, true);
+    return true;
+}
+
+bool UndoManager::redo()
+{
+    UndoHistory* undoHistory = history();
+    if (!undoHistory || !undoHistory->canRedo()) return false;
+
+    UndoHistory::Record record;
+    if (!undoHistory->takeRedo(&record)) {
+        undoHistory->clear();
+        emit historyTruncated();
+        return false;
+    }
+    apply(record, false);
+    return true;
+}
+
+void UndoManager::clear()
+{
+    if (UndoHistory* undoHistory = history()) {
+        undoHistory->clear();
+    }
+}
+
+void UndoManager::prepareEdit(const QTextCursor& range)
+{
+    const int start = range.selectionStart();
+    const int end = range.selectionEnd();
+    if (!m_snapshotDirty && m_snapshotStart >= 0
+        && start >= m_snapshotStart && end <= m_snapshotStart + m_snapshot.size()) {
+        return;
+    }
+
+    // 程序主动修改，范围再大也要取，不受选区快照的长度限制
+    m_snapshotTimer->stop();
+    m_snapshotDirty = false;
+    takeSnapshot(start, end);
+}
+
+void UndoManager::recordReplaceAll(const QVector<int>& positions, const QString& pattern, const QString& replacement)
+{
+    UndoHistory* undoHistory = history();
+    if (!undoHistory || positions.isEmpty() || m_suspendCount > 0) return;
+
+    // 换算成替换后的位置，撤销时直接按它们选中替换内容
+    UndoHistory::Record record;
+    record.kind = UndoHistory::Record::Kind::ReplaceAll;
+    record.removed = pattern;
+    record.inserted = replacement;
+    record.positions.reserve(positions.size());
+    const int delta = int(replacement.size() - pattern.size());
+    for (int i = 0; i < positions.size(); ++i) {
+        record.positions.append(positions[i] + i * delta);
+    }
+    undoHistory->push(record);
+}
+
+void UndoManager::setMemoryLimit(qint64 bytes)
+{
+    m_memoryLimit = bytes;
+    for (UndoHistory* undoHistory : m_editor->findChildren<UndoHistory*>()) {
+        undoHistory->setMemoryLimit(bytes);
+    }
+    if (UndoHistory* undoHistory = history()) {
+        undoHistory->setMemoryLimit(bytes);
+    }
+}
+
+void UndoManager::onDocumentReplaced(QTextDocument* document)
+{
+    if (m_document) {
+        disconnect(m_document, &QTextDocument::contentsChange, this, &UndoManager::onContentsChange);
+    }
+    m_document = document;
+    if (!m_document) return;
+
+    connect(m_document, &QTextDocument::contentsChange, this, &UndoManager::onContentsChange);
+
+    // 关闭自带的撤销栈，同一次修改不在两处各存一份；富文本的格式也记录在本类的历史里
+    m_document->setUndoRedoEnabled(false);
+    m_recordFormats = m_editor->mode() == EditorHost::Mode::RichText;
+    if (!UndoHistory::of(m_document)) {
+        new UndoHistory(m_document, m_memoryLimit);
+    }
+
+    // 纯文本编辑器是首次切换时才创建的，重复安装只会调整顺序；
+    // 右键菜单事件发给视口
+    m_editor->widget()->installEventFilter(this);
+    m_editor->viewport()->installEventFilter(this);
+    refreshSnapshot();
+}
+
+void UndoManager::onContentsChange(int position, int charsRemoved, int charsAdded)
+{
+    UndoHistory* undoHistory = history();
+    if (m_suspendCount == 0 && undoHistory && (charsRemoved > 0 || charsAdded > 0)) {
+        const bool covered = charsRemoved == 0 || (m_snapshotStart >= 0 && position >= m_snapshotStart
+            && position + charsRemoved <= m_snapshotStart + m_snapshot.size());
+        if (covered) {
+            UndoHistory::Record record;
+            record.position = position;
+            record.removed = m_snapshot.mid(position - m_snapshotStart, charsRemoved);
+            record.inserted = documentText(position, position + charsAdded);
+            if (m_recordFormats) {
+                record.removedFormats = UndoHistory::sliceFormats(m_snapshotFormats, position - m_snapshotStart, charsRemoved);
+                record.insertedFormats = documentFormats(position, position + charsAdded);
+            }
+            // 超长选区的原文不在内存里多留，直接写入临时文件
+            undoHistory->push(record, charsRemoved > MAX_SNAPSHOT_CHARS);
+        }
+        else {
+            // 拿不到被删除的原文，这次修改无法撤销，更早的记录也不能再用
+            undoHistory->clear();
+            emit historyTruncated();
+        }
+    }
+
+    // 位置都已变化，立即为下一次修改取快照
+    refreshSnapshot();
+}
+
+void UndoManager::invalidateSnapshot()
+{
+    m_snapshotDirty = true;
+    m_snapshotTimer->start();
+}
+
+void UndoManager::refreshSnapshot()
+{
+    m_snapshotTimer->stop();
+    m_snapshotDirty = false;
+    m_snapshotStart = -1;
+    m_snapshot.clear();
+    m_snapshotFormats.clear();
+    m_snapshotCharge.set(0);
+
+    const QTextCursor cursor = m_editor->textCursor();
+    if (!m_document || cursor.document() != m_document) return;
+
+    // 覆盖选区和前后各一个块，退格、删除把相邻两行合并时也能取到原文
+    QTextBlock first = m_document->findBlock(cursor.selectionStart());
+    QTextBlock last = m_document->findBlock(cursor.selectionEnd());
+    if (first.previous().isValid()) first = first.previous();
+    if (last.next().isValid()) last = last.next();
+
+    // 超长的选区等到真要修改时再取，见 eventFilter
+    const int start = first.position();
+    const int end = last.position() + last.length();
+    if (end - start <= MAX_SNAPSHOT_CHARS) {
+        takeSnapshot(start, end);
+    }
+}
+
+void UndoManager::takeSnapshot(int start, int end)
+{
+    m_snapshotStart = start;
+    m_snapshot = documentText(start, end);
+    m_snapshotFormats = m_recordFormats ? documentFormats(start, end) : QVector<UndoHistory::FormatRun>();
+    m_snapshotCharge.set(MemoryAccounting::bytesOf(m_snapshot)
+        + m_snapshotFormats.size() * qint64(sizeof(UndoHistory::FormatRun)));
+}
+
+QString UndoManager::documentText(int start, int end) const
+{
+    // 块之间是段落分隔符，与文档位置一一对应，插回文档时同样变成换行
+    const int last = m_document->characterCount() - 1;
+    QTextCursor cursor(m_document);
+    cursor.setPosition(qMin(start, last));
+    cursor.setPosition(qMin(end, last), QTextCursor::KeepAnchor);
+    QString text = cursor.selectedText();
+
+    // contentsChange 有时把文档末尾隐含的段落分隔符也算进范围，
+    // 两边都补上，记录时作为相同的后缀去掉
+    if (end > last) text += QChar::ParagraphSeparator;
+    return text;
+}
+
+QVector<UndoHistory::FormatRun> UndoManager::documentFormats(int start, int end) const
+{
+    // 每个片段一段，块末的段落分隔符使用块的字符格式
+    QVector<UndoHistory::FormatRun> runs;
+    for (QTextBlock block = m_document->findBlock(start); block.isValid() && block.position() < end; block = block.next()) {
+        for (QTextBlock::iterator it = block.begin(); !it.atEnd(); ++it) {
+            const QTextFragment fragment = it.fragment();
+            const int from = qMax(start, fragment.position());
+            const int to = qMin(end, fragment.position() + fragment.length());
+            if (from < to) UndoHistory::appendFormats(runs, { { to - from, fragment.charFormat() } });
+        }
+        const int separator = block.position() + block.length() - 1;
+        if (separator >= start && separator < end) {
+            UndoHistory::appendFormats(runs, { { 1, block.charFormat() } });
+        }
+    }
+    return runs;
+}
+
+void UndoManager::apply(const UndoHistory::Record& record, bool reverse)
+{
+    const QString& from = reverse ? record.inserted : record.removed;
+    const QString& to = reverse ? record.removed : record.inserted;
+
+    int caret = 0;
+    {
+        const Suspender suspender(this);
+        if (record.kind == UndoHistory::Record::Kind::Edit) {
+            const QVector<UndoHistory::FormatRun>& formats = reverse ? record.removedFormats : record.insertedFormats;
+            QTextCursor cursor(m_document);
+            cursor.setPosition(record.position);
+            cursor.setPosition(record.position + int(from.size()), QTextCursor::KeepAnchor);
+            if (formats.isEmpty()) {
+                cursor.insertText(to);
+            }
+            else {
+                // 按原来的格式逐段插回
+                cursor.beginEditBlock();
+                cursor.removeSelectedText();
+                int offset = 0;
+                for (const UndoHistory::FormatRun& run : formats) {
+                    cursor.insertText(to.mid(offset, run.length), run.format);
+                    offset += run.length;
+                }
+                cursor.endEditBlock();
+            }
+            caret = cursor.position();
+        }
+        else {
+            // 与全部替换相同，从后向前改，前面的位置不受影响；
+            // 记录的是替换后的位置，重做时减去前面各处造成的偏移
+            const int delta = int(record.inserted.size() - record.removed.size());
+            QTextCursor block(m_document);
+            block.beginEditBlock();
+            for (int i = int(record.positions.size()) - 1; i >= 0; --i) {
+                const int position = reverse ? record.positions[i] : record.positions[i] - i * delta;
+                QTextCursor cursor = m_editor->cursorForRange(position, int(from.size()));
+                cursor.insertText(to);
+            }
+            block.endEditBlock();
+            caret = m_editor->documentPosition(record.positions.first());
+        }
+    }
+
+    QTextCursor cursor(m_document);
+    cursor.setPosition(qMin(caret, m_document->characterCount() - 1));
+    m_editor->setTextCursor(cursor);
+
+    // 回到保存时的位置则恢复为未修改
+    m_document->setModified(!history()->isClean());
+}
+
+void UndoManager::showContextMenu(const QContextMenuEvent* event)
+{
+    // 菜单用的是文档坐标，只影响链接相关的菜单项
+    QMenu* menu = nullptr;
+    if (QTextEdit* edit = qobject_cast<QTextEdit*>(m_editor->widget())) {
+        const QPoint offset(edit->horizontalScrollBar()->value(), edit->verticalScrollBar()->value());
+        menu = edit->createStandardContextMenu(event->pos() + offset);
+    }
+    else if (QPlainTextEdit* edit = qobject_cast<QPlainTextEdit*>(m_editor->widget())) {
+        menu = edit->createStandardContextMenu(event->pos());
+    }
+    if (!menu) return;
+
+    for (QAction* action : menu->actions()) {
+        if (action->objectName() == QLatin1String("edit-undo")) {
+            disconnect(action, &QAction::triggered, nullptr, nullptr);
+            connect(action, &QAction::triggered, this, &UndoManager::undo);
+            action->setEnabled(canUndo());
+        }
+        else if (action->objectName() == QLatin1String("edit-redo")) {
+            disconnect(action, &QAction::triggered, nullptr, nullptr);
+            connect(action, &QAction::triggered, this, &UndoManager::redo);
+            action->setEnabled(canRedo());
+        }
+    }
+
+    // 剪切、删除超长选区时同样需要原文
+    const QTextCursor cursor = m_editor->textCursor();
+    if (m_snapshotDirty) refreshSnapshot();
+    if (m_snapshotStart < 0 && cursor.hasSelection()) {
+        takeSnapshot(cursor.selectionStart(), cursor.selectionEnd() + 1);
+    }
+
+    menu->exec(event->globalPos());
+    delete menu;
+}
+
+bool UndoManager::eventFilter(QObject* watched, QEvent* event)
+{
+    if (event->type() == QEvent::ContextMenu && watched == m_editor->viewport()) {
+        showContextMenu(static_cast<QContextMenuEvent*>(event));
+        return true;
+    }
+
+    if (event->type() == QEvent::KeyPress) {
+        QKeyEvent* keyEvent = static_cast<QKeyEvent*>(event);
+        if (keyEvent->matches(QKeySequence::Undo)) {
+            undo();
+            return true;
+        }
+        if (keyEvent->matches(QKeySequence::Redo)) {
+            redo();
+            return true;
+        }
+    }
+
+    // 输入马上要修改文本，补上还没来得及取的快照。超长的选区平时不取，
+    // 要被替换或删除时才取；多取一个字符，contentsChange 可能把文档末尾隐含的段落分隔符也算进范围
+    const bool keyPress = event->type() == QEvent::KeyPress;
+    if (keyPress || event->type() == QEvent::InputMethod) {
+        if (m_snapshotDirty) refreshSnapshot();
+
+        const QTextCursor cursor = m_editor->textCursor();
+        if (m_snapshotStart < 0 && cursor.hasSelection()
+            && (!keyPress || editsText(static_cast<QKeyEvent*>(event)))) {
+            takeSnapshot(cursor.selectionStart(), cursor.selectionEnd() + 1);
+        }
+    }
+    return QObject::eventFilter(watched, event);
+}
@@ -0,0 +1,111 @@
+﻿#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+#include "UndoHistory.h"
+#include "MemoryAccounting.h"
+
+class EditorHost;
+class QTextDocument;
+class QTextCursor;
+class QTimer;
+class QContextMenuEvent;
+
+// 代替 QTextDocument 自带的撤销栈：当前文档的每次修改都记录到它的 UndoHistory，
+// 全部替换只记录位置和前后两个字符串，历史占用的内存受上限约束。
+// 修改前的原文取自光标和选区附近的快照，程序修改别处的文本之前调用 prepareEdit；
+// 富文本文档同时记录字符格式，撤销删除和格式修改时恢复原来的格式。
+// 加载文件等不可撤销的修改放在 Suspender 作用域里
+class UndoManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 作用域内的修改不记录，可以嵌套
+    class Suspender
+    {
+    public:
+        explicit Suspender(UndoManager* manager) : m_manager(manager) { ++m_manager->m_suspendCount; }
+        ~Suspender() { --m_manager->m_suspendCount; }
+
+    private:
+        UndoManager* m_manager;
+    };
+
+    explicit UndoManager(EditorHost* editor);
+    ~UndoManager() override = default;
+
+    bool canUndo() const;
+
+    bool canRedo() const;
+
+    bool undo();
+
+    bool redo();
+
+    // 清空当前文档的历史
+    void clear();
+
+    // 程序修改光标附近以外的文本之前调用，记下 range 选中范围的原文
+    void prepareEdit(const QTextCursor& range);
+
+    // 全部替换完成后记录为一步，positions 是替换前各处的逻辑位置（升序、不重叠）
+    void recordReplaceAll(const QVector<int>& positions, const QString& pattern, const QString& replacement);
+
+    qint64 memoryLimit() const { return m_memoryLimit; }
+
+    // 每个文档的历史分别受此上限约束
+    void setMemoryLimit(qint64 bytes);
+
+    static constexpr qint64 DEFAULT_MEMORY_LIMIT = 64LL * 1024 * 1024;
+
+signals:
+    // 一次修改的原文无法取得，当前文档之前的历史已清空
+    void historyTruncated();
+
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
+private slots:
+    void onDocumentReplaced(QTextDocument* document);
+
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+
+    void invalidateSnapshot();
+
+    void refreshSnapshot();
+
+private:
+    UndoHistory* history() const;
+
+    // 撤销时反向应用记录，重做时正向应用
+    void apply(const UndoHistory::Record& record, bool reverse);
+
+    void takeSnapshot(int start, int end);
+
+    QString documentText(int start, int end) const;
+
+    // [start, end) 的字符格式，范围的切分与 documentText 一致
+    QVector<UndoHistory::FormatRun> documentFormats(int start, int end) const;
+
+    // 控件自带的右键菜单，撤销、重做改为操作本类的历史
+    void showContextMenu(const QContextMenuEvent* event);
+
+private:
+    EditorHost* m_editor;
+    QTextDocument* m_document;  // 正在记录的文档
+    QTimer* m_snapshotTimer;    // 光标或选区停止变化后再取快照
+    QString m_snapshot;         // 修改前的原文
+    QVector<UndoHistory::FormatRun> m_snapshotFormats;  // 原文的格式，只在富文本文档中记录
+    int m_snapshotStart;        // 快照在文档中的位置，-1 表示没有快照
+    MemoryAccounting::Charge m_snapshotCharge;
+    bool m_snapshotDirty;
+    int m_suspendCount;
+    qint64 m_memoryLimit;
+    bool m_recordFormats;       // 当前文档是富文本
+
+    static constexpr int SNAPSHOT_DELAY_MS = 50;
+    static constexpr int MAX_SNAPSHOT_CHARS = 16 * 1024 * 1024;  // 更大的选区在将被修改时才取原文，记录直接写入临时文件
+};
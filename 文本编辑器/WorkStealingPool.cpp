@@ -0,0 +1,131 @@
+﻿#include "WorkStealingPool.h"
+
+namespace {
+
+// 当前线程所属的线程池和工作线程序号
+thread_local const WorkStealingPool* t_pool = nullptr;
+thread_local int t_workerIndex = -1;
+
+}
+
+WorkStealingPool::WorkStealingPool(int workerCount)
+    : m_pending(0)
+    , m_queued(0)
+    , m_nextWorker(0)
+    , m_cancelled(false)
+    , m_stopping(false)
+{
+    if (workerCount <= 0) workerCount = QThread::idealThreadCount();
+
+    for (int i = 0; i < workerCount; ++i) {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    for (int i = 0; i < workerCount; ++i) {
+        m_threads.emplace_back(QThread::create([this, i]() { run(i); }));
+        m_threads.back()->start();
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    cancel();
+    wait();
+
+    {
+        QMutexLocker locker(&m_idleMutex);
+        m_stopping = true;
+        m_idleCondition.wakeAll();
+    }
+    for (const std::unique_ptr<QThread>& thread : m_threads) {
+        thread->wait();
+    }
+}
+
+void WorkStealingPool::submit(Task task)
+{
+    const int index = t_pool == this
+        ? t_workerIndex
+        : int(m_nextWorker.fetch_add(1, std::memory_order_relaxed) % m_workers.size());
+
+    ++m_pending;
+    {
+        // 在队列锁内计数，取任务时的递减不会先于这里
+        QMutexLocker locker(&m_workers[index]->mutex);
+        m_workers[index]->tasks.push_back(std::move(task));
+        ++m_queued;
+    }
+
+    // 先增加计数再加锁唤醒，等待中的线程不会错过
+    QMutexLocker locker(&m_idleMutex);
+    m_idleCondition.wakeOne();
+}
+
+void WorkStealingPool::wait()
+{
+    QMutexLocker locker(&m_doneMutex);
+    while (m_pending.load() > 0) {
+        m_doneCondition.wait(&m_doneMutex);
+    }
+}
+
+void WorkStealingPool::cancel()
+{
+    m_cancelled = true;
+}
+
+bool WorkStealingPool::takeTask(int index, Task& task)
+{
+    // 自己的队列后进先出，局部性好
+    {
+        Worker& own = *m_workers[index];
+        QMutexLocker locker(&own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            --m_queued;
+            return true;
+        }
+    }
+
+    // 从其他线程的队首窃取，拿到的通常是较大的任务（如上层目录）
+    const int count = int(m_workers.size());
+    for (int offset = 1; offset < count; ++offset) {
+        Worker& victim = *m_workers[(index + offset) % count];
+        QMutexLocker locker(&victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            --m_queued;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::run(int index)
+{
+    t_pool = this;
+    t_workerIndex = index;
+
+    Task task;
+    while (true) {
+        if (!takeTask(index, task)) {
+            QMutexLocker locker(&m_idleMutex);
+            while (m_queued.load() == 0 && !m_stopping) {
+                m_idleCondition.wait(&m_idleMutex);
+            }
+            if (m_stopping) return;
+            continue;
+        }
+
+        if (!isCancelled()) {
+            task();
+        }
+        task = nullptr;
+
+        if (--m_pending == 0) {
+            QMutexLocker locker(&m_doneMutex);
+            m_doneCondition.wakeAll();
+        }
+    }
+}
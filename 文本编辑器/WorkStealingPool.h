@@ -0,0 +1,59 @@
+﻿#pragma once
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThread>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// 工作窃取线程池：每个工作线程有自己的双端队列，从队尾取自己提交的任务，
+// 空闲时从其他线程的队首窃取。任务可以继续提交子任务（如遍历目录时提交子目录）
+class WorkStealingPool
+{
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingPool(int workerCount = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // 在工作线程内提交时放入该线程自己的队列，否则轮流分配
+    void submit(Task task);
+
+    // 阻塞到所有已提交的任务（含其子任务）完成
+    void wait();
+
+    // 取消后尚未开始的任务直接丢弃
+    void cancel();
+
+    bool isCancelled() const { return m_cancelled.load(std::memory_order_relaxed); }
+
+private:
+    struct Worker {
+        QMutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void run(int index);
+
+    bool takeTask(int index, Task& task);
+
+private:
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::unique_ptr<QThread>> m_threads;
+    std::atomic<int> m_pending;         // 已提交但未完成的任务数
+    std::atomic<int> m_queued;          // 仍在队列中的任务数
+    std::atomic<unsigned> m_nextWorker;
+    std::atomic<bool> m_cancelled;
+    std::atomic<bool> m_stopping;
+    QMutex m_idleMutex;
+    QWaitCondition m_idleCondition;     // 没有任务时工作线程在此等待
+    QMutex m_doneMutex;
+    QWaitCondition m_doneCondition;
+};
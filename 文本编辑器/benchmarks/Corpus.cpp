@@ -0,0 +1,189 @@
+﻿#include "Corpus.h"
+
+#include <array>
+#include <cstdio>
+
+namespace {
+
+// SplitMix64：结果只取决于种子，不依赖标准库的分布实现
+class Random
+{
+public:
+    explicit Random(quint64 seed) : m_state(seed) {}
+
+    quint64 next()
+    {
+        quint64 z = (m_state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // [0, bound)
+    int below(int bound) { return int(next() % quint64(bound)); }
+
+    int between(int low, int high) { return low + below(high - low + 1); }
+
+private:
+    quint64 m_state;
+};
+
+// 按常见程度排列的常用汉字，生成时偏向前面的字
+const QString COMMON_HANZI = QStringLiteral(
+    "的一是在不了有和人这中大为上个国我以要他时来用们生到作地于出就分对成会可主发年动同工也能下过子说产种面而方后多定行学法所民得经"
+    "十三之进着等部度家电力里如水化高自二理起小物现实加量都两体制机当使点从业本去把性好应开它合还因由其些然前外天政四日那社义事平形"
+    "相全表间样与关各重新线内数正心反你明看原又么利比或但质气第向道命此变条只没结解问意建月公无系军很情者最立代想已通并提直题党程展"
+    "五果料象员革位入常文总次品式活设及管特件长求老头基资边流路级少图山统接知较将组见计别她手角期根论运农指几九区强放决西被干做必战"
+    "先回则任取据处府研队南给色光门即保治北造百规热领七海口东导器压志世金增争济阶油思术极交受联什认六共权收证改清美再采转更单风切打"
+    "白教速花带安场身车例真务具万每目至达走积示议声报斗完类八离华名确才科张信马节话米整空元况今集温传土许步群广石记需段研界拉林律叫");
+
+const char* const LOG_LEVELS[] = { "INFO ", "DEBUG", "WARN ", "ERROR" };
+const char* const LOG_PATHS[] = { "items", "users", "orders", "search", "session", "upload" };
+
+QString asciiLog(qint64 bytes, Random& random)
+{
+    QString text;
+    text.reserve(bytes + 256);
+
+    qint64 seconds = 1700000000 + random.below(86400);
+    char line[256];
+    while (text.size() < bytes) {
+        seconds += random.below(3);
+        const int roll = random.below(100);
+        const int level = roll < 80 ? 0 : roll < 92 ? 1 : roll < 98 ? 2 : 3;
+        const int status = level == 3 ? 500 : level == 2 ? 404 : 200;
+
+        const int length = std::snprintf(line, sizeof(line),
+            "%lld.%03d %s [worker-%02d] req=%016llx path=/api/v1/%s/%d status=%d latency=%dms\n",
+            seconds, random.below(1000), LOG_LEVELS[level], random.below(32),
+            static_cast<unsigned long long>(random.next()), LOG_PATHS[random.below(6)],
+            random.below(100000), status, random.between(1, 2000));
+        text += QLatin1String(line, length);
+    }
+    return text;
+}
+
+QString cjkProse(qint64 bytes, Random& random)
+{
+    // 汉字和全角标点在 UTF-8 中都是 3 字节
+    QString text;
+    text.reserve(bytes / 3 + 256);
+
+    const QString marker = QStringLiteral("文本编辑器");
+    qint64 written = 0;
+    while (written < bytes) {
+        const int sentences = random.between(3, 8);
+        for (int s = 0; s < sentences; ++s) {
+            const int length = random.between(8, 30);
+            for (int i = 0; i < length; ++i) {
+                // 两次取小值，让常用字出现得更多
+                const int index = qMin(random.below(int(COMMON_HANZI.size())), random.below(int(COMMON_HANZI.size())));
+                text += COMMON_HANZI[index];
+            }
+            if (random.below(64) == 0) {
+                text += marker;
+                written += marker.size() * 3;
+            }
+            text += s + 1 < sentences ? QChar(0xFF0C) : QChar(0x3002);
+            written += (length + 1) * 3;
+        }
+        text += QLatin1Char('\n');
+        written += 1;
+    }
+    return text;
+}
+
+QString repetitive(qint64 bytes, Random& random)
+{
+    // 长短不一的 a 串以 b 结尾，查找 aaa…ab 时几乎每个字符都部分匹配
+    QString text;
+    text.reserve(bytes + 256);
+
+    qsizetype lineStart = 0;
+    while (text.size() < bytes) {
+        text += QString(random.between(1, 96), QLatin1Char('a'));
+        text += QLatin1Char('b');
+        if (text.size() - lineStart >= 200) {
+            text += QLatin1Char('\n');
+            lineStart = text.size();
+        }
+    }
+    if (!text.endsWith(QLatin1Char('\n'))) text += QLatin1Char('\n');
+    return text;
+}
+
+}
+
+QString Corpus::generate(Kind kind, qint64 bytes, quint64 seed)
+{
+    // 不同语料使用不同的种子序列，同时改变大小时前缀保持一致
+    Random random(seed ^ (quint64(kind) + 1) * 0xD1B54A32D192ED03ULL);
+    switch (kind) {
+    case Kind::AsciiLog:
+        return asciiLog(bytes, random);
+    case Kind::CjkProse:
+        return cjkProse(bytes, random);
+    case Kind::Repetitive:
+        return repetitive(bytes, random);
+    }
+    return QString();
+}
+
+Corpus::Workload Corpus::workload(Kind kind)
+{
+    switch (kind) {
+    case Kind::AsciiLog:
+        return { QStringLiteral("ERROR"), QStringLiteral("FATAL") };
+    case Kind::CjkProse:
+        return { QStringLiteral("文本编辑器"), QStringLiteral("编辑器") };
+    case Kind::Repetitive:
+        return { QString(31, QLatin1Char('a')) + QLatin1Char('b'), QStringLiteral("ab") };
+    }
+    return Workload();
+}
+
+QString Corpus::name(Kind kind)
+{
+    switch (kind) {
+    case Kind::AsciiLog:
+        return QStringLiteral("ascii-log");
+    case Kind::CjkProse:
+        return QStringLiteral("cjk-prose");
+    case Kind::Repetitive:
+        return QStringLiteral("repetitive");
+    }
+    return QString();
+}
+
+bool Corpus::fromName(const QString& name, Kind* kind)
+{
+    static const std::array<Kind, 3> KINDS = { Kind::AsciiLog, Kind::CjkProse, Kind::Repetitive };
+    for (Kind candidate : KINDS) {
+        if (Corpus::name(candidate) == name) {
+            *kind = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+QStringList Corpus::names()
+{
+    return { name(Kind::AsciiLog), name(Kind::CjkProse), name(Kind::Repetitive) };
+}
+
+qint64 Corpus::parseSize(const QString& text)
+{
+    QString number = text.trimmed().toUpper();
+    if (number.endsWith(QLatin1Char('B'))) number.chop(1);
+
+    qint64 unit = 1;
+    if (number.endsWith(QLatin1Char('K'))) unit = 1024;
+    else if (number.endsWith(QLatin1Char('M'))) unit = 1024 * 1024;
+    else if (number.endsWith(QLatin1Char('G'))) unit = 1024 * 1024 * 1024;
+    if (unit > 1) number.chop(1);
+
+    bool ok = false;
+    const qint64 value = number.toLongLong(&ok);
+    return ok && value > 0 ? value * unit : -1;
+}
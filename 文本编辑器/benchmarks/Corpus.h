@@ -0,0 +1,38 @@
+﻿#pragma once
+
+#include <QString>
+#include <QStringList>
+
+// 基准测试用的合成语料：同一种子、同一大小在任何平台上生成完全相同的文本
+class Corpus
+{
+public:
+    enum class Kind {
+        AsciiLog,       // 英文服务日志
+        CjkProse,       // 中文段落
+        Repetitive,     // 大段重复字符，KMP 失配回退最多的情形
+    };
+
+    // 在语料上查找和替换的字符串
+    struct Workload {
+        QString pattern;
+        QString replacement;
+    };
+
+    Corpus() = default;
+    ~Corpus() = default;
+
+    // 生成 UTF-8 编码后约 bytes 字节的文本，以整行结束
+    static QString generate(Kind kind, qint64 bytes, quint64 seed);
+
+    static Workload workload(Kind kind);
+
+    static QString name(Kind kind);
+
+    static bool fromName(const QString& name, Kind* kind);
+
+    static QStringList names();
+
+    // 解析 1K、64M、1G 这样的大小（按 1024 进位），无效时返回 -1
+    static qint64 parseSize(const QString& text);
+};
@@ -0,0 +1,361 @@
+﻿#include "Corpus.h"
+#include "KMPMatcher.h"
+#include "StringProcessor.h"
+#include "TextReplacer.h"
+#include "DocumentReader.h"
+#include "DocumentWriter.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QDir>
+#include <QFile>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QRegularExpression>
+#include <QDateTime>
+#include <QSysInfo>
+#include <QThread>
+#include <QHash>
+#include <QVector>
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+
+namespace {
+
+constexpr int SCHEMA_VERSION = 1;
+
+struct Options {
+    QVector<Corpus::Kind> corpora;
+    QVector<qint64> sizes;
+    quint64 seed = 0;
+    int minRuns = 0;
+    int maxRuns = 0;
+    qint64 minTimeMs = 0;
+    QRegularExpression filter;
+};
+
+// 一个基准在一个语料上的结果
+struct Measurement {
+    QString benchmark;
+    QString corpus;
+    qint64 size = 0;            // 请求的语料大小（UTF-8 字节）
+    qint64 chars = 0;           // 实际生成的 UTF-16 字符数
+    qint64 bytes = 0;           // 本次处理的数据量，用于计算吞吐
+    int runs = 0;
+    qint64 minNs = 0;
+    qint64 medianNs = 0;
+    qint64 meanNs = 0;
+    qint64 result = 0;          // 匹配数、位置等，跨提交比较时结果不应变化
+};
+
+void printError(const QString& message)
+{
+    const QByteArray line = message.toLocal8Bit() + '\n';
+    std::fwrite(line.constData(), 1, size_t(line.size()), stderr);
+    std::fflush(stderr);
+}
+
+// 至少运行 minRuns 次，累计不足 minTimeMs 时继续，最多 maxRuns 次
+void measure(Measurement& measurement, const Options& options, const std::function<qint64()>& function)
+{
+    QVector<qint64> samples;
+    QElapsedTimer total;
+    total.start();
+    while (samples.size() < options.minRuns
+        || (total.elapsed() < options.minTimeMs && samples.size() < options.maxRuns)) {
+        QElapsedTimer timer;
+        timer.start();
+        measurement.result = function();
+        samples.append(timer.nsecsElapsed());
+    }
+
+    std::sort(samples.begin(), samples.end());
+    qint64 sum = 0;
+    for (qint64 sample : samples) sum += sample;
+
+    measurement.runs = int(samples.size());
+    measurement.minNs = samples.first();
+    measurement.medianNs = samples[samples.size() / 2];
+    measurement.meanNs = sum / samples.size();
+}
+
+double megabytesPerSecond(const Measurement& measurement)
+{
+    if (measurement.medianNs <= 0) return 0.0;
+    return double(measurement.bytes) / (1024.0 * 1024.0) / (double(measurement.medianNs) / 1e9);
+}
+
+QJsonObject toJson(const Measurement& measurement)
+{
+    QJsonObject object;
+    object.insert(QStringLiteral("benchmark"), measurement.benchmark);
+    object.insert(QStringLiteral("corpus"), measurement.corpus);
+    object.insert(QStringLiteral("size"), measurement.size);
+    object.insert(QStringLiteral("chars"), measurement.chars);
+    object.insert(QStringLiteral("runs"), measurement.runs);
+    object.insert(QStringLiteral("minNs"), measurement.minNs);
+    object.insert(QStringLiteral("medianNs"), measurement.medianNs);
+    object.insert(QStringLiteral("meanNs"), measurement.meanNs);
+    object.insert(QStringLiteral("mbPerSec"), megabytesPerSecond(measurement));
+    object.insert(QStringLiteral("result"), measurement.result);
+    return object;
+}
+
+QString resultKey(const QString& benchmark, const QString& corpus, qint64 size)
+{
+    return benchmark + QLatin1Char('|') + corpus + QLatin1Char('|') + QString::number(size);
+}
+
+QString formatDuration(qint64 ns)
+{
+    if (ns >= 1000000000) return QStringLiteral("%1 s").arg(double(ns) / 1e9, 0, 'f', 3);
+    if (ns >= 1000000) return QStringLiteral("%1 ms").arg(double(ns) / 1e6, 0, 'f', 3);
+    return QStringLiteral("%1 us").arg(double(ns) / 1e3, 0, 'f', 1);
+}
+
+void runCorpus(Corpus::Kind kind, qint64 size, const Options& options, const QDir& workDir,
+    QVector<Measurement>& measurements)
+{
+    const QString corpusName = Corpus::name(kind);
+    const QString text = Corpus::generate(kind, size, options.seed);
+    const Corpus::Workload workload = Corpus::workload(kind);
+    const qint64 textBytes = text.size() * qint64(sizeof(QChar));
+    const int middle = int(text.size() / 2);
+    const QString fileName = workDir.filePath(QStringLiteral("%1-%2.txt").arg(corpusName).arg(size));
+
+    const auto run = [&](const QString& benchmark, qint64 bytes, const std::function<qint64()>& function) {
+        if (!options.filter.match(benchmark).hasMatch()) return;
+
+        Measurement measurement;
+        measurement.benchmark = benchmark;
+        measurement.corpus = corpusName;
+        measurement.size = size;
+        measurement.chars = text.size();
+        measurement.bytes = bytes;
+        measure(measurement, options, function);
+        measurements.append(measurement);
+
+        printError(QStringLiteral("%1 %2 %3: median %4, %5 MB/s, %6 runs")
+            .arg(benchmark, -24).arg(corpusName, -10).arg(size, 12)
+            .arg(formatDuration(measurement.medianNs))
+            .arg(megabytesPerSecond(measurement), 0, 'f', 1)
+            .arg(measurement.runs));
+    };
+
+    // 查找：全文查找用于高亮和全部替换，F3/Shift+F3 从中间向两侧各查一次
+    run(QStringLiteral("kmp.search"), textBytes, [&]() {
+        return qint64(KMPMatcher::search(text, workload.pattern).size());
+    });
+    run(QStringLiteral("kmp.count"), textBytes, [&]() {
+        return qint64(KMPMatcher::count(text, workload.pattern));
+    });
+    run(QStringLiteral("kmp.findNext"), textBytes / 2, [&]() {
+        return qint64(KMPMatcher::findNext(text, workload.pattern, middle));
+    });
+    run(QStringLiteral("kmp.findPrev"), textBytes / 2, [&]() {
+        return qint64(KMPMatcher::findPrev(text, workload.pattern, middle));
+    });
+
+    // 状态栏统计
+    run(QStringLiteral("stringProcessor.process"), textBytes, [&]() {
+        const StringProcessor::Result stats = StringProcessor().process(text);
+        return qint64(stats.total) + stats.chinese + stats.letters + stats.digits + stats.symbols;
+    });
+
+    // 全部替换：查找、去掉重叠的匹配、一次拼出结果
+    run(QStringLiteral("textReplacer.replaceAll"), textBytes, [&]() {
+        int count = 0;
+        const QString replaced = TextReplacer::replaceAll(text, workload.pattern, workload.replacement, &count);
+        return qint64(replaced.size()) + count;
+    });
+
+    // 保存和打开走 FileManager 在工作线程里调用的同一条路径
+    qint64 fileBytes = 0;
+    run(QStringLiteral("file.save"), textBytes, [&]() {
+        const DocumentWriter::Result written = DocumentWriter::writeAtomically(fileName, text);
+        fileBytes = written.ok ? written.bytesWritten : -1;
+        return fileBytes;
+    });
+    if (!QFile::exists(fileName)) {
+        const DocumentWriter::Result written = DocumentWriter::writeAtomically(fileName, text);
+        fileBytes = written.ok ? written.bytesWritten : -1;
+    }
+    run(QStringLiteral("file.load"), fileBytes, [&]() {
+        const DocumentReader::Result loaded = DocumentReader::read(fileName);
+        return loaded.ok ? qint64(loaded.text.size()) : -1;
+    });
+    run(QStringLiteral("file.loadMapped"), fileBytes, [&]() {
+        const DocumentReader::Result loaded = DocumentReader::readMapped(fileName);
+        return loaded.ok ? qint64(loaded.text.size()) : -1;
+    });
+
+    QFile::remove(fileName);
+}
+
+// 与之前的结果比较：中位数变慢超过阈值或结果不同都算回归
+int compareWithBaseline(const QString& baselineFile, const QVector<Measurement>& measurements, double threshold)
+{
+    QFile file(baselineFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        printError(QCoreApplication::translate("Benchmarks", "无法读取基准文件: %1").arg(baselineFile));
+        return 2;
+    }
+    const QJsonArray baseline = QJsonDocument::fromJson(file.readAll()).object()
+        .value(QStringLiteral("results")).toArray();
+
+    QHash<QString, QJsonObject> previous;
+    for (const QJsonValue& value : baseline) {
+        const QJsonObject object = value.toObject();
+        previous.insert(resultKey(object.value(QStringLiteral("benchmark")).toString(),
+            object.value(QStringLiteral("corpus")).toString(),
+            object.value(QStringLiteral("size")).toInteger()), object);
+    }
+
+    int regressions = 0;
+    for (const Measurement& measurement : measurements) {
+        const auto it = previous.constFind(resultKey(measurement.benchmark, measurement.corpus, measurement.size));
+        if (it == previous.constEnd()) continue;
+
+        const qint64 before = it->value(QStringLiteral("medianNs")).toInteger();
+        const double change = before > 0 ? double(measurement.medianNs) / double(before) - 1.0 : 0.0;
+        const bool slower = change > threshold;
+        const bool differs = it->value(QStringLiteral("result")).toInteger() != measurement.result;
+        if (slower || differs) ++regressions;
+
+        printError(QStringLiteral("%1 %2 %3: %4 -> %5 (%6%7%)%8")
+            .arg(measurement.benchmark, -24).arg(measurement.corpus, -10).arg(measurement.size, 12)
+            .arg(formatDuration(before), formatDuration(measurement.medianNs))
+            .arg(change >= 0 ? QStringLiteral("+") : QString())
+            .arg(change * 100.0, 0, 'f', 1)
+            .arg(differs ? QCoreApplication::translate("Benchmarks", "  结果不同")
+                : slower ? QCoreApplication::translate("Benchmarks", "  变慢") : QString()));
+    }
+    return regressions > 0 ? 1 : 0;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("benchmarks"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QCoreApplication::translate("Benchmarks",
+        "在合成语料上测量查找、统计、替换和文件读写，结果以 JSON 输出"));
+    parser.addHelpOption();
+
+    const QCommandLineOption corpusOption(QStringLiteral("corpus"),
+        QCoreApplication::translate("Benchmarks", "语料，逗号分隔：%1").arg(Corpus::names().join(QLatin1Char(','))),
+        QStringLiteral("names"), Corpus::names().join(QLatin1Char(',')));
+    const QCommandLineOption sizeOption(QStringLiteral("sizes"),
+        QCoreApplication::translate("Benchmarks", "语料大小，逗号分隔，如 1K,1M,1G（1G 需要数 GB 内存）"),
+        QStringLiteral("sizes"), QStringLiteral("1K,64K,1M,16M"));
+    const QCommandLineOption seedOption(QStringLiteral("seed"),
+        QCoreApplication::translate("Benchmarks", "生成语料的随机种子"), QStringLiteral("n"), QStringLiteral("20240601"));
+    const QCommandLineOption filterOption(QStringLiteral("filter"),
+        QCoreApplication::translate("Benchmarks", "只运行名称匹配此正则表达式的基准"), QStringLiteral("regex"));
+    const QCommandLineOption minRunsOption(QStringLiteral("min-runs"),
+        QCoreApplication::translate("Benchmarks", "每项最少运行次数"), QStringLiteral("n"), QStringLiteral("3"));
+    const QCommandLineOption maxRunsOption(QStringLiteral("max-runs"),
+        QCoreApplication::translate("Benchmarks", "每项最多运行次数"), QStringLiteral("n"), QStringLiteral("50"));
+    const QCommandLineOption minTimeOption(QStringLiteral("min-time"),
+        QCoreApplication::translate("Benchmarks", "每项至少累计运行的毫秒数"), QStringLiteral("ms"), QStringLiteral("500"));
+    const QCommandLineOption outputOption(QStringLiteral("output"),
+        QCoreApplication::translate("Benchmarks", "JSON 结果写入文件，默认输出到标准输出"), QStringLiteral("file"));
+    const QCommandLineOption workDirOption(QStringLiteral("work-dir"),
+        QCoreApplication::translate("Benchmarks", "文件读写基准使用的目录，默认为临时目录"), QStringLiteral("dir"));
+    const QCommandLineOption baselineOption(QStringLiteral("baseline"),
+        QCoreApplication::translate("Benchmarks", "与之前输出的 JSON 比较，有回归时退出码为 1"), QStringLiteral("file"));
+    const QCommandLineOption thresholdOption(QStringLiteral("threshold"),
+        QCoreApplication::translate("Benchmarks", "中位数变慢超过此百分比算作回归"), QStringLiteral("percent"), QStringLiteral("10"));
+    parser.addOptions({ corpusOption, sizeOption, seedOption, filterOption, minRunsOption, maxRunsOption,
+        minTimeOption, outputOption, workDirOption, baselineOption, thresholdOption });
+    parser.process(app);
+
+    Options options;
+    for (const QString& name : parser.value(corpusOption).split(QLatin1Char(','), Qt::SkipEmptyParts)) {
+        Corpus::Kind kind = Corpus::Kind::AsciiLog;
+        if (!Corpus::fromName(name.trimmed(), &kind)) {
+            printError(QCoreApplication::translate("Benchmarks", "未知的语料: %1").arg(name));
+            return 2;
+        }
+        options.corpora.append(kind);
+    }
+    for (const QString& text : parser.value(sizeOption).split(QLatin1Char(','), Qt::SkipEmptyParts)) {
+        const qint64 size = Corpus::parseSize(text);
+        if (size <= 0) {
+            printError(QCoreApplication::translate("Benchmarks", "无效的大小: %1").arg(text));
+            return 2;
+        }
+        options.sizes.append(size);
+    }
+    options.seed = parser.value(seedOption).toULongLong();
+    options.minRuns = qMax(1, parser.value(minRunsOption).toInt());
+    options.maxRuns = qMax(options.minRuns, parser.value(maxRunsOption).toInt());
+    options.minTimeMs = qMax(0, parser.value(minTimeOption).toInt());
+    options.filter = QRegularExpression(parser.value(filterOption));
+    if (!options.filter.isValid()) {
+        printError(QCoreApplication::translate("Benchmarks", "无效的正则表达式: %1").arg(options.filter.errorString()));
+        return 2;
+    }
+
+    QTemporaryDir temporaryDir;
+    const QDir workDir(parser.isSet(workDirOption) ? parser.value(workDirOption) : temporaryDir.path());
+    if (!workDir.exists()) {
+        printError(QCoreApplication::translate("Benchmarks", "目录不存在: %1").arg(workDir.path()));
+        return 2;
+    }
+
+    QVector<Measurement> measurements;
+    for (Corpus::Kind kind : options.corpora) {
+        for (qint64 size : options.sizes) {
+            runCorpus(kind, size, options, workDir, measurements);
+        }
+    }
+
+    // 附带运行环境，比较不同提交时确认是在同一台机器、同一种构建下测得的
+    QJsonObject environment;
+    environment.insert(QStringLiteral("qt"), QString::fromLatin1(qVersion()));
+    environment.insert(QStringLiteral("os"), QSysInfo::prettyProductName());
+    environment.insert(QStringLiteral("cpu"), QSysInfo::currentCpuArchitecture());
+    environment.insert(QStringLiteral("threads"), QThread::idealThreadCount());
+#ifdef TEXT_EDITOR_BUILD_TYPE
+    environment.insert(QStringLiteral("buildType"), QStringLiteral(TEXT_EDITOR_BUILD_TYPE));
+#endif
+
+    QJsonArray results;
+    for (const Measurement& measurement : measurements) {
+        results.append(toJson(measurement));
+    }
+
+    QJsonObject root;
+    root.insert(QStringLiteral("schema"), SCHEMA_VERSION);
+    root.insert(QStringLiteral("timestamp"), QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+    root.insert(QStringLiteral("seed"), QString::number(options.seed));
+    root.insert(QStringLiteral("environment"), environment);
+    root.insert(QStringLiteral("results"), results);
+    const QByteArray json = QJsonDocument(root).toJson(QJsonDocument::Indented);
+
+    if (parser.isSet(outputOption)) {
+        QFile output(parser.value(outputOption));
+        if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate) || output.write(json) != json.size()) {
+            printError(QCoreApplication::translate("Benchmarks", "无法写入结果文件: %1").arg(output.fileName()));
+            return 2;
+        }
+    }
+    else {
+        std::fwrite(json.constData(), 1, size_t(json.size()), stdout);
+    }
+
+    if (parser.isSet(baselineOption)) {
+        return compareWithBaseline(parser.value(baselineOption), measurements,
+            parser.value(thresholdOption).toDouble() / 100.0);
+    }
+    return 0;
+}
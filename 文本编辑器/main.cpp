@@ -1,20 +1,61 @@
 ﻿#include "QtWidgetsApplication.h"
+#include "BatchCli.h"
+#include "Trace.h"
+#include "Startup.h"
 #include <QtWidgets/QApplication>
-#include <qfile.h>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QResource>
+#include <QFileInfo>
 
 int main(int argc, char *argv[])
 {
+    QElapsedTimer clock;
+    clock.start();
+
+    // 带批处理参数时以命令行方式运行，不创建窗口
+    if (BatchCli::isBatchInvocation(argc, argv)) {
+        return BatchCli::run(argc, argv);
+    }
+
     QApplication app(argc, argv);
 
+    // --trace-file 从启动开始记录耗时，退出时导出为 Chrome 跟踪格式
+    QCommandLineParser parser;
+    const QCommandLineOption traceFileOption(QStringLiteral("trace-file"),
+        QCoreApplication::translate("main", "记录各操作的耗时，退出时写入指定文件"), QStringLiteral("file"));
+    parser.addOption(traceFileOption);
+    // --startup-trace 把启动各阶段（直到首次绘制和文件打开完成）的耗时输出到标准错误
+    const QCommandLineOption startupTraceOption(QStringLiteral("startup-trace"),
+        QCoreApplication::translate("main", "输出启动各阶段的耗时"));
+    parser.addOption(startupTraceOption);
+    parser.addPositionalArgument(QStringLiteral("file"),
+        QCoreApplication::translate("main", "启动后打开的文件"));
+    parser.parse(app.arguments());
+    const QString traceFile = parser.value(traceFileOption);
+    if (!traceFile.isEmpty()) {
+        Trace::setEnabled(true);
+    }
 
-    QFile f(":qdarkstyle/dark/darkstyle.qss");
-    f.open(QFile::ReadOnly | QFile::Text);
-    QTextStream ts(&f);
-    qApp->setStyleSheet(ts.readAll());
+    Startup startup(clock, parser.isSet(startupTraceOption));
+    startup.mark("startup.application");
 
+    // 样式表等首次绘制之后再应用，先用相近的深色调色板把窗口画出来
+    QApplication::setStyle("Fusion");
+    if (QResource(QStringLiteral(":qdarkstyle/dark/darkstyle.qss")).isValid()) {
+        QApplication::setPalette(Startup::darkPalette());
+    }
 
     QtWidgetsApplication window;
-    QApplication::setStyle("Fusion");
+    startup.mark("startup.windowCreated");
     window.show();
-    return app.exec();
+
+    const QStringList files = parser.positionalArguments();
+    startup.finish(&window, files.isEmpty() ? QString() : QFileInfo(files.first()).absoluteFilePath());
+    const int exitCode = app.exec();
+
+    if (!traceFile.isEmpty()) {
+        Trace::exportChromeTrace(traceFile);
+    }
+    return exitCode;
 }